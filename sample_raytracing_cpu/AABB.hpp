@@ -0,0 +1,64 @@
+//
+//  AABB.hpp
+//  Test
+//
+//  Created by Erik Nouroyan on 17.10.26.
+//
+
+#ifndef AABB_hpp
+#define AABB_hpp
+
+#include <algorithm>
+#include <math.h>
+#include <glm/vec3.hpp>
+
+struct AABB {
+    glm::vec3 min {MAXFLOAT, MAXFLOAT, MAXFLOAT};
+    glm::vec3 max {-MAXFLOAT, -MAXFLOAT, -MAXFLOAT};
+
+    void grow(const glm::vec3& p) {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+
+    void grow(const AABB& box) {
+        min = glm::min(min, box.min);
+        max = glm::max(max, box.max);
+    }
+
+    bool isEmpty() const {
+        return min.x > max.x || min.y > max.y || min.z > max.z;
+    }
+
+    glm::vec3 getCenter() const {
+        return 0.5f * (min + max);
+    }
+
+    float getSurfaceArea() const {
+        if (isEmpty()) {
+            return 0.f;
+        }
+        glm::vec3 extent = max - min;
+        return 2.f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+    }
+
+    //Slab test, tEntry is clamped to 0 so boxes behind the origin are rejected
+    bool intersects(const glm::vec3& origin, const glm::vec3& invDir, float tMax, float& tEntry) const {
+        float tNear = 0.f;
+        float tFar = tMax;
+        for (int axis = 0; axis < 3; ++axis) {
+            float t0 = (min[axis] - origin[axis]) * invDir[axis];
+            float t1 = (max[axis] - origin[axis]) * invDir[axis];
+            if (t0 > t1) {
+                std::swap(t0, t1);
+            }
+            tNear = t0 > tNear ? t0 : tNear;
+            tFar = t1 < tFar ? t1 : tFar;
+        }
+        tEntry = tNear;
+
+        return tNear <= tFar;
+    }
+};
+
+#endif /* AABB_hpp */
@@ -0,0 +1,710 @@
+//
+//  BVH.cpp
+//  Test
+//
+//  Created by Erik Nouroyan on 17.10.26.
+//
+
+#include "BVH.hpp"
+#include "RenderStats.hpp"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+
+namespace {
+
+const int binCount = 16;
+const float traversalCost = 1.f;
+const float intersectionCost = 1.f;
+const int parallelThreshold = 4096;
+
+struct Bin {
+    AABB bounds;
+    int count = 0;
+};
+
+//Node that is built later as a task of its own
+struct DeferredNode {
+    int nodeIndex;
+    int first;
+    int count;
+    int depth;
+};
+
+struct BuildContext {
+    const std::vector<AABB>& bounds;
+    const std::vector<glm::vec3>& centroids;
+    std::vector<BVHNode>& nodes;
+    std::vector<int>& indices;
+    std::atomic<int> nodeCount;
+    int maxLeafSize;
+    //Large nodes at this depth go to deferred instead of being built, the serial top of the tree collects them
+    int parallelDepth;
+    std::vector<DeferredNode>* deferred;
+};
+
+void makeLeaf(BVHNode& node, int first, int count) {
+    node.leftFirst = first;
+    node.count = count;
+}
+
+void buildNode(BuildContext& ctx, int nodeIndex, int first, int count, int depth) {
+    if (ctx.deferred && depth == ctx.parallelDepth && count >= parallelThreshold) {
+        ctx.deferred->push_back({nodeIndex, first, count, depth});
+        return;
+    }
+
+    BVHNode& node = ctx.nodes[nodeIndex];
+    AABB centroidBounds;
+    node.bounds = AABB();
+    for (int i = first; i < first + count; ++i) {
+        node.bounds.grow(ctx.bounds[ctx.indices[i]]);
+        centroidBounds.grow(ctx.centroids[ctx.indices[i]]);
+    }
+
+    if (count == 1 || depth >= BVH::maxDepth - 1) {
+        makeLeaf(node, first, count);
+        return;
+    }
+
+    //Finding the cheapest bin boundary over all three axes
+    int bestAxis = -1;
+    int bestSplit = 0;
+    float bestCost = MAXFLOAT;
+    for (int axis = 0; axis < 3; ++axis) {
+        const float extent = centroidBounds.max[axis] - centroidBounds.min[axis];
+        if (extent <= 0.f) {
+            continue;
+        }
+
+        Bin bins[binCount];
+        const float scale = binCount / extent;
+        for (int i = first; i < first + count; ++i) {
+            const int index = ctx.indices[i];
+            int b = static_cast<int>((ctx.centroids[index][axis] - centroidBounds.min[axis]) * scale);
+            b = std::min(b, binCount - 1);
+            bins[b].bounds.grow(ctx.bounds[index]);
+            ++bins[b].count;
+        }
+
+        float rightArea[binCount - 1];
+        int rightCount[binCount - 1];
+        AABB rightBox;
+        int rightSum = 0;
+        for (int b = binCount - 1; b > 0; --b) {
+            rightBox.grow(bins[b].bounds);
+            rightSum += bins[b].count;
+            rightArea[b - 1] = rightBox.getSurfaceArea();
+            rightCount[b - 1] = rightSum;
+        }
+
+        AABB leftBox;
+        int leftSum = 0;
+        for (int b = 0; b < binCount - 1; ++b) {
+            leftBox.grow(bins[b].bounds);
+            leftSum += bins[b].count;
+            if (leftSum == 0 || rightCount[b] == 0) {
+                continue;
+            }
+            const float cost = leftSum * leftBox.getSurfaceArea() + rightCount[b] * rightArea[b];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = b + 1;
+            }
+        }
+    }
+
+    const float parentArea = node.bounds.getSurfaceArea();
+    const float leafCost = count * intersectionCost;
+    const float splitCost = parentArea > 0.f ? traversalCost + intersectionCost * bestCost / parentArea : MAXFLOAT;
+
+    int middle;
+    if (bestAxis != -1) {
+        if (count <= ctx.maxLeafSize && leafCost <= splitCost) {
+            makeLeaf(node, first, count);
+            return;
+        }
+        const float minCentroid = centroidBounds.min[bestAxis];
+        const float scale = binCount / (centroidBounds.max[bestAxis] - minCentroid);
+        int* begin = ctx.indices.data() + first;
+        int* split = std::partition(begin, begin + count, [&](int index) {
+            int b = static_cast<int>((ctx.centroids[index][bestAxis] - minCentroid) * scale);
+            return std::min(b, binCount - 1) < bestSplit;
+        });
+        middle = static_cast<int>(split - ctx.indices.data());
+    }
+    else {
+        //All centroids coincide, so only the leaf size can force a split
+        if (count <= ctx.maxLeafSize) {
+            makeLeaf(node, first, count);
+            return;
+        }
+        middle = first + count / 2;
+    }
+
+    const int leftIndex = ctx.nodeCount.fetch_add(2);
+    node.leftFirst = leftIndex;
+    node.count = 0;
+
+    buildNode(ctx, leftIndex, first, middle - first, depth + 1);
+    buildNode(ctx, leftIndex + 1, middle, first + count - middle, depth + 1);
+}
+
+//Pads the box so that rounding in the triangle test never lands outside of it
+AABB getPaddedBounds(const TriangleBuffer& triangles, int slot) {
+    AABB box;
+    for (int v = 0; v < 3; ++v) {
+        box.grow(triangles.getVertex(slot, v));
+    }
+    const glm::vec3 magnitude = glm::max(glm::abs(box.min), glm::abs(box.max));
+    const float padding = 1e-5f * (std::max(magnitude.x, std::max(magnitude.y, magnitude.z)) + 1.f);
+    box.min -= glm::vec3(padding);
+    box.max += glm::vec3(padding);
+
+    return box;
+}
+
+}
+
+BVH::BVH(const TriangleBuffer& source, ThreadPool& pool, int maxLeafSize) {
+    const int count = source.size();
+    std::vector<AABB> primitiveBounds(count);
+    const int chunkCount = pool.getThreadCount();
+    pool.parallelFor(chunkCount, [&](int c) {
+        const int end = static_cast<int>(static_cast<long>(count) * (c + 1) / chunkCount);
+        for (int i = static_cast<int>(static_cast<long>(count) * c / chunkCount); i < end; ++i) {
+            primitiveBounds[i] = getPaddedBounds(source, i);
+        }
+    });
+
+    build(primitiveBounds, maxLeafSize, &pool);
+    triangles = source.reordered(primitiveIndices);
+}
+
+BVH::BVH(const std::vector<AABB>& primitiveBounds, int maxLeafSize) {
+    build(primitiveBounds, maxLeafSize, nullptr);
+}
+
+BVH::BVH(const BVHNode* nodes, int nodeCount, const int* primitiveIndices, TriangleBuffer triangles, std::shared_ptr<const void> owner) :
+        triangles(std::move(triangles)), nodeData(nodes), nodeCount(nodeCount), primitiveIndexData(primitiveIndices), owner(std::move(owner)) {}
+
+BVH::BVH(const BVH& other) :
+        nodes(other.nodes), primitiveIndices(other.primitiveIndices), triangles(other.triangles),
+        nodeData(other.nodeData), nodeCount(other.nodeCount), primitiveIndexData(other.primitiveIndexData), owner(other.owner), dynamic(other.dynamic) {
+    if (!owner) {
+        bindStorage();
+    }
+}
+
+BVH& BVH::operator=(const BVH& other) {
+    if (this != &other) {
+        nodes = other.nodes;
+        primitiveIndices = other.primitiveIndices;
+        triangles = other.triangles;
+        nodeData = other.nodeData;
+        nodeCount = other.nodeCount;
+        primitiveIndexData = other.primitiveIndexData;
+        owner = other.owner;
+        dynamic = other.dynamic;
+        if (!owner) {
+            bindStorage();
+        }
+    }
+
+    return *this;
+}
+
+void BVH::bindStorage() {
+    nodeData = nodes.data();
+    nodeCount = static_cast<int>(nodes.size());
+    primitiveIndexData = primitiveIndices.data();
+}
+
+void BVH::build(const std::vector<AABB>& primitiveBounds, int maxLeafSize, ThreadPool* pool) {
+    const int count = static_cast<int>(primitiveBounds.size());
+    dynamic = DynamicState();
+    dynamic.maxLeafSize = std::max(1, maxLeafSize);
+    primitiveIndices.resize(count);
+    for (int i = 0; i < count; ++i) {
+        primitiveIndices[i] = i;
+    }
+    if (count == 0) {
+        bindStorage();
+        return;
+    }
+
+    nodes.resize(2 * count - 1);
+    std::vector<glm::vec3> centroids(count);
+    for (int i = 0; i < count; ++i) {
+        centroids[i] = primitiveBounds[i].getCenter();
+    }
+    //The top of the tree is built serially down to a few large nodes per thread, which are then built on the pool
+    std::vector<DeferredNode> deferred;
+    BuildContext ctx {primitiveBounds, centroids, nodes, primitiveIndices, {1}, dynamic.maxLeafSize, 2, nullptr};
+    if (pool && pool->getThreadCount() > 1) {
+        for (int threads = pool->getThreadCount(); threads > 1; threads >>= 1) {
+            ++ctx.parallelDepth;
+        }
+        ctx.deferred = &deferred;
+    }
+    buildNode(ctx, 0, 0, count, 0);
+    ctx.deferred = nullptr;
+    if (!deferred.empty()) {
+        pool->parallelFor(static_cast<int>(deferred.size()), [&](int d) {
+            buildNode(ctx, deferred[d].nodeIndex, deferred[d].first, deferred[d].count, deferred[d].depth);
+        });
+    }
+    nodes.resize(ctx.nodeCount.load());
+    bindStorage();
+}
+
+bool BVH::refit(const TriangleBuffer& source, ThreadPool& pool) {
+    if (source.size() != triangles.size()) {
+        return false;
+    }
+    if (nodeCount == 0 || triangles.size() == 0) {
+        return true;
+    }
+
+    //A hierarchy in mapped memory is copied out before it is modified
+    if (owner) {
+        nodes.assign(nodeData, nodeData + nodeCount);
+        primitiveIndices.assign(primitiveIndexData, primitiveIndexData + triangles.size());
+        triangles = source.reordered(primitiveIndices);
+        owner.reset();
+        bindStorage();
+    }
+    if (dynamic.subtrees.empty()) {
+        prepareDynamic(pool);
+    }
+
+    //Subtrees cover disjoint slot ranges and nodes, only the few nodes above them are refitted serially
+    pool.parallelFor(static_cast<int>(dynamic.subtrees.size()), [&](int s) {
+        const Subtree& subtree = dynamic.subtrees[s];
+        for (int slot = subtree.first; slot < subtree.first + subtree.count; ++slot) {
+            triangles.copySlot(slot, source, primitiveIndices[slot]);
+        }
+        refitNode(subtree.root);
+    });
+    refitTopNodes();
+
+    return true;
+}
+
+BVHUpdate BVH::update(const TriangleBuffer& source, ThreadPool& pool, float rebuildThreshold) {
+    if (source.size() == triangles.size() && refit(source, pool)) {
+        if (nodeCount == 0 || triangles.size() == 0) {
+            return BVHUpdate::Refit;
+        }
+
+        //The root is measured against the last full build, every subtree against its own last build
+        const int subtreeCount = static_cast<int>(dynamic.subtrees.size());
+        std::vector<float> costs(subtreeCount);
+        pool.parallelFor(subtreeCount, [&](int s) {
+            costs[s] = getCost(dynamic.subtrees[s].root);
+        });
+        if (getCost() <= rebuildThreshold * dynamic.builtCost && dynamic.unusedNodes <= nodeCount / 2) {
+            std::vector<int> degraded;
+            for (int s = 0; s < subtreeCount; ++s) {
+                if (costs[s] > rebuildThreshold * dynamic.subtrees[s].builtCost) {
+                    degraded.push_back(s);
+                }
+            }
+            if (degraded.empty()) {
+                return BVHUpdate::Refit;
+            }
+
+            std::vector<AABB> bounds(triangles.size());
+            std::vector<glm::vec3> centroids(triangles.size());
+            std::vector<std::vector<BVHNode>> subtreeNodes(degraded.size());
+            pool.parallelFor(static_cast<int>(degraded.size()), [&](int d) {
+                rebuildSubtree(dynamic.subtrees[degraded[d]], source, bounds, centroids, subtreeNodes[d]);
+            });
+
+            //A rebuilt subtree keeps its root node, the rest of it is appended and the old nodes are left unused
+            for (size_t d = 0; d < degraded.size(); ++d) {
+                const int root = dynamic.subtrees[degraded[d]].root;
+                int stack[maxDepth];
+                int stackSize = 0;
+                stack[stackSize++] = root;
+                while (stackSize > 0) {
+                    const BVHNode& node = nodes[stack[--stackSize]];
+                    if (node.count == 0) {
+                        stack[stackSize++] = node.leftFirst;
+                        stack[stackSize++] = node.leftFirst + 1;
+                        dynamic.unusedNodes += 2;
+                    }
+                }
+
+                std::vector<BVHNode>& added = subtreeNodes[d];
+                const int offset = static_cast<int>(nodes.size()) - 1;
+                for (BVHNode& node : added) {
+                    if (node.count == 0) {
+                        node.leftFirst += offset;
+                    }
+                }
+                nodes[root] = added[0];
+                nodes.insert(nodes.end(), added.begin() + 1, added.end());
+            }
+            bindStorage();
+            refitTopNodes();
+            for (int s : degraded) {
+                dynamic.subtrees[s].builtCost = getCost(dynamic.subtrees[s].root);
+            }
+
+            return BVHUpdate::PartialRebuild;
+        }
+    }
+
+    const int maxLeafSize = dynamic.maxLeafSize;
+    *this = BVH(source, pool, maxLeafSize);
+    prepareDynamic(pool);
+
+    return BVHUpdate::FullRebuild;
+}
+
+float BVH::getCost() const {
+    return nodeCount > 0 ? getCost(0) : 0.f;
+}
+
+float BVH::getCost(int root) const {
+    float cost = 0.f;
+    int stack[maxDepth];
+    int stackSize = 0;
+    stack[stackSize++] = root;
+    while (stackSize > 0) {
+        const BVHNode& node = nodeData[stack[--stackSize]];
+        if (node.count > 0) {
+            cost += node.bounds.getSurfaceArea() * node.count * intersectionCost;
+            continue;
+        }
+        cost += node.bounds.getSurfaceArea() * traversalCost;
+        stack[stackSize++] = node.leftFirst;
+        stack[stackSize++] = node.leftFirst + 1;
+    }
+    const float rootArea = nodeData[root].bounds.getSurfaceArea();
+
+    return rootArea > 0.f ? cost / rootArea : 0.f;
+}
+
+void BVH::prepareDynamic(ThreadPool& pool) {
+    dynamic.subtrees.clear();
+    dynamic.topNodes.clear();
+    dynamic.unusedNodes = 0;
+    if (nodeCount == 0) {
+        return;
+    }
+
+    //A few subtrees per thread, split at a fixed depth
+    int splitDepth = 2;
+    for (int threads = pool.getThreadCount(); threads > 1; threads >>= 1) {
+        ++splitDepth;
+    }
+    struct StackEntry {
+        int node;
+        int depth;
+        bool childrenDone;
+    };
+    std::vector<StackEntry> stack;
+    stack.push_back({0, 0, false});
+    while (!stack.empty()) {
+        const StackEntry entry = stack.back();
+        stack.pop_back();
+        const BVHNode& node = nodeData[entry.node];
+        if (node.count > 0 || entry.depth == splitDepth) {
+            dynamic.subtrees.push_back({entry.node, entry.depth, 0, 0, 0.f});
+        }
+        else if (entry.childrenDone) {
+            dynamic.topNodes.push_back(entry.node);
+        }
+        else {
+            stack.push_back({entry.node, entry.depth, true});
+            stack.push_back({node.leftFirst + 1, entry.depth + 1, false});
+            stack.push_back({node.leftFirst, entry.depth + 1, false});
+        }
+    }
+
+    //The leaves of a subtree are one contiguous range of slots
+    pool.parallelFor(static_cast<int>(dynamic.subtrees.size()), [&](int s) {
+        Subtree& subtree = dynamic.subtrees[s];
+        int first = INT_MAX;
+        int count = 0;
+        int nodeStack[maxDepth];
+        int stackSize = 0;
+        nodeStack[stackSize++] = subtree.root;
+        while (stackSize > 0) {
+            const BVHNode& node = nodeData[nodeStack[--stackSize]];
+            if (node.count > 0) {
+                first = std::min(first, node.leftFirst);
+                count += node.count;
+                continue;
+            }
+            nodeStack[stackSize++] = node.leftFirst;
+            nodeStack[stackSize++] = node.leftFirst + 1;
+        }
+        subtree.first = first;
+        subtree.count = count;
+        subtree.builtCost = getCost(subtree.root);
+    });
+    dynamic.builtCost = getCost();
+}
+
+void BVH::refitNode(int index) {
+    BVHNode& node = nodes[index];
+    if (node.count > 0) {
+        node.bounds = AABB();
+        for (int slot = node.leftFirst; slot < node.leftFirst + node.count; ++slot) {
+            node.bounds.grow(getPaddedBounds(triangles, slot));
+        }
+        return;
+    }
+
+    refitNode(node.leftFirst);
+    refitNode(node.leftFirst + 1);
+    node.bounds = nodes[node.leftFirst].bounds;
+    node.bounds.grow(nodes[node.leftFirst + 1].bounds);
+}
+
+void BVH::refitTopNodes() {
+    for (int index : dynamic.topNodes) {
+        BVHNode& node = nodes[index];
+        node.bounds = nodes[node.leftFirst].bounds;
+        node.bounds.grow(nodes[node.leftFirst + 1].bounds);
+    }
+}
+
+void BVH::rebuildSubtree(const Subtree& subtree, const TriangleBuffer& source, std::vector<AABB>& bounds,
+                         std::vector<glm::vec3>& centroids, std::vector<BVHNode>& subtreeNodes) {
+    //Bounds and centroids are indexed by primitive, the subtrees fill disjoint entries
+    for (int slot = subtree.first; slot < subtree.first + subtree.count; ++slot) {
+        const int index = primitiveIndices[slot];
+        bounds[index] = getPaddedBounds(triangles, slot);
+        centroids[index] = bounds[index].getCenter();
+    }
+
+    //Built serially, the subtrees themselves run in parallel, and starting at the subtree's depth keeps the whole tree within maxDepth
+    subtreeNodes.resize(2 * subtree.count - 1);
+    BuildContext ctx {bounds, centroids, subtreeNodes, primitiveIndices, {1}, dynamic.maxLeafSize, 0, nullptr};
+    buildNode(ctx, 0, subtree.first, subtree.count, subtree.depth);
+    subtreeNodes.resize(ctx.nodeCount.load());
+
+    for (int slot = subtree.first; slot < subtree.first + subtree.count; ++slot) {
+        triangles.copySlot(slot, source, primitiveIndices[slot]);
+    }
+}
+
+int BVH::intersect(const Ray& r, float& t, float tMax) const {
+    int minId = INT_MAX;
+    RT_STATS(++getThreadCounters().rays);
+    float tBest = tMax;
+    traverse(r, tBest, [&](int first, int count, float& tLeaf) {
+        triangles.intersect(r, first, count, tLeaf, minId);
+    });
+
+    if (minId != INT_MAX) {
+        t = tBest;
+        RT_STATS(++getThreadCounters().hits);
+    }
+
+    return minId;
+}
+
+bool BVH::occluded(const Ray& r, float tMax) const {
+    RT_STATS(++getThreadCounters().rays);
+    const bool blocked = traverseAny(r, tMax, [&](int first, int count) {
+        return triangles.occluded(r, first, count, tMax);
+    });
+    RT_STATS(getThreadCounters().hits += blocked);
+
+    return blocked;
+}
+
+namespace {
+
+//Bounds of the product of the intervals [a0, a1] and [b0, b1]
+void intervalMul(float a0, float a1, float b0, float b1, float& lo, float& hi) {
+    const float p0 = a0 * b0;
+    const float p1 = a0 * b1;
+    const float p2 = a1 * b0;
+    const float p3 = a1 * b1;
+    lo = std::min(std::min(p0, p1), std::min(p2, p3));
+    hi = std::max(std::max(p0, p1), std::max(p2, p3));
+}
+
+}
+
+void BVH::intersect(const RayPacket& packet, int* ids, float* t) const {
+    for (int lane = 0; lane < simd::width; ++lane) {
+        ids[lane] = INT_MAX;
+    }
+    const int active = packet.activeMask;
+    if (nodeCount == 0 || !active) {
+        return;
+    }
+
+    //Interval culling needs all rays in one octant, mixed packets are traced one ray at a time
+    const SimdRay r = packet.load();
+    simd::Float invDir[3];
+    for (int axis = 0; axis < 3; ++axis) {
+        const int negative = (r.dir[axis] < simd::Float(0.f)).bits() & active;
+        if (negative != 0 && negative != active) {
+            for (int lane = 0; lane < simd::width; ++lane) {
+                if (active & (1 << lane)) {
+                    ids[lane] = intersect(packet.getRay(lane), t[lane]);
+                }
+            }
+            return;
+        }
+        invDir[axis] = simd::Float(1.f) / r.dir[axis];
+    }
+    RT_STATS(getThreadCounters().rays += simd::countLanes(active));
+
+    //Origin and inverse direction intervals over the active lanes
+    float originMin[3], originMax[3], invMin[3], invMax[3];
+    alignas(32) float invLanes[simd::width];
+    glm::vec3 meanDir(0.f);
+    for (int axis = 0; axis < 3; ++axis) {
+        invDir[axis].store(invLanes);
+        originMin[axis] = invMin[axis] = MAXFLOAT;
+        originMax[axis] = invMax[axis] = -MAXFLOAT;
+        for (int lane = 0; lane < simd::width; ++lane) {
+            if (active & (1 << lane)) {
+                originMin[axis] = std::min(originMin[axis], packet.p0[axis][lane]);
+                originMax[axis] = std::max(originMax[axis], packet.p0[axis][lane]);
+                invMin[axis] = std::min(invMin[axis], invLanes[lane]);
+                invMax[axis] = std::max(invMax[axis], invLanes[lane]);
+                meanDir[axis] += packet.dir[axis][lane];
+            }
+        }
+    }
+
+    alignas(32) float tBest[simd::width];
+    for (int lane = 0; lane < simd::width; ++lane) {
+        tBest[lane] = MAXFLOAT;
+    }
+
+    struct StackEntry {
+        int node;
+        int mask;
+    };
+    StackEntry stack[maxDepth];
+    int stackSize = 0;
+    stack[stackSize++] = {0, active};
+
+    while (stackSize > 0) {
+        const StackEntry entry = stack[--stackSize];
+        const BVHNode& node = nodeData[entry.node];
+        RT_STATS(++getThreadCounters().nodeVisits);
+
+        float tFarthest = 0.f;
+        for (int lane = 0; lane < simd::width; ++lane) {
+            if (entry.mask & (1 << lane)) {
+                tFarthest = std::max(tFarthest, tBest[lane]);
+            }
+        }
+
+        //Conservative interval test, if it fails no ray of the packet can enter the box
+        float intervalNear = 0.f;
+        float intervalFar = tFarthest;
+        for (int axis = 0; axis < 3; ++axis) {
+            float lo0, hi0, lo1, hi1;
+            intervalMul(node.bounds.min[axis] - originMax[axis], node.bounds.min[axis] - originMin[axis], invMin[axis], invMax[axis], lo0, hi0);
+            intervalMul(node.bounds.max[axis] - originMax[axis], node.bounds.max[axis] - originMin[axis], invMin[axis], invMax[axis], lo1, hi1);
+            intervalNear = std::max(intervalNear, std::min(lo0, lo1));
+            intervalFar = std::min(intervalFar, std::max(hi0, hi1));
+        }
+        if (intervalNear > intervalFar) {
+            continue;
+        }
+
+        //Exact per lane slab test
+        simd::Float tNear(0.f);
+        simd::Float tFar = simd::Float::load(tBest);
+        for (int axis = 0; axis < 3; ++axis) {
+            const simd::Float t0 = (simd::Float(node.bounds.min[axis]) - r.p0[axis]) * invDir[axis];
+            const simd::Float t1 = (simd::Float(node.bounds.max[axis]) - r.p0[axis]) * invDir[axis];
+            //Keeping the running bound as the second operand lets NaN lanes fall back to it
+            tNear = simd::max(simd::min(t0, t1), tNear);
+            tFar = simd::min(simd::max(t0, t1), tFar);
+        }
+        const int mask = (tNear <= tFar).bits() & entry.mask;
+        if (!mask) {
+            continue;
+        }
+
+        //A single surviving ray is cheaper to finish on its own
+        if (simd::countLanes(mask) == 1) {
+            const int lane = simd::firstLane(mask);
+            const Ray single = packet.getRay(lane);
+            const glm::vec3 singleInvDir = 1.f / single.dir;
+            float tEntry;
+            if (node.bounds.intersects(single.p0, singleInvDir, tBest[lane], tEntry)) {
+                int& id = ids[lane];
+                traverse(entry.node, tEntry, single, singleInvDir, tBest[lane], [&](int first, int count, float& tLeaf) {
+                    triangles.intersect(single, first, count, tLeaf, id);
+                });
+            }
+            continue;
+        }
+
+        if (node.count > 0) {
+            const simd::Mask laneMask = simd::maskFromBits(mask);
+            for (int slot = node.leftFirst; slot < node.leftFirst + node.count; ++slot) {
+                const int id = triangles.getId(slot);
+                simd::Float tTmp;
+                const simd::Mask hit = triangles.intersect(r, slot, laneMask, tTmp);
+                int hitBits = (hit & (tTmp <= simd::Float::load(tBest))).bits();
+                if (!hitBits) {
+                    continue;
+                }
+                alignas(32) float tLanes[simd::width];
+                tTmp.store(tLanes);
+                while (hitBits) {
+                    const int lane = simd::firstLane(hitBits);
+                    hitBits &= hitBits - 1;
+                    if (tLanes[lane] < tBest[lane] || (tLanes[lane] == tBest[lane] && id < ids[lane])) {
+                        tBest[lane] = tLanes[lane];
+                        ids[lane] = id;
+                    }
+                }
+            }
+            continue;
+        }
+
+        //Children are ordered along the mean direction of the packet
+        const BVHNode& left = nodeData[node.leftFirst];
+        const BVHNode& right = nodeData[node.leftFirst + 1];
+        if (glm::dot(left.bounds.getCenter() - right.bounds.getCenter(), meanDir) <= 0.f) {
+            stack[stackSize++] = {node.leftFirst + 1, mask};
+            stack[stackSize++] = {node.leftFirst, mask};
+        }
+        else {
+            stack[stackSize++] = {node.leftFirst, mask};
+            stack[stackSize++] = {node.leftFirst + 1, mask};
+        }
+    }
+
+    for (int lane = 0; lane < simd::width; ++lane) {
+        if (ids[lane] != INT_MAX) {
+            t[lane] = tBest[lane];
+            RT_STATS(++getThreadCounters().hits);
+        }
+    }
+}
+
+const BVHNode* BVH::getNodes() const {
+    return nodeData;
+}
+
+int BVH::getNodeCount() const {
+    return nodeCount;
+}
+
+const int* BVH::getPrimitiveIndices() const {
+    return primitiveIndexData;
+}
+
+const TriangleBuffer& BVH::getTriangles() const {
+    return triangles;
+}
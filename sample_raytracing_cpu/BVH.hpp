@@ -0,0 +1,214 @@
+//
+//  BVH.hpp
+//  Test
+//
+//  Created by Erik Nouroyan on 17.10.26.
+//
+
+#ifndef BVH_hpp
+#define BVH_hpp
+
+#include <memory>
+#include <vector>
+#include "AABB.hpp"
+#include "RenderStats.hpp"
+#include "ThreadPool.hpp"
+#include "TriangleBuffer.hpp"
+
+struct BVHNode {
+    AABB bounds;
+    int leftFirst; //Index of the left child (right one is next to it) or of the first primitive in a leaf
+    int count;     //Number of primitives, 0 for interior nodes
+};
+
+//What BVH::update did to bring the hierarchy up to date
+enum class BVHUpdate {
+    Refit,
+    PartialRebuild,
+    FullRebuild
+};
+
+//Bounding volume hierarchy built with the binned surface area heuristic
+class BVH {
+public:
+    static const int maxDepth = 64;
+
+    //Keeps its own copy of the triangles, reordered so that every leaf is a contiguous range of slots
+    //The boxes and the large subtrees are built on the pool
+    BVH(const TriangleBuffer& triangles, ThreadPool& pool, int maxLeafSize = 4);
+    //Hierarchy over arbitrary boxes, leaves refer to getPrimitiveIndices(), built on the calling thread
+    BVH(const std::vector<AABB>& primitiveBounds, int maxLeafSize = 4);
+    //Prebuilt hierarchy in memory the owner keeps alive, nothing is copied
+    BVH(const BVHNode* nodes, int nodeCount, const int* primitiveIndices, TriangleBuffer triangles, std::shared_ptr<const void> owner);
+    BVH(const BVH& other);
+    BVH(BVH&& other) = default;
+    BVH& operator=(const BVH& other);
+    BVH& operator=(BVH&& other) = default;
+
+    //Returns the id of the closest triangle no farther than tMax (INT_MAX on miss), ties are resolved to the smallest id
+    int intersect(const Ray& r, float& t, float tMax = MAXFLOAT) const;
+    //Any hit closer than tMax, stops at the first one found instead of searching for the closest
+    bool occluded(const Ray& r, float tMax) const;
+    //Closest hit for every active lane of the packet, lanes that diverge from the packet continue as single rays
+    void intersect(const RayPacket& packet, int* ids, float* t) const;
+    //The walks behind intersect and occluded for primitives of any kind, such as those of a hierarchy over arbitrary boxes
+    //leaf(first, count, tBest) tests the leaf's slots first to first + count - 1 and lowers tBest to the closest hit it finds,
+    //the nodes are visited near child first and the ones beyond tBest are skipped
+    template <typename Leaf>
+    void traverse(const Ray& r, float& tBest, Leaf&& leaf) const;
+    //Stops at the first leaf for which leaf(first, count) returns true
+    template <typename Leaf>
+    bool traverseAny(const Ray& r, float tMax, Leaf&& leaf) const;
+
+    //Moves the triangles to their positions in source, which has the slots and ids of the buffer the BVH was built from
+    //Only the node bounds change, the tree keeps its topology however far the triangles moved
+    //Returns false and leaves the BVH untouched when source has a different number of triangles
+    bool refit(const TriangleBuffer& source, ThreadPool& pool);
+    //Refits, then rebuilds the subtrees whose SAH cost grew past rebuildThreshold times their cost when they were built
+    //The whole tree is rebuilt when its root degrades that much or the triangle count changed
+    BVHUpdate update(const TriangleBuffer& source, ThreadPool& pool, float rebuildThreshold = 1.5f);
+    //Expected number of node visits and triangle tests, weighted by area, of a ray that hits the root box
+    float getCost() const;
+
+    const BVHNode* getNodes() const;
+    int getNodeCount() const;
+    //One entry per primitive, slot i of the leaves refers to primitive getPrimitiveIndices()[i]
+    const int* getPrimitiveIndices() const;
+    const TriangleBuffer& getTriangles() const;
+
+private:
+    std::vector<BVHNode> nodes;
+    std::vector<int> primitiveIndices;
+    TriangleBuffer triangles;
+    //Point either at the vectors above or into the owner's memory
+    const BVHNode* nodeData;
+    int nodeCount;
+    const int* primitiveIndexData;
+    std::shared_ptr<const void> owner;
+
+    //The top of the tree is split into subtrees that are refitted and rebuilt independently
+    struct Subtree {
+        int root;
+        int depth;
+        int first;
+        int count;
+        float builtCost;
+    };
+    struct DynamicState {
+        int maxLeafSize = 4;
+        std::vector<Subtree> subtrees;
+        //Nodes above the subtrees, children come before their parents
+        std::vector<int> topNodes;
+        float builtCost = 0.f;
+        //Nodes of replaced subtrees that nothing points at anymore
+        int unusedNodes = 0;
+    };
+    DynamicState dynamic;
+
+    void bindStorage();
+    void prepareDynamic(ThreadPool& pool);
+    void refitNode(int node);
+    void refitTopNodes();
+    float getCost(int node) const;
+    void rebuildSubtree(const Subtree& subtree, const TriangleBuffer& source, std::vector<AABB>& bounds,
+                        std::vector<glm::vec3>& centroids, std::vector<BVHNode>& subtreeNodes);
+
+    //Without a pool the whole tree is built on the calling thread
+    void build(const std::vector<AABB>& primitiveBounds, int maxLeafSize, ThreadPool* pool);
+    template <typename Leaf>
+    void traverse(int root, float rootEntry, const Ray& r, const glm::vec3& invDir, float& tBest, Leaf&& leaf) const;
+};
+
+template <typename Leaf>
+void BVH::traverse(const Ray& r, float& tBest, Leaf&& leaf) const {
+    if (nodeCount == 0) {
+        return;
+    }
+
+    const glm::vec3 invDir = 1.f / r.dir;
+    float tEntry;
+    if (nodeData[0].bounds.intersects(r.p0, invDir, tBest, tEntry)) {
+        traverse(0, tEntry, r, invDir, tBest, leaf);
+    }
+}
+
+template <typename Leaf>
+bool BVH::traverseAny(const Ray& r, float tMax, Leaf&& leaf) const {
+    if (nodeCount == 0) {
+        return false;
+    }
+
+    const glm::vec3 invDir = 1.f / r.dir;
+    int stack[maxDepth];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        const BVHNode& node = nodeData[stack[--stackSize]];
+        RT_STATS(++getThreadCounters().nodeVisits);
+        float tEntry;
+        if (!node.bounds.intersects(r.p0, invDir, tMax, tEntry)) {
+            continue;
+        }
+        if (node.count > 0) {
+            if (leaf(node.leftFirst, node.count)) {
+                return true;
+            }
+            continue;
+        }
+
+        //Any blocker ends the search, so the children are not sorted by distance
+        stack[stackSize++] = node.leftFirst + 1;
+        stack[stackSize++] = node.leftFirst;
+    }
+
+    return false;
+}
+
+template <typename Leaf>
+void BVH::traverse(int root, float rootEntry, const Ray& r, const glm::vec3& invDir, float& tBest, Leaf&& leaf) const {
+    struct StackEntry {
+        int node;
+        float tEntry;
+    };
+    StackEntry stack[maxDepth];
+    int stackSize = 0;
+    stack[stackSize++] = {root, rootEntry};
+
+    while (stackSize > 0) {
+        const StackEntry entry = stack[--stackSize];
+        //Equal distances are still visited so that ties resolve like the linear scan
+        if (entry.tEntry > tBest) {
+            continue;
+        }
+
+        const BVHNode& node = nodeData[entry.node];
+        RT_STATS(++getThreadCounters().nodeVisits);
+        if (node.count > 0) {
+            leaf(node.leftFirst, node.count, tBest);
+            continue;
+        }
+
+        float tLeft, tRight;
+        const bool hitLeft = nodeData[node.leftFirst].bounds.intersects(r.p0, invDir, tBest, tLeft);
+        const bool hitRight = nodeData[node.leftFirst + 1].bounds.intersects(r.p0, invDir, tBest, tRight);
+        if (hitLeft && hitRight) {
+            //Pushing the far child first so the near one is visited next
+            if (tLeft <= tRight) {
+                stack[stackSize++] = {node.leftFirst + 1, tRight};
+                stack[stackSize++] = {node.leftFirst, tLeft};
+            }
+            else {
+                stack[stackSize++] = {node.leftFirst, tLeft};
+                stack[stackSize++] = {node.leftFirst + 1, tRight};
+            }
+        }
+        else if (hitLeft) {
+            stack[stackSize++] = {node.leftFirst, tLeft};
+        }
+        else if (hitRight) {
+            stack[stackSize++] = {node.leftFirst + 1, tRight};
+        }
+    }
+}
+
+#endif /* BVH_hpp */
@@ -0,0 +1,63 @@
+//
+//  CameraPath.cpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#include "CameraPath.hpp"
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+bool loadCameraPath(const std::string& path, int width, int height, std::vector<PerspectiveCamera>& cameras) {
+    std::ifstream in(path);
+    if (!in) {
+        std::cout << "Could not open camera path " << path << std::endl;
+        return false;
+    }
+
+    cameras.clear();
+    std::string line;
+    for (int lineNumber = 1; std::getline(in, line); ++lineNumber) {
+        std::istringstream fields(line);
+        std::string first;
+        if (!(fields >> first) || first[0] == '#') {
+            continue;
+        }
+        fields.seekg(0);
+
+        float values[10] = {0.f, 0.f, 0.f, 0.f, 0.f, -1.f, 0.f, 1.f, 0.f, 90.f};
+        int count = 0;
+        while (count < 10 && fields >> values[count]) {
+            ++count;
+        }
+        if (count != 6 && count != 9 && count != 10) {
+            std::cout << "Camera path " << path << ", line " << lineNumber << ": expected 6, 9 or 10 numbers" << std::endl;
+            return false;
+        }
+        cameras.emplace_back(glm::vec3(values[0], values[1], values[2]), glm::vec3(values[3], values[4], values[5]),
+                             glm::vec3(values[6], values[7], values[8]), values[9], width, height);
+    }
+    if (cameras.empty()) {
+        std::cout << "Camera path " << path << " has no cameras" << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+std::vector<PerspectiveCamera> getOrbitPath(const AABB& bounds, int frameCount, int width, int height) {
+    const glm::vec3 center = bounds.getCenter();
+    //The diagonal is the diameter of a sphere around the box, at that distance the sphere fits into the 90 degree view
+    const float distance = std::max(glm::length(bounds.max - bounds.min), 1e-3f);
+    std::vector<PerspectiveCamera> cameras;
+    for (int i = 0; i < frameCount; ++i) {
+        const float angle = 2 * M_PI * i / frameCount;
+        const glm::vec3 position = center + distance * glm::vec3(std::sin(angle), 0.25f, std::cos(angle));
+        cameras.emplace_back(position, glm::normalize(center - position), glm::vec3(0.f, 1.f, 0.f), 90.f, width, height);
+    }
+
+    return cameras;
+}
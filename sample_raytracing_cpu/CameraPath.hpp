@@ -0,0 +1,22 @@
+//
+//  CameraPath.hpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#ifndef CameraPath_hpp
+#define CameraPath_hpp
+
+#include <string>
+#include <vector>
+#include "AABB.hpp"
+#include "PerspectiveCamera.hpp"
+
+//Reads one camera pose per line: position and front, optionally followed by up and the field of view
+//Empty lines and lines starting with # are skipped, every camera gets the given resolution
+bool loadCameraPath(const std::string& path, int width, int height, std::vector<PerspectiveCamera>& cameras);
+//Circles the box once at a distance that keeps all of it in view, always looking at its center
+std::vector<PerspectiveCamera> getOrbitPath(const AABB& bounds, int frameCount, int width, int height);
+
+#endif /* CameraPath_hpp */
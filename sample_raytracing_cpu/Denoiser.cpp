@@ -0,0 +1,237 @@
+//
+//  Denoiser.cpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#include "Denoiser.hpp"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+//Linear B-spline, the 1D kernel of the à-trous transform
+const float kernel[3] = {1.f / 4, 1.f / 2, 1.f / 4};
+
+//Planes of the padded feature buffer
+enum Plane {
+    NX, NY, NZ,
+    PX, PY, PZ,
+    AX, AY, AZ,
+    InvPixelSize,
+    Coverage,
+    PlaneCount
+};
+
+//Planes of the padded color buffers, the colors and the estimated variance of their error
+enum ColorPlane {
+    Red, Green, Blue,
+    Variance,
+    ColorPlaneCount
+};
+
+//Pass k reaches 2^k pixels out
+const int maxPasses = 16;
+
+//Coverage of the padding, taps on it get no weight
+const float paddingCoverage = -1.f;
+
+//exp(-x) as (1 - x / 16)^16, within 0.02 of it and exactly 0 from x = 16 on, with multiplies only
+inline simd::Float negExp(const simd::Float& x) {
+    simd::Float y = simd::max(simd::Float(0.f), simd::Float(1.f) - x * simd::Float(1.f / 16));
+    y = y * y;
+    y = y * y;
+    y = y * y;
+    return y * y;
+}
+
+}
+
+cv::Mat denoise(const cv::Mat& frame, const FeatureBuffers& features, const PerspectiveCamera& cam, ThreadPool& pool, const DenoiseSettings& settings) {
+    //Features that don't belong to a frame of this size are not used, renderers that don't fill them leave them empty
+    const cv::Size size = frame.size();
+    if (frame.empty() || frame.type() != CV_8UC3 || settings.passes <= 0 || features.coverage.size() != size || features.coverage.type() != CV_32F ||
+        features.depths.size() != size || features.depths.type() != CV_32F || features.normals.size() != size || features.normals.type() != CV_32FC3 ||
+        features.albedo.size() != size || features.albedo.type() != CV_32FC3) {
+        return frame.clone();
+    }
+    //Taps of wider passes would lie beyond any frame
+    const int passes = std::min(settings.passes, maxPasses);
+    const int width = frame.cols;
+    const int height = frame.rows;
+
+    //Every row is padded by the reach of the widest pass, so each tap of each vector is a plain load
+    const int border = 1 << (passes - 1);
+    const int stride = border * 2 + (width + simd::width - 1) / simd::width * simd::width;
+    const size_t planeSize = static_cast<size_t>(stride) * height;
+    std::vector<float> planes(PlaneCount * planeSize, 0.f);
+    std::fill(planes.begin() + AX * planeSize, planes.begin() + (AZ + 1) * planeSize, 1.f);
+    std::fill(planes.begin() + Coverage * planeSize, planes.begin() + (Coverage + 1) * planeSize, paddingCoverage);
+    std::vector<float> colors(ColorPlaneCount * planeSize, 0.f);
+    std::vector<float> filtered(ColorPlaneCount * planeSize, 0.f);
+
+    //Positions are rebuilt from the depths, the plane distance is measured in pixel widths at the pixel's own distance
+    const RayGenerator rays(cam);
+    const float pixelAngle = rays.getPixelAngle();
+    pool.parallelFor(height, [&](int i) {
+        for (int j = 0; j < width; ++j) {
+            const size_t p = static_cast<size_t>(i) * stride + border + j;
+            const Color& color = frame.at<Color>(i, j);
+            const cv::Vec3f& albedo = features.albedo.at<cv::Vec3f>(i, j);
+            for (int c = 0; c < 3; ++c) {
+                colors[(Red + c) * planeSize + p] = color[c];
+                planes[(AX + c) * planeSize + p] = std::max(albedo[c], 1.f);
+            }
+            const float coverage = features.coverage.at<float>(i, j);
+            planes[Coverage * planeSize + p] = coverage;
+            if (coverage == 0.f) {
+                continue;
+            }
+            const float t = features.depths.at<float>(i, j);
+            const Ray r = rays.getRay(i, j);
+            const glm::vec3 position = r.p0 + r.dir * t;
+            const cv::Vec3f& normal = features.normals.at<cv::Vec3f>(i, j);
+            for (int axis = 0; axis < 3; ++axis) {
+                planes[(NX + axis) * planeSize + p] = normal[axis];
+                planes[(PX + axis) * planeSize + p] = position[axis];
+            }
+            planes[InvPixelSize * planeSize + p] = 1.f / std::max(t * pixelAngle, 1e-12f);
+        }
+    });
+
+    auto load = [&](const std::vector<float>& data, int plane, size_t index) {
+        return simd::Float::load(data.data() + plane * planeSize + index);
+    };
+    auto isOnImage = [&](size_t index) {
+        return load(planes, Coverage, index) >= simd::Float(0.f);
+    };
+
+    //The error of a pixel comes from the edges that cross it, they show as a spread of the colors around it
+    //A neighbour the features put on the same surface is compared by its lighting alone, the texture's detail is no error
+    //With stratified samples the squared error at an edge falls with the sample count to the power of 1.5
+    const simd::Float normalScale(1.f / (settings.normalSigma * settings.normalSigma));
+    const simd::Float planeScale(1.f / (settings.planeSigma * settings.planeSigma));
+    const simd::Float coverageScale(1.f / (settings.coverageSigma * settings.coverageSigma));
+    const simd::Float sampleScale(1.f / std::pow(static_cast<float>(std::max(features.samples, 1)), 1.5f));
+    pool.parallelFor(height, [&](int i) {
+        for (int j = 0; j < width; j += simd::width) {
+            const size_t p = static_cast<size_t>(i) * stride + border + j;
+            simd::Float normal[3];
+            simd::Float position[3];
+            simd::Float albedo[3];
+            for (int axis = 0; axis < 3; ++axis) {
+                normal[axis] = load(planes, NX + axis, p);
+                position[axis] = load(planes, PX + axis, p);
+                albedo[axis] = load(planes, AX + axis, p);
+            }
+            const simd::Float invPixelSize = load(planes, InvPixelSize, p);
+            const simd::Float coverage = load(planes, Coverage, p);
+
+            simd::Float sum[3] = {0.f, 0.f, 0.f};
+            simd::Float sumSquares[3] = {0.f, 0.f, 0.f};
+            simd::Float count(0.f);
+            for (int y = std::max(i - 1, 0); y <= std::min(i + 1, height - 1); ++y) {
+                for (int dx = -1; dx <= 1; ++dx) {
+                    const size_t q = static_cast<size_t>(y) * stride + border + j + dx;
+                    simd::Float normalDistance(0.f);
+                    simd::Float planeDistance(0.f);
+                    for (int axis = 0; axis < 3; ++axis) {
+                        const simd::Float dn = load(planes, NX + axis, q) - normal[axis];
+                        normalDistance = normalDistance + dn * dn;
+                        planeDistance = planeDistance + (load(planes, PX + axis, q) - position[axis]) * normal[axis];
+                    }
+                    planeDistance = planeDistance * invPixelSize;
+                    const simd::Float coverageDistance = load(planes, Coverage, q) - coverage;
+                    const simd::Float sameSurface = negExp(normalDistance * normalScale + planeDistance * planeDistance * planeScale +
+                                                           coverageDistance * coverageDistance * coverageScale);
+                    const simd::Float valid = simd::select(isOnImage(q), simd::Float(1.f), simd::Float(0.f));
+                    for (int c = 0; c < 3; ++c) {
+                        const simd::Float color = load(colors, Red + c, q);
+                        const simd::Float lit = color * albedo[c] / load(planes, AX + c, q);
+                        const simd::Float compared = (color + (lit - color) * sameSurface) * valid;
+                        sum[c] = sum[c] + compared;
+                        sumSquares[c] = sumSquares[c] + compared * compared;
+                    }
+                    count = count + valid;
+                }
+            }
+            //Sum of the three channels' variances around their means, only the lanes past the image's right side count nothing
+            count = simd::max(count, simd::Float(1.f));
+            simd::Float spread(0.f);
+            for (int c = 0; c < 3; ++c) {
+                const simd::Float mean = sum[c] / count;
+                spread = spread + simd::max(simd::Float(0.f), sumSquares[c] / count - mean * mean);
+            }
+            (spread * sampleScale).store(colors.data() + Variance * planeSize + p);
+        }
+    });
+
+    //A tap counts by how small its color difference is next to the pixel's error, with a heavy tail so that an edge the pixel straddles
+    //is blended in by a share that follows the error and not the contrast. The error is carried through the passes along with the colors
+    //and the wider passes weigh it less, their taps lie farther from the pixel, so each pass only takes out what the ones before it left
+    const simd::Float minVariance(settings.minVariance);
+    for (int pass = 0; pass < passes; ++pass) {
+        const int step = 1 << pass;
+        const simd::Float passScale(settings.colorSigma * settings.colorSigma / (static_cast<float>(step) * step * step * step));
+        pool.parallelFor(height, [&](int i) {
+            for (int j = 0; j < width; j += simd::width) {
+                const size_t p = static_cast<size_t>(i) * stride + border + j;
+                simd::Float color[3];
+                for (int c = 0; c < 3; ++c) {
+                    color[c] = load(colors, Red + c, p);
+                }
+                const simd::Float spread = passScale * load(colors, Variance, p) + minVariance;
+
+                simd::Float sum[3] = {0.f, 0.f, 0.f};
+                simd::Float varianceSum(0.f);
+                simd::Float weightSum(0.f);
+                for (int dy = -1; dy <= 1; ++dy) {
+                    const int y = i + dy * step;
+                    if (y < 0 || y >= height) {
+                        continue;
+                    }
+                    for (int dx = -1; dx <= 1; ++dx) {
+                        const size_t q = static_cast<size_t>(y) * stride + border + j + dx * step;
+                        simd::Float tapColor[3];
+                        simd::Float colorDistance(0.f);
+                        for (int c = 0; c < 3; ++c) {
+                            tapColor[c] = load(colors, Red + c, q);
+                            const simd::Float dc = tapColor[c] - color[c];
+                            colorDistance = colorDistance + dc * dc;
+                        }
+                        //Taps on the padding get no weight, the center always does so that the padding keeps finite values
+                        const simd::Float tapKernel = dx == 0 && dy == 0 ? simd::Float(kernel[1] * kernel[1]) :
+                                                      simd::select(isOnImage(q), simd::Float(kernel[dy + 1] * kernel[dx + 1]), simd::Float(0.f));
+                        const simd::Float weight = spread / (spread + colorDistance) * tapKernel;
+                        for (int c = 0; c < 3; ++c) {
+                            sum[c] = sum[c] + tapColor[c] * weight;
+                        }
+                        varianceSum = varianceSum + load(colors, Variance, q) * weight * weight;
+                        weightSum = weightSum + weight;
+                    }
+                }
+                //The center tap has a weight of at least a quarter, so the sum of the weights is never 0
+                for (int c = 0; c < 3; ++c) {
+                    (sum[c] / weightSum).store(filtered.data() + (Red + c) * planeSize + p);
+                }
+                (varianceSum / (weightSum * weightSum)).store(filtered.data() + Variance * planeSize + p);
+            }
+        });
+        colors.swap(filtered);
+    }
+
+    cv::Mat result(height, width, CV_8UC3);
+    pool.parallelFor(height, [&](int i) {
+        for (int j = 0; j < width; ++j) {
+            const size_t p = static_cast<size_t>(i) * stride + border + j;
+            Color& color = result.at<Color>(i, j);
+            for (int c = 0; c < 3; ++c) {
+                color[c] = static_cast<unsigned char>(std::min(std::max(colors[(Red + c) * planeSize + p] + 0.5f, 0.f), 255.f));
+            }
+        }
+    });
+
+    return result;
+}
@@ -0,0 +1,39 @@
+//
+//  Denoiser.hpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#ifndef Denoiser_hpp
+#define Denoiser_hpp
+
+#include <opencv2/opencv.hpp>
+#include "PerspectiveCamera.hpp"
+#include "RayTracer.hpp"
+#include "ThreadPool.hpp"
+
+struct DenoiseSettings {
+    //Pass k spaces its 3x3 taps 2^k pixels apart, at 1 to 4 samples per pixel the error sits right at the edges and the first pass does the work
+    //At most 16 passes are run
+    int passes = 1;
+    //Color difference, in standard deviations of the pixel's estimated error, at which a tap gets half of its kernel weight
+    float colorSigma = 2.f;
+    //Error variance every pixel is taken to have, in 0-255 units, keeps the colors of a clean pixel's neighbours out of it
+    float minVariance = 1.f;
+    //Falloff of the weights that tell whether a neighbour lies on the pixel's surface: the distance between the normals, the distance
+    //from the pixel's tangent plane in pixel widths and the difference of the coverage
+    float normalSigma = 0.3f;
+    float planeSigma = 1.f;
+    float coverageSigma = 0.3f;
+};
+
+//À-trous wavelet filter for frames of a few samples per pixel, features are the primary hits the frame was rendered from.
+//Each pixel's error is estimated from the colors around it, with the texture of its own surface taken out, and a tap is blended
+//in by how small its color difference is next to that error, so clean pixels keep their detail and aliased edges are smoothed.
+//Every pass filters simd::width pixels of a row at once and splits the rows between the pool's threads.
+//The frame comes back unfiltered when the features are missing or of another size, as after a wavefront, hybrid or adaptive render
+cv::Mat denoise(const cv::Mat& frame, const FeatureBuffers& features, const PerspectiveCamera& cam, ThreadPool& pool,
+                const DenoiseSettings& settings = DenoiseSettings());
+
+#endif /* Denoiser_hpp */
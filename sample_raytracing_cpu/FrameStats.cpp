@@ -0,0 +1,55 @@
+//
+//  FrameStats.cpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#include "FrameStats.hpp"
+#include <algorithm>
+
+namespace {
+
+//Blue, cyan, green, yellow, red at equal steps, interpolated in between
+cv::Vec3b getFalseColor(float value) {
+    static const float stops[5][3] = {{255.f, 0.f, 0.f}, {255.f, 255.f, 0.f}, {0.f, 255.f, 0.f}, {0.f, 255.f, 255.f}, {0.f, 0.f, 255.f}};
+    const float position = std::min(std::max(value, 0.f), 1.f) * 4.f;
+    const int low = std::min(static_cast<int>(position), 3);
+    const float blend = position - low;
+    cv::Vec3b color;
+    for (int c = 0; c < 3; ++c) {
+        color[c] = static_cast<unsigned char>(stops[low][c] + (stops[low + 1][c] - stops[low][c]) * blend + 0.5f);
+    }
+
+    return color;
+}
+
+}
+
+const TileStats* FrameStats::getSlowestTile() const {
+    const TileStats* slowest = nullptr;
+    for (const TileStats& tile : tiles) {
+        if (!slowest || tile.counters.getCost() > slowest->counters.getCost()) {
+            slowest = &tile;
+        }
+    }
+
+    return slowest;
+}
+
+cv::Mat getCostHeatmap(const cv::Mat& pixelCosts) {
+    cv::Mat heatmap(pixelCosts.rows, pixelCosts.cols, CV_8UC3);
+    int maxCost = 1;
+    for (int i = 0; i < pixelCosts.rows; ++i) {
+        for (int j = 0; j < pixelCosts.cols; ++j) {
+            maxCost = std::max(maxCost, pixelCosts.at<int>(i, j));
+        }
+    }
+    for (int i = 0; i < pixelCosts.rows; ++i) {
+        for (int j = 0; j < pixelCosts.cols; ++j) {
+            heatmap.at<cv::Vec3b>(i, j) = getFalseColor(static_cast<float>(pixelCosts.at<int>(i, j)) / maxCost);
+        }
+    }
+
+    return heatmap;
+}
@@ -0,0 +1,35 @@
+//
+//  FrameStats.hpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#ifndef FrameStats_hpp
+#define FrameStats_hpp
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "RenderStats.hpp"
+
+struct TileStats {
+    cv::Rect tile;
+    TraversalCounters counters;
+};
+
+//What the traversal of one frame did, filled by the tiled renderers in builds with RT_ENABLE_STATS
+struct FrameStats {
+    TraversalCounters total;
+    //In the order the tiles are laid out over the frame, row by row
+    std::vector<TileStats> tiles;
+    //Cost of every pixel summed over its samples (CV_32S), packets share their cost evenly between their pixels
+    cv::Mat pixelCosts;
+
+    //The tile with the highest cost, nullptr when there are none
+    const TileStats* getSlowestTile() const;
+};
+
+//False colors from blue for the cheapest to red for the most expensive pixel, scaled to the frame's maximum
+cv::Mat getCostHeatmap(const cv::Mat& pixelCosts);
+
+#endif /* FrameStats_hpp */
@@ -0,0 +1,72 @@
+//
+//  FrameWriter.cpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#include "FrameWriter.hpp"
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+FrameWriter::FrameWriter(int capacity) : capacity(std::max(1, capacity)), finishing(false), failedCount(0), blockedSeconds(0.) {
+    thread = std::thread(&FrameWriter::writeLoop, this);
+}
+
+FrameWriter::~FrameWriter() {
+    finish();
+}
+
+void FrameWriter::push(const std::string& path, const cv::Mat& frame) {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (static_cast<int>(queue.size()) >= capacity) {
+        const auto start = std::chrono::steady_clock::now();
+        freedCondition.wait(lock, [this]() { return static_cast<int>(queue.size()) < capacity; });
+        const std::chrono::duration<double> waited = std::chrono::steady_clock::now() - start;
+        blockedSeconds += waited.count();
+    }
+    queue.push_back({path, frame});
+    lock.unlock();
+    queuedCondition.notify_one();
+}
+
+int FrameWriter::finish() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finishing = true;
+    }
+    queuedCondition.notify_one();
+    if (thread.joinable()) {
+        thread.join();
+    }
+
+    return failedCount;
+}
+
+double FrameWriter::getBlockedSeconds() const {
+    return blockedSeconds;
+}
+
+void FrameWriter::writeLoop() {
+    while (true) {
+        PendingFrame frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            queuedCondition.wait(lock, [this]() { return finishing || !queue.empty(); });
+            if (queue.empty()) {
+                return;
+            }
+            frame = std::move(queue.front());
+            queue.pop_front();
+        }
+        freedCondition.notify_one();
+
+        //The slot is given back before encoding, so the queue bounds the frames waiting, not the one being written
+        if (!cv::imwrite(frame.path, frame.image)) {
+            std::cout << "Could not write " << frame.path << std::endl;
+            std::lock_guard<std::mutex> lock(mutex);
+            ++failedCount;
+        }
+    }
+}
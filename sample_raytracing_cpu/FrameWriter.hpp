@@ -0,0 +1,53 @@
+//
+//  FrameWriter.hpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#ifndef FrameWriter_hpp
+#define FrameWriter_hpp
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <opencv2/opencv.hpp>
+
+//Encodes and writes frames on a background thread, so rendering the next frame overlaps writing the last one
+//At most capacity frames wait in the queue, push() blocks until there is room
+class FrameWriter {
+public:
+    explicit FrameWriter(int capacity = 2);
+    ~FrameWriter();
+    FrameWriter(const FrameWriter&) = delete;
+    FrameWriter& operator=(const FrameWriter&) = delete;
+
+    //The format follows the extension of the path, the writer keeps a reference to the frame so it must not be drawn into afterwards
+    void push(const std::string& path, const cv::Mat& frame);
+    //Waits until every queued frame is written and stops the thread, returns the number of frames that could not be written
+    int finish();
+    //Time push() spent waiting for room in the queue
+    double getBlockedSeconds() const;
+
+private:
+    struct PendingFrame {
+        std::string path;
+        cv::Mat image;
+    };
+
+    const int capacity;
+    std::deque<PendingFrame> queue;
+    std::mutex mutex;
+    std::condition_variable queuedCondition;
+    std::condition_variable freedCondition;
+    bool finishing;
+    int failedCount;
+    double blockedSeconds;
+    std::thread thread;
+
+    void writeLoop();
+};
+
+#endif /* FrameWriter_hpp */
@@ -0,0 +1,129 @@
+//
+//  InstancedScene.cpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#include "InstancedScene.hpp"
+
+InstancedScene::InstancedScene() : topLevel(std::vector<AABB>()) {}
+
+int InstancedScene::addMesh(const TriangleBuffer& triangles, ThreadPool& pool) {
+    //The ids are replaced by the slots so that a hit can be traced back to the source buffer
+    TriangleBuffer numbered;
+    numbered.resize(triangles.size());
+    for (int i = 0; i < triangles.size(); ++i) {
+        numbered.setTriangle(i, triangles.getVertex(i, 0), triangles.getVertex(i, 1), triangles.getVertex(i, 2), triangles.getColor(i), i);
+    }
+    meshes.emplace_back(numbered, pool);
+
+    const int* order = meshes.back().getPrimitiveIndices();
+    std::vector<int> slots(triangles.size());
+    for (int slot = 0; slot < triangles.size(); ++slot) {
+        slots[order[slot]] = slot;
+    }
+    meshSlots.push_back(std::move(slots));
+
+    return static_cast<int>(meshes.size()) - 1;
+}
+
+int InstancedScene::addInstance(int mesh, const glm::mat4& transform) {
+    const glm::mat4 inverseTransform = glm::inverse(transform);
+    instances.push_back({mesh, transform, inverseTransform, glm::transpose(glm::mat3(inverseTransform))});
+
+    return static_cast<int>(instances.size()) - 1;
+}
+
+void InstancedScene::build() {
+    //World bounds of an instance are the transformed corners of its mesh's root box
+    std::vector<AABB> bounds(instances.size());
+    for (size_t i = 0; i < instances.size(); ++i) {
+        const BVH& mesh = meshes[instances[i].mesh];
+        if (mesh.getNodeCount() == 0) {
+            continue;
+        }
+        const AABB& local = mesh.getNodes()[0].bounds;
+        for (int corner = 0; corner < 8; ++corner) {
+            const glm::vec4 p(corner & 1 ? local.max.x : local.min.x, corner & 2 ? local.max.y : local.min.y, corner & 4 ? local.max.z : local.min.z, 1.f);
+            bounds[i].grow(glm::vec3(instances[i].transform * p));
+        }
+    }
+    topLevel = BVH(bounds, 1);
+}
+
+Ray InstancedScene::toObjectSpace(const Ray& r, const Instance& instance) const {
+    return {glm::vec3(instance.inverseTransform * glm::vec4(r.p0, 1.f)), glm::mat3(instance.inverseTransform) * r.dir};
+}
+
+bool InstancedScene::intersect(const Ray& r, InstanceHit& hit) const {
+    const int* primitives = topLevel.getPrimitiveIndices();
+    float tBest = MAXFLOAT;
+    int bestInstance = INT_MAX;
+    int bestTriangle = INT_MAX;
+    topLevel.traverse(r, tBest, [&](int first, int count, float&) {
+        for (int i = first; i < first + count; ++i) {
+            const int index = primitives[i];
+            const Instance& instance = instances[index];
+            float t;
+            const int triangle = meshes[instance.mesh].intersect(toObjectSpace(r, instance), t, tBest);
+            //The mesh only reports hits up to tBest, equal ones go to the smaller instance
+            if (triangle != INT_MAX && (t < tBest || index < bestInstance || (index == bestInstance && triangle < bestTriangle))) {
+                tBest = t;
+                bestInstance = index;
+                bestTriangle = triangle;
+            }
+        }
+    });
+
+    if (bestInstance == INT_MAX) {
+        return false;
+    }
+    hit.t = tBest;
+    hit.instance = bestInstance;
+    hit.triangle = bestTriangle;
+
+    return true;
+}
+
+bool InstancedScene::occluded(const Ray& r, float tMax) const {
+    const int* primitives = topLevel.getPrimitiveIndices();
+    return topLevel.traverseAny(r, tMax, [&](int first, int count) {
+        for (int i = first; i < first + count; ++i) {
+            const Instance& instance = instances[primitives[i]];
+            if (meshes[instance.mesh].occluded(toObjectSpace(r, instance), tMax)) {
+                return true;
+            }
+        }
+        return false;
+    });
+}
+
+glm::vec3 InstancedScene::getNormal(const InstanceHit& hit) const {
+    const Instance& instance = instances[hit.instance];
+    const glm::vec3 normal = meshes[instance.mesh].getTriangles().getNormal(meshSlots[instance.mesh][hit.triangle]);
+
+    return glm::normalize(instance.normalTransform * normal);
+}
+
+Color InstancedScene::getColor(const InstanceHit& hit) const {
+    const Instance& instance = instances[hit.instance];
+
+    return meshes[instance.mesh].getTriangles().getColor(meshSlots[instance.mesh][hit.triangle]);
+}
+
+int InstancedScene::getMeshCount() const {
+    return static_cast<int>(meshes.size());
+}
+
+int InstancedScene::getInstanceCount() const {
+    return static_cast<int>(instances.size());
+}
+
+const BVH& InstancedScene::getMesh(int mesh) const {
+    return meshes[mesh];
+}
+
+const Instance& InstancedScene::getInstance(int instance) const {
+    return instances[instance];
+}
@@ -0,0 +1,66 @@
+//
+//  InstancedScene.hpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#ifndef InstancedScene_hpp
+#define InstancedScene_hpp
+
+#include <climits>
+#include <vector>
+#include <glm/mat3x3.hpp>
+#include <glm/mat4x4.hpp>
+#include "BVH.hpp"
+
+struct Instance {
+    int mesh;
+    glm::mat4 transform;
+    glm::mat4 inverseTransform;
+    //Inverse transpose, takes object space normals to world space
+    glm::mat3 normalTransform;
+};
+
+struct InstanceHit {
+    float t = MAXFLOAT;
+    int instance = INT_MAX;
+    //Slot of the triangle in the buffer its mesh was added from
+    int triangle = INT_MAX;
+};
+
+//Two-level scene, every mesh has its own BVH and a top-level BVH is built over the transformed instance bounds
+//Memory grows with the unique meshes, an instance only stores its transforms
+class InstancedScene {
+public:
+    InstancedScene();
+    //Builds the bottom-level BVH of the mesh on the pool, the returned id is what instances refer to
+    int addMesh(const TriangleBuffer& triangles, ThreadPool& pool);
+    int addInstance(int mesh, const glm::mat4& transform);
+    //Rebuilds the top-level BVH, needed after instances were added
+    void build();
+
+    //Closest hit, equal distances are resolved to the smallest instance and then to the smallest triangle id
+    bool intersect(const Ray& r, InstanceHit& hit) const;
+    bool occluded(const Ray& r, float tMax) const;
+    //World space normal of the hit triangle
+    glm::vec3 getNormal(const InstanceHit& hit) const;
+    Color getColor(const InstanceHit& hit) const;
+
+    int getMeshCount() const;
+    int getInstanceCount() const;
+    const BVH& getMesh(int mesh) const;
+    const Instance& getInstance(int instance) const;
+
+private:
+    std::vector<BVH> meshes;
+    //Per mesh, where each triangle of the source buffer ended up in the BVH's reordered copy
+    std::vector<std::vector<int>> meshSlots;
+    std::vector<Instance> instances;
+    BVH topLevel;
+
+    //Ray in the object space of the instance, the direction isn't renormalized so distances stay the same in both spaces
+    Ray toObjectSpace(const Ray& r, const Instance& instance) const;
+};
+
+#endif /* InstancedScene_hpp */
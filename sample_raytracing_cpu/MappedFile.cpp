@@ -0,0 +1,48 @@
+//
+//  MappedFile.cpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#include "MappedFile.hpp"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const std::string& path, bool sequential) : data(nullptr), size(0) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped != MAP_FAILED) {
+            data = static_cast<const char*>(mapped);
+            size = info.st_size;
+            madvise(mapped, size, sequential ? MADV_SEQUENTIAL : MADV_WILLNEED);
+        }
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (data) {
+        munmap(const_cast<char*>(data), size);
+    }
+}
+
+bool MappedFile::isOpen() const {
+    return data != nullptr;
+}
+
+const char* MappedFile::getData() const {
+    return data;
+}
+
+size_t MappedFile::getSize() const {
+    return size;
+}
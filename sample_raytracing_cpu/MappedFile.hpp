@@ -0,0 +1,32 @@
+//
+//  MappedFile.hpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#ifndef MappedFile_hpp
+#define MappedFile_hpp
+
+#include <cstddef>
+#include <string>
+
+//Read-only memory mapping of a whole file, unmapped when the object goes away
+class MappedFile {
+public:
+    //Sequential mappings are read ahead as they are walked, the others are prefetched as a whole for random access
+    explicit MappedFile(const std::string& path, bool sequential = true);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isOpen() const;
+    const char* getData() const;
+    size_t getSize() const;
+
+private:
+    const char* data;
+    size_t size;
+};
+
+#endif /* MappedFile_hpp */
@@ -0,0 +1,701 @@
+//
+//  MeshLoader.cpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#include "MeshLoader.hpp"
+#include "MappedFile.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <sys/resource.h>
+
+namespace {
+
+inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+inline const char* skipSpaces(const char* p, const char* end) {
+    while (p < end && isSpace(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+inline const char* skipToken(const char* p, const char* end) {
+    while (p < end && !isSpace(*p) && *p != '\n') {
+        ++p;
+    }
+    return p;
+}
+
+inline const char* nextLine(const char* p, const char* end) {
+    const char* newline = static_cast<const char*>(memchr(p, '\n', end - p));
+    return newline ? newline + 1 : end;
+}
+
+//Bounded replacement for strtof, the mapping is not null terminated
+bool parseFloat(const char*& p, const char* end, float& value) {
+    static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18};
+    p = skipSpaces(p, end);
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+
+    double mantissa = 0.0;
+    int exponent = 0;
+    bool digits = false;
+    for (; p < end && isDigit(*p); ++p) {
+        mantissa = mantissa * 10.0 + (*p - '0');
+        digits = true;
+    }
+    if (p < end && *p == '.') {
+        for (++p; p < end && isDigit(*p); ++p) {
+            mantissa = mantissa * 10.0 + (*p - '0');
+            --exponent;
+            digits = true;
+        }
+    }
+    if (!digits) {
+        return false;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        ++p;
+        bool negativeExponent = false;
+        if (p < end && (*p == '-' || *p == '+')) {
+            negativeExponent = *p == '-';
+            ++p;
+        }
+        int e = 0;
+        for (; p < end && isDigit(*p); ++p) {
+            e = std::min(e * 10 + (*p - '0'), 1000);
+        }
+        exponent += negativeExponent ? -e : e;
+    }
+
+    const int magnitude = std::abs(exponent);
+    const double scale = magnitude <= 18 ? powers[magnitude] : std::pow(10.0, magnitude);
+    const double result = exponent < 0 ? mantissa / scale : mantissa * scale;
+    value = static_cast<float>(negative ? -result : result);
+
+    return true;
+}
+
+bool parseInt(const char*& p, const char* end, long& value) {
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+    if (p >= end || !isDigit(*p)) {
+        return false;
+    }
+    long result = 0;
+    for (; p < end && isDigit(*p); ++p) {
+        result = result * 10 + (*p - '0');
+    }
+    value = negative ? -result : result;
+
+    return true;
+}
+
+inline bool isKeyword(const char* p, const char* end, char keyword) {
+    return p + 1 < end && p[0] == keyword && isSpace(p[1]);
+}
+
+inline bool isTexCoordKeyword(const char* p, const char* end) {
+    return p + 2 < end && p[0] == 'v' && p[1] == 't' && isSpace(p[2]);
+}
+
+//Files put v = 0 at the bottom of the image, textures at the top row
+inline TexCoord toTextureSpace(float u, float v) {
+    return TexCoord(u, 1.f - v);
+}
+
+struct TextChunk {
+    const char* begin;
+    const char* end;
+    int vertexOffset;
+    int triangleOffset;
+    int texCoordOffset;
+    int vertexCount;
+    int triangleCount;
+    int texCoordCount;
+};
+
+//PLY scalar types, the value is the size in bytes
+enum PlyType {
+    PlyInvalid = 0,
+    PlyInt8 = 1,
+    PlyInt16 = 2,
+    PlyInt32 = 4,
+    PlyFloat64 = 8,
+    PlyUInt8 = 16 | 1,
+    PlyUInt16 = 16 | 2,
+    PlyUInt32 = 16 | 4,
+    PlyFloat32 = 32 | 4
+};
+
+PlyType getPlyType(const std::string& name) {
+    if (name == "char" || name == "int8") return PlyInt8;
+    if (name == "uchar" || name == "uint8") return PlyUInt8;
+    if (name == "short" || name == "int16") return PlyInt16;
+    if (name == "ushort" || name == "uint16") return PlyUInt16;
+    if (name == "int" || name == "int32") return PlyInt32;
+    if (name == "uint" || name == "uint32") return PlyUInt32;
+    if (name == "float" || name == "float32") return PlyFloat32;
+    if (name == "double" || name == "float64") return PlyFloat64;
+    return PlyInvalid;
+}
+
+inline int getPlySize(PlyType type) {
+    return type & 15;
+}
+
+double readPlyScalar(const char* p, PlyType type, bool swap) {
+    unsigned char bytes[8];
+    const int size = getPlySize(type);
+    for (int i = 0; i < size; ++i) {
+        bytes[i] = p[swap ? size - 1 - i : i];
+    }
+    switch (type) {
+        case PlyInt8: { int8_t v; memcpy(&v, bytes, 1); return v; }
+        case PlyUInt8: { uint8_t v; memcpy(&v, bytes, 1); return v; }
+        case PlyInt16: { int16_t v; memcpy(&v, bytes, 2); return v; }
+        case PlyUInt16: { uint16_t v; memcpy(&v, bytes, 2); return v; }
+        case PlyInt32: { int32_t v; memcpy(&v, bytes, 4); return v; }
+        case PlyUInt32: { uint32_t v; memcpy(&v, bytes, 4); return v; }
+        case PlyFloat32: { float v; memcpy(&v, bytes, 4); return v; }
+        case PlyFloat64: { double v; memcpy(&v, bytes, 8); return v; }
+        default: return 0.0;
+    }
+}
+
+struct PlyProperty {
+    std::string name;
+    PlyType type = PlyInvalid;
+    PlyType countType = PlyInvalid; //Set for list properties
+};
+
+struct PlyElement {
+    std::string name;
+    long count = 0;
+    std::vector<PlyProperty> properties;
+};
+
+//Chunk c filled slots begins[c] to ends[c] - 1 and left the rest of its range to the faces it dropped
+//The filled ranges are moved together in order and the triangles are numbered by their new slots
+void compactChunks(TriangleBuffer& triangles, const std::vector<int>& begins, const std::vector<int>& ends, ThreadPool& pool) {
+    std::vector<int> targets(begins.size());
+    int count = 0;
+    for (size_t c = 0; c < begins.size(); ++c) {
+        targets[c] = count;
+        count += ends[c] - begins[c];
+    }
+    if (count == triangles.size()) {
+        return;
+    }
+
+    TriangleBuffer compacted;
+    compacted.resize(count);
+    pool.parallelFor(static_cast<int>(begins.size()), [&](int c) {
+        for (int slot = begins[c]; slot < ends[c]; ++slot) {
+            const int target = targets[c] + slot - begins[c];
+            compacted.copySlot(target, triangles, slot);
+            compacted.setId(target, target);
+        }
+    });
+    triangles = std::move(compacted);
+}
+
+long getPeakResidentKilobytes() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+}
+
+MeshLoader::MeshLoader(ThreadPool& pool) : pool(pool) {}
+
+const MeshLoadStats& MeshLoader::getStats() const {
+    return stats;
+}
+
+int MeshLoader::getChunkCount() const {
+    //Several chunks per worker so that stealing can even out dense and sparse parts of the file
+    return pool.getThreadCount() * 8;
+}
+
+bool MeshLoader::load(const std::string& path, TriangleBuffer& triangles, const Color& color) {
+    const auto start = std::chrono::steady_clock::now();
+    stats = MeshLoadStats();
+
+    MappedFile file(path);
+    if (!file.isOpen()) {
+        std::cout << "Could not open " << path << std::endl;
+        return false;
+    }
+
+    std::string extension = path.substr(path.find_last_of('.') + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    bool loaded = false;
+    if (extension == "obj") {
+        loaded = loadOBJ(file.getData(), file.getSize(), triangles, color);
+    }
+    else if (extension == "ply") {
+        loaded = loadPLY(file.getData(), file.getSize(), triangles, color);
+    }
+    else {
+        std::cout << "Unsupported mesh format: " << path << std::endl;
+    }
+
+    stats.triangleCount = loaded ? triangles.size() : 0;
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    stats.peakResidentKilobytes = getPeakResidentKilobytes();
+
+    return loaded;
+}
+
+bool MeshLoader::loadOBJ(const char* data, size_t size, TriangleBuffer& triangles, const Color& color) {
+    const char* fileEnd = data + size;
+
+    //Chunk boundaries are moved to the next line start so that no line is split
+    const int chunkCount = getChunkCount();
+    std::vector<TextChunk> chunks;
+    const char* previous = data;
+    for (int c = 1; c <= chunkCount; ++c) {
+        const char* boundary = c == chunkCount ? fileEnd : nextLine(std::max(previous, data + size * c / chunkCount), fileEnd);
+        if (boundary > previous) {
+            chunks.push_back({previous, boundary, 0, 0, 0, 0, 0, 0});
+            previous = boundary;
+        }
+    }
+
+    //Pass 1: counting vertices, texture coordinates and fan triangles per chunk
+    pool.parallelFor(static_cast<int>(chunks.size()), [&](int c) {
+        TextChunk& chunk = chunks[c];
+        for (const char* p = chunk.begin; p < chunk.end; p = nextLine(p, chunk.end)) {
+            const char* line = skipSpaces(p, chunk.end);
+            if (isKeyword(line, chunk.end, 'v')) {
+                ++chunk.vertexCount;
+            }
+            else if (isTexCoordKeyword(line, chunk.end)) {
+                ++chunk.texCoordCount;
+            }
+            else if (isKeyword(line, chunk.end, 'f')) {
+                //A trailing comment ends the face, its words are not corners
+                int corners = 0;
+                for (const char* q = skipSpaces(line + 1, chunk.end); q < chunk.end && *q != '\n' && *q != '#'; q = skipSpaces(skipToken(q, chunk.end), chunk.end)) {
+                    ++corners;
+                }
+                chunk.triangleCount += std::max(0, corners - 2);
+            }
+        }
+    });
+
+    int vertexCount = 0;
+    int triangleCount = 0;
+    int texCoordCount = 0;
+    for (TextChunk& chunk : chunks) {
+        chunk.vertexOffset = vertexCount;
+        chunk.triangleOffset = triangleCount;
+        chunk.texCoordOffset = texCoordCount;
+        vertexCount += chunk.vertexCount;
+        triangleCount += chunk.triangleCount;
+        texCoordCount += chunk.texCoordCount;
+    }
+    stats.vertexCount = vertexCount;
+
+    //Pass 2: vertex positions and texture coordinates
+    std::vector<glm::vec3> positions(vertexCount);
+    std::vector<TexCoord> texCoords(texCoordCount);
+    pool.parallelFor(static_cast<int>(chunks.size()), [&](int c) {
+        const TextChunk& chunk = chunks[c];
+        int vertex = chunk.vertexOffset;
+        int texCoord = chunk.texCoordOffset;
+        for (const char* p = chunk.begin; p < chunk.end; p = nextLine(p, chunk.end)) {
+            const char* line = skipSpaces(p, chunk.end);
+            if (isKeyword(line, chunk.end, 'v')) {
+                const char* q = line + 1;
+                glm::vec3 position(0.f);
+                for (int axis = 0; axis < 3 && parseFloat(q, chunk.end, position[axis]); ++axis) {}
+                positions[vertex++] = position;
+            }
+            else if (isTexCoordKeyword(line, chunk.end)) {
+                const char* q = line + 2;
+                float uv[2] = {0.f, 0.f};
+                for (int axis = 0; axis < 2 && parseFloat(q, chunk.end, uv[axis]); ++axis) {}
+                texCoords[texCoord++] = toTextureSpace(uv[0], uv[1]);
+            }
+        }
+    });
+
+    //Pass 3: faces go straight into the triangle slots, the ones that reference missing vertices are dropped
+    triangles.resize(triangleCount);
+    std::atomic<int> invalidFaces(0);
+    std::vector<int> chunkBegins(chunks.size());
+    std::vector<int> chunkEnds(chunks.size());
+    pool.parallelFor(static_cast<int>(chunks.size()), [&](int c) {
+        const TextChunk& chunk = chunks[c];
+        int verticesSoFar = chunk.vertexOffset;
+        int texCoordsSoFar = chunk.texCoordOffset;
+        int slot = chunk.triangleOffset;
+        for (const char* p = chunk.begin; p < chunk.end; p = nextLine(p, chunk.end)) {
+            const char* line = skipSpaces(p, chunk.end);
+            if (isKeyword(line, chunk.end, 'v')) {
+                ++verticesSoFar;
+                continue;
+            }
+            if (isTexCoordKeyword(line, chunk.end)) {
+                ++texCoordsSoFar;
+                continue;
+            }
+            if (!isKeyword(line, chunk.end, 'f')) {
+                continue;
+            }
+
+            long first = -1;
+            long last = -1;
+            TexCoord firstUV(0.f);
+            TexCoord lastUV(0.f);
+            int corners = 0;
+            bool valid = true;
+            const int faceSlot = slot;
+            for (const char* q = skipSpaces(line + 1, chunk.end); q < chunk.end && *q != '\n' && *q != '#'; q = skipSpaces(skipToken(q, chunk.end), chunk.end)) {
+                //Position and texture indices are used, the normal index after the second '/' is skipped
+                long index = 0;
+                const char* token = q;
+                if (!parseInt(token, chunk.end, index) || index == 0) {
+                    valid = false;
+                }
+                index = index > 0 ? index - 1 : verticesSoFar + index;
+                if (index < 0 || index >= vertexCount) {
+                    valid = false;
+                    index = 0;
+                }
+                //Corners without a usable texture index get (0, 0), the face stays valid
+                TexCoord uv(0.f);
+                long texIndex = 0;
+                if (token < chunk.end && *token == '/') {
+                    ++token;
+                    if (parseInt(token, chunk.end, texIndex) && texIndex != 0) {
+                        texIndex = texIndex > 0 ? texIndex - 1 : texCoordsSoFar + texIndex;
+                        if (texIndex >= 0 && texIndex < texCoordCount) {
+                            uv = texCoords[texIndex];
+                        }
+                    }
+                }
+
+                if (corners == 0) {
+                    first = index;
+                    firstUV = uv;
+                }
+                else if (corners >= 2) {
+                    triangles.setTriangle(slot, positions[first], positions[last], positions[index], color, slot);
+                    if (texCoordCount > 0) {
+                        triangles.setTexCoords(slot, firstUV, lastUV, uv);
+                    }
+                    ++slot;
+                }
+                last = index;
+                lastUV = uv;
+                ++corners;
+            }
+
+            if (!valid) {
+                slot = faceSlot;
+                ++invalidFaces;
+            }
+        }
+        chunkBegins[c] = chunk.triangleOffset;
+        chunkEnds[c] = slot;
+    });
+    stats.invalidFaceCount = invalidFaces;
+    compactChunks(triangles, chunkBegins, chunkEnds, pool);
+
+    return true;
+}
+
+bool MeshLoader::loadPLY(const char* data, size_t size, TriangleBuffer& triangles, const Color& color) {
+    const char* fileEnd = data + size;
+    if (size < 4 || strncmp(data, "ply", 3) != 0) {
+        std::cout << "Not a PLY file" << std::endl;
+        return false;
+    }
+
+    //Header
+    std::vector<PlyElement> elements;
+    bool bigEndian = false;
+    bool binary = false;
+    const char* body = nullptr;
+    for (const char* p = nextLine(data, fileEnd); p < fileEnd; p = nextLine(p, fileEnd)) {
+        const char* lineEnd = nextLine(p, fileEnd);
+        std::string line(p, lineEnd);
+        while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) {
+            line.pop_back();
+        }
+        char word[4][64] = {};
+        const int words = sscanf(line.c_str(), "%63s %63s %63s %63s", word[0], word[1], word[2], word[3]);
+        if (words <= 0) {
+            continue;
+        }
+        const std::string keyword = word[0];
+        if (keyword == "format" && words >= 2) {
+            binary = strcmp(word[1], "ascii") != 0;
+            bigEndian = strcmp(word[1], "binary_big_endian") == 0;
+        }
+        else if (keyword == "element" && words >= 3) {
+            elements.push_back({word[1], atol(word[2]), {}});
+        }
+        else if (keyword == "property" && !elements.empty()) {
+            PlyProperty property;
+            if (strcmp(word[1], "list") == 0 && words >= 4) {
+                property.countType = getPlyType(word[2]);
+                property.type = getPlyType(word[3]);
+                sscanf(line.c_str(), "%*s %*s %*s %*s %63s", word[0]);
+                property.name = word[0];
+            }
+            else if (words >= 3) {
+                property.type = getPlyType(word[1]);
+                property.name = word[2];
+            }
+            if (property.type == PlyInvalid || (strcmp(word[1], "list") == 0 && property.countType == PlyInvalid)) {
+                std::cout << "Unsupported PLY property: " << line << std::endl;
+                return false;
+            }
+            elements.back().properties.push_back(property);
+        }
+        else if (keyword == "end_header") {
+            body = lineEnd;
+            break;
+        }
+    }
+    if (!body || !binary) {
+        std::cout << "Only binary PLY files are supported" << std::endl;
+        return false;
+    }
+
+    uint16_t probe = 1;
+    unsigned char firstByte;
+    memcpy(&firstByte, &probe, 1);
+    const bool swap = bigEndian == (firstByte == 1);
+
+    //Locating the vertex and face blocks, elements in front of them must have a fixed size to be skipped
+    const char* p = body;
+    const PlyElement* vertexElement = nullptr;
+    const PlyElement* faceElement = nullptr;
+    const char* vertexData = nullptr;
+    const char* faceData = nullptr;
+    int vertexStride = 0;
+    int positionOffset[3] = {-1, -1, -1};
+    PlyType positionType[3] = {PlyInvalid, PlyInvalid, PlyInvalid};
+    int texCoordOffset[2] = {-1, -1};
+    PlyType texCoordType[2] = {PlyInvalid, PlyInvalid};
+    for (const PlyElement& element : elements) {
+        if (element.name == "face") {
+            faceElement = &element;
+            faceData = p;
+            break;
+        }
+
+        int stride = 0;
+        for (const PlyProperty& property : element.properties) {
+            if (property.countType != PlyInvalid) {
+                std::cout << "Unsupported list property in PLY element " << element.name << std::endl;
+                return false;
+            }
+            if (element.name == "vertex") {
+                for (int axis = 0; axis < 3; ++axis) {
+                    if (property.name == std::string(1, static_cast<char>('x' + axis))) {
+                        positionOffset[axis] = stride;
+                        positionType[axis] = property.type;
+                    }
+                }
+                //Exporters name the texture coordinates u, v or s, t or texture_u, texture_v
+                for (int axis = 0; axis < 2; ++axis) {
+                    const std::string u = axis == 0 ? "u" : "v";
+                    const std::string s = axis == 0 ? "s" : "t";
+                    if (property.name == u || property.name == s || property.name == "texture_" + u) {
+                        texCoordOffset[axis] = stride;
+                        texCoordType[axis] = property.type;
+                    }
+                }
+            }
+            stride += getPlySize(property.type);
+        }
+        if (element.name == "vertex") {
+            vertexElement = &element;
+            vertexData = p;
+            vertexStride = stride;
+        }
+        p += stride * element.count;
+        if (p > fileEnd) {
+            std::cout << "Truncated PLY file" << std::endl;
+            return false;
+        }
+    }
+    if (!vertexElement || !faceElement || positionOffset[0] < 0 || positionOffset[1] < 0 || positionOffset[2] < 0) {
+        std::cout << "PLY file needs vertex x, y, z and a face element" << std::endl;
+        return false;
+    }
+
+    //Vertices have a fixed stride and are decoded in parallel ranges
+    const int vertexCount = static_cast<int>(vertexElement->count);
+    stats.vertexCount = vertexCount;
+    std::vector<glm::vec3> positions(vertexCount);
+    const bool hasTexCoords = texCoordOffset[0] >= 0 && texCoordOffset[1] >= 0;
+    std::vector<TexCoord> texCoords(hasTexCoords ? vertexCount : 0);
+    const int chunkCount = getChunkCount();
+    pool.parallelFor(chunkCount, [&](int c) {
+        const int begin = static_cast<int>(static_cast<long>(vertexCount) * c / chunkCount);
+        const int end = static_cast<int>(static_cast<long>(vertexCount) * (c + 1) / chunkCount);
+        for (int v = begin; v < end; ++v) {
+            const char* record = vertexData + static_cast<size_t>(v) * vertexStride;
+            for (int axis = 0; axis < 3; ++axis) {
+                positions[v][axis] = static_cast<float>(readPlyScalar(record + positionOffset[axis], positionType[axis], swap));
+            }
+            if (hasTexCoords) {
+                texCoords[v] = toTextureSpace(static_cast<float>(readPlyScalar(record + texCoordOffset[0], texCoordType[0], swap)),
+                                              static_cast<float>(readPlyScalar(record + texCoordOffset[1], texCoordType[1], swap)));
+            }
+        }
+    });
+
+    //Face records have variable length, one quick sequential walk finds where every chunk of faces starts
+    int listIndex = -1;
+    for (int i = 0; i < static_cast<int>(faceElement->properties.size()); ++i) {
+        const std::string& name = faceElement->properties[i].name;
+        if (faceElement->properties[i].countType != PlyInvalid && (name == "vertex_indices" || name == "vertex_index")) {
+            listIndex = i;
+        }
+    }
+    if (listIndex < 0) {
+        std::cout << "PLY face element has no vertex_indices list" << std::endl;
+        return false;
+    }
+
+    struct FaceChunk {
+        const char* begin;
+        long firstFace;
+        long faceCount;
+        int triangleOffset;
+    };
+    const long faceCount = faceElement->count;
+    const long facesPerChunk = std::max(1L, faceCount / chunkCount + 1);
+    std::vector<FaceChunk> faceChunks;
+    int triangleCount = 0;
+    const char* record = faceData;
+    for (long f = 0; f < faceCount; ++f) {
+        if (f % facesPerChunk == 0) {
+            faceChunks.push_back({record, f, std::min(facesPerChunk, faceCount - f), triangleCount});
+        }
+        for (int i = 0; i < static_cast<int>(faceElement->properties.size()); ++i) {
+            const PlyProperty& property = faceElement->properties[i];
+            if (record + getPlySize(property.type) > fileEnd) {
+                std::cout << "Truncated PLY file" << std::endl;
+                return false;
+            }
+            if (property.countType == PlyInvalid) {
+                record += getPlySize(property.type);
+                continue;
+            }
+            //The list has to fit into the rest of the file before the record moves past it
+            const long corners = static_cast<long>(readPlyScalar(record, property.countType, swap));
+            const long listSize = getPlySize(property.countType);
+            if (corners < 0 || listSize > fileEnd - record || corners > (fileEnd - record - listSize) / getPlySize(property.type)) {
+                std::cout << "Invalid PLY list of " << corners << " entries" << std::endl;
+                return false;
+            }
+            record += listSize + corners * getPlySize(property.type);
+            if (i == listIndex) {
+                triangleCount += static_cast<int>(std::max(0L, corners - 2));
+            }
+        }
+    }
+
+    //Faces that reference missing vertices are dropped
+    triangles.resize(triangleCount);
+    std::atomic<int> invalidFaces(0);
+    std::vector<int> chunkBegins(faceChunks.size());
+    std::vector<int> chunkEnds(faceChunks.size());
+    std::atomic<bool> malformed(false);
+    pool.parallelFor(static_cast<int>(faceChunks.size()), [&](int c) {
+        const FaceChunk& chunk = faceChunks[c];
+        const char* record = chunk.begin;
+        int slot = chunk.triangleOffset;
+        for (long f = 0; f < chunk.faceCount; ++f) {
+            for (int i = 0; i < static_cast<int>(faceElement->properties.size()); ++i) {
+                const PlyProperty& property = faceElement->properties[i];
+                if (property.countType == PlyInvalid) {
+                    record += getPlySize(property.type);
+                    continue;
+                }
+                const long corners = static_cast<long>(readPlyScalar(record, property.countType, swap));
+                if (corners < 0 || corners > (fileEnd - record - getPlySize(property.countType)) / getPlySize(property.type)) {
+                    malformed = true;
+                    f = chunk.faceCount;
+                    break;
+                }
+                record += getPlySize(property.countType);
+                if (i == listIndex) {
+                    const int faceSlot = slot;
+                    bool valid = true;
+                    long first = 0;
+                    long last = 0;
+                    for (long k = 0; k < corners; ++k) {
+                        long index = static_cast<long>(readPlyScalar(record + k * getPlySize(property.type), property.type, swap));
+                        if (index < 0 || index >= vertexCount) {
+                            valid = false;
+                            index = 0;
+                        }
+                        if (k == 0) {
+                            first = index;
+                        }
+                        else if (k >= 2) {
+                            triangles.setTriangle(slot, positions[first], positions[last], positions[index], color, slot);
+                            if (hasTexCoords) {
+                                triangles.setTexCoords(slot, texCoords[first], texCoords[last], texCoords[index]);
+                            }
+                            ++slot;
+                        }
+                        last = index;
+                    }
+                    if (!valid) {
+                        slot = faceSlot;
+                        ++invalidFaces;
+                    }
+                }
+                record += corners * getPlySize(property.type);
+            }
+        }
+        chunkBegins[c] = chunk.triangleOffset;
+        chunkEnds[c] = slot;
+    });
+    if (malformed) {
+        std::cout << "Invalid PLY list" << std::endl;
+        return false;
+    }
+    stats.invalidFaceCount = invalidFaces;
+    compactChunks(triangles, chunkBegins, chunkEnds, pool);
+
+    return true;
+}
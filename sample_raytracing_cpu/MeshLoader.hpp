@@ -0,0 +1,43 @@
+//
+//  MeshLoader.hpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#ifndef MeshLoader_hpp
+#define MeshLoader_hpp
+
+#include <string>
+#include <vector>
+#include "ThreadPool.hpp"
+#include "TriangleBuffer.hpp"
+
+struct MeshLoadStats {
+    int vertexCount = 0;
+    int triangleCount = 0;
+    //Faces that referenced missing vertices, they are left out of the buffer
+    int invalidFaceCount = 0;
+    double seconds = 0.0;
+    long peakResidentKilobytes = 0;
+};
+
+//Loads Wavefront OBJ and binary PLY meshes straight into a TriangleBuffer, texture coordinates included when the file has them
+//The file is memory mapped and split into chunks that are parsed on the pool
+class MeshLoader {
+public:
+    explicit MeshLoader(ThreadPool& pool);
+    //The format is picked from the extension, returns false when the file can't be read or parsed
+    bool load(const std::string& path, TriangleBuffer& triangles, const Color& color = Color(200, 200, 200));
+    const MeshLoadStats& getStats() const;
+
+private:
+    ThreadPool& pool;
+    MeshLoadStats stats;
+
+    bool loadOBJ(const char* data, size_t size, TriangleBuffer& triangles, const Color& color);
+    bool loadPLY(const char* data, size_t size, TriangleBuffer& triangles, const Color& color);
+    int getChunkCount() const;
+};
+
+#endif /* MeshLoader_hpp */
@@ -69,3 +69,12 @@ void PerspectiveCamera::setHeight(int h) {
 int PerspectiveCamera::getHeight() const {
     return height;
 }
+
+bool PerspectiveCamera::operator==(const PerspectiveCamera& other) const {
+    return position == other.position && front == other.front && up == other.up &&
+           fov == other.fov && width == other.width && height == other.height;
+}
+
+bool PerspectiveCamera::operator!=(const PerspectiveCamera& other) const {
+    return !(*this == other);
+}
@@ -28,6 +28,8 @@ public:
     int getWidth() const;
     void setHeight(int h);
     int getHeight() const;
+    bool operator==(const PerspectiveCamera& other) const;
+    bool operator!=(const PerspectiveCamera& other) const;
     
 private:
     glm::vec3 position;
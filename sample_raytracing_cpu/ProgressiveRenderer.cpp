@@ -0,0 +1,161 @@
+//
+//  ProgressiveRenderer.cpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#include "ProgressiveRenderer.hpp"
+#include <cstdint>
+
+namespace {
+
+uint32_t hash(uint32_t x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+float toUnitFloat(uint32_t h) {
+    return (h >> 8) * (1.f / 16777216.f);
+}
+
+}
+
+ProgressiveRenderer::ProgressiveRenderer(const TriangleBuffer& triangles, const BVH* bvh, ThreadPool& pool, const PerspectiveCamera& camera, const RenderSettings& settings) :
+                                        triangles(triangles), bvh(bvh), pool(pool), settings(settings), pendingCamera(camera),
+                                        cameraChanged(true), running(false), maxPasses(0), abortPass(false), passCount(0) {}
+
+ProgressiveRenderer::~ProgressiveRenderer() {
+    stop();
+}
+
+void ProgressiveRenderer::start(int maxPasses) {
+    stop();
+    {
+        //A restart with an unchanged camera would otherwise keep adding to the sums of the previous run
+        std::lock_guard<std::mutex> lock(mutex);
+        running = true;
+        this->maxPasses = maxPasses;
+        cameraChanged = true;
+    }
+    passCount = 0;
+    thread = std::thread(&ProgressiveRenderer::renderLoop, this);
+}
+
+void ProgressiveRenderer::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+        abortPass = true;
+    }
+    wakeCondition.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+    abortPass = false;
+}
+
+void ProgressiveRenderer::setCamera(const PerspectiveCamera& camera) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (camera == pendingCamera) {
+            return;
+        }
+        pendingCamera = camera;
+        cameraChanged = true;
+        abortPass = true;
+    }
+    wakeCondition.notify_all();
+}
+
+cv::Mat ProgressiveRenderer::getSnapshot() const {
+    std::lock_guard<std::mutex> lock(snapshotMutex);
+    return snapshot.clone();
+}
+
+int ProgressiveRenderer::getPassCount() const {
+    return passCount.load();
+}
+
+void ProgressiveRenderer::renderLoop() {
+    PerspectiveCamera camera;
+    int passes = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeCondition.wait(lock, [&]() { return !running || cameraChanged || maxPasses == 0 || passes < maxPasses; });
+            if (!running) {
+                return;
+            }
+            if (cameraChanged) {
+                camera = pendingCamera;
+                cameraChanged = false;
+                abortPass = false;
+                accumulation = cv::Mat::zeros(camera.getHeight(), camera.getWidth(), CV_32FC3);
+                passes = 0;
+            }
+        }
+
+        if (renderPass(camera, passes)) {
+            ++passes;
+            publish(passes);
+        }
+    }
+}
+
+bool ProgressiveRenderer::renderPass(const PerspectiveCamera& camera, int pass) {
+    const int width = camera.getWidth();
+    const int height = camera.getHeight();
+    const int tileSize = settings.tileSize;
+    const int tilesX = (width + tileSize - 1) / tileSize;
+    const int tilesY = (height + tileSize - 1) / tileSize;
+    const uint32_t passSeed = hash(static_cast<uint32_t>(pass) * 0x9e3779b9u);
+    const RayGenerator rays(camera);
+    const RenderSettings passSettings = withPixelAngle(settings, rays);
+
+    pool.parallelFor(tilesX * tilesY, [&](int index) {
+        if (abortPass) {
+            return;
+        }
+        const int x0 = (index % tilesX) * tileSize;
+        const int y0 = (index / tilesX) * tileSize;
+        for (int i = y0; i < std::min(y0 + tileSize, height); ++i) {
+            cv::Vec3f* row = accumulation.ptr<cv::Vec3f>(i);
+            for (int j = x0; j < std::min(x0 + tileSize, width); ++j) {
+                const uint32_t seed = hash(static_cast<uint32_t>(i * width + j) ^ passSeed);
+                const Ray ray = rays.getRay(i, j, toUnitFloat(hash(seed)), toUnitFloat(hash(seed + 1)));
+                const Color color = traceRay(ray, triangles, bvh, passSettings);
+                for (int c = 0; c < 3; ++c) {
+                    row[j][c] += color[c] / 255.f;
+                }
+            }
+        }
+    });
+
+    return !abortPass;
+}
+
+void ProgressiveRenderer::publish(int passes) {
+    resolved.create(accumulation.rows, accumulation.cols, CV_8UC3);
+    const float scale = 1.f / passes;
+    pool.parallelFor(accumulation.rows, [&](int i) {
+        const cv::Vec3f* sums = accumulation.ptr<cv::Vec3f>(i);
+        cv::Vec3b* row = resolved.ptr<cv::Vec3b>(i);
+        for (int j = 0; j < accumulation.cols; ++j) {
+            //Clamping tonemap, the flat triangle colors never leave the displayable range
+            for (int c = 0; c < 3; ++c) {
+                row[j][c] = static_cast<unsigned char>(std::min(sums[j][c] * scale, 1.f) * 255.f + 0.5f);
+            }
+        }
+    });
+
+    {
+        std::lock_guard<std::mutex> lock(snapshotMutex);
+        std::swap(snapshot, resolved);
+        passCount = passes;
+    }
+}
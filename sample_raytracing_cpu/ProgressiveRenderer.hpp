@@ -0,0 +1,61 @@
+//
+//  ProgressiveRenderer.hpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#ifndef ProgressiveRenderer_hpp
+#define ProgressiveRenderer_hpp
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <opencv2/opencv.hpp>
+#include "RayTracer.hpp"
+
+//Refines the image in the background by adding one jittered sample per pixel each pass
+class ProgressiveRenderer {
+public:
+    ProgressiveRenderer(const TriangleBuffer& triangles, const BVH* bvh, ThreadPool& pool, const PerspectiveCamera& camera, const RenderSettings& settings = RenderSettings());
+    ~ProgressiveRenderer();
+    ProgressiveRenderer(const ProgressiveRenderer&) = delete;
+    ProgressiveRenderer& operator=(const ProgressiveRenderer&) = delete;
+
+    //Passes stop after maxPasses, 0 keeps refining until stop() is called
+    void start(int maxPasses = 0);
+    void stop();
+    //Accumulated samples are dropped as soon as any camera parameter differs from the current one
+    void setCamera(const PerspectiveCamera& camera);
+    //Copy of the image after the last finished pass, never waits for the pass in flight
+    cv::Mat getSnapshot() const;
+    int getPassCount() const;
+
+private:
+    const TriangleBuffer& triangles;
+    const BVH* bvh;
+    ThreadPool& pool;
+    RenderSettings settings;
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wakeCondition;
+    PerspectiveCamera pendingCamera;
+    bool cameraChanged;
+    bool running;
+    int maxPasses;
+    std::atomic<bool> abortPass;
+
+    cv::Mat accumulation;
+    cv::Mat resolved;
+    mutable std::mutex snapshotMutex;
+    cv::Mat snapshot;
+    std::atomic<int> passCount;
+
+    void renderLoop();
+    bool renderPass(const PerspectiveCamera& camera, int pass);
+    void publish(int passes);
+};
+
+#endif /* ProgressiveRenderer_hpp */
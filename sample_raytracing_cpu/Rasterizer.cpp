@@ -0,0 +1,245 @@
+//
+//  Rasterizer.cpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#include "Rasterizer.hpp"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+namespace {
+
+const int chunkSize = 4096;
+//Vertices closer to the camera plane than this, relative to the scene, project too far out to be trusted
+const float nearDistance = 1e-4f;
+
+//Same steps as the pipeline of 3d_transformations, projection to clip space, perspective divide and viewport transform
+//The projection matches the RayGenerator, the ray through pixel coordinates (x, y) meets the projected point
+struct Projection {
+    glm::vec3 origin;
+    glm::vec3 front;
+    glm::vec3 right;
+    glm::vec3 up;
+    float halfWidth;
+    float halfHeight;
+    int width;
+    int height;
+
+    explicit Projection(const PerspectiveCamera& cam) : origin(cam.getPosition()), width(cam.getWidth()), height(cam.getHeight()) {
+        front = glm::normalize(cam.getFront());
+        right = glm::normalize(glm::cross(front, cam.getUp()));
+        up = glm::cross(right, front);
+        halfHeight = std::tan(glm::radians(cam.getFOV() / 2));
+        halfWidth = halfHeight * static_cast<float>(width) / height;
+    }
+
+    //Clip space point, w is the distance in front of the camera
+    glm::vec4 toClipSpace(const glm::vec3& p) const {
+        const glm::vec3 d = p - origin;
+        return glm::vec4(glm::dot(d, right) / halfWidth, glm::dot(d, up) / halfHeight, 0.f, glm::dot(d, front));
+    }
+
+    //Normalized device coordinates to pixel coordinates, y grows downwards
+    glm::vec2 toViewport(const glm::vec4& clip) const {
+        const float x = clip.x / clip.w;
+        const float y = clip.y / clip.w;
+        return glm::vec2(x * width / 2 + width / 2.f, -y * height / 2 + height / 2.f);
+    }
+};
+
+}
+
+Rasterizer::Rasterizer(const PerspectiveCamera& cam, const TriangleBuffer& triangles, int tileSize, ThreadPool& pool) : triangles(triangles), tileSize(tileSize) {
+    const Projection projection(cam);
+    const int width = cam.getWidth();
+    const int height = cam.getHeight();
+    tilesX = (width + tileSize - 1) / tileSize;
+    tilesY = (height + tileSize - 1) / tileSize;
+
+    //Projection on the pool, a triangle that can't be seen gets an empty bounding box
+    const int count = triangles.size();
+    screenTriangles.resize(count);
+    pool.parallelFor((count + chunkSize - 1) / chunkSize, [&](int chunk) {
+        const int end = std::min(count, (chunk + 1) * chunkSize);
+        for (int slot = chunk * chunkSize; slot < end; ++slot) {
+            ScreenTriangle& screen = screenTriangles[slot];
+            screen.minX = screen.minY = 0;
+            screen.maxX = screen.maxY = -1;
+
+            glm::vec4 clip[3];
+            float scale = 1.f;
+            for (int k = 0; k < 3; ++k) {
+                clip[k] = projection.toClipSpace(triangles.getVertex(slot, k));
+                const glm::vec3 magnitude = glm::abs(triangles.getVertex(slot, k) - projection.origin);
+                scale = std::max(scale, std::max(magnitude.x, std::max(magnitude.y, magnitude.z)));
+            }
+            const float minW = std::min(clip[0].w, std::min(clip[1].w, clip[2].w));
+            const float maxW = std::max(clip[0].w, std::max(clip[1].w, clip[2].w));
+            if (maxW < -nearDistance * scale) {
+                continue;
+            }
+
+            //Triangles reaching the camera plane may cover any pixel, every pixel is tested
+            bool wholeFrame = minW < nearDistance * scale;
+            glm::vec2 v[3];
+            float area = 0.f;
+            float margin = 0.f;
+            if (!wholeFrame) {
+                for (int k = 0; k < 3; ++k) {
+                    v[k] = projection.toViewport(clip[k]);
+                }
+                area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[1].y - v[0].y) * (v[2].x - v[0].x);
+                const float minX = std::min(v[0].x, std::min(v[1].x, v[2].x));
+                const float maxX = std::max(v[0].x, std::max(v[1].x, v[2].x));
+                const float minY = std::min(v[0].y, std::min(v[1].y, v[2].y));
+                const float maxY = std::max(v[0].y, std::max(v[1].y, v[2].y));
+                //Rounding of the projection grows with the coordinates, the margin covers it on top of 1/16 of a pixel
+                const float extent = std::max(std::max(std::abs(minX), std::abs(maxX)), std::max(std::abs(minY), std::abs(maxY)));
+                margin = 1.f / 16.f + 1e-5f * extent;
+                //Pixel centers sit at j + 0.5, the box grows by the margin and is clamped before it is converted
+                screen.minX = static_cast<int>(std::min(std::max(0.f, std::floor(minX - 0.5f - margin)), static_cast<float>(width)));
+                screen.maxX = static_cast<int>(std::max(std::min(width - 1.f, std::ceil(maxX - 0.5f + margin)), -1.f));
+                screen.minY = static_cast<int>(std::min(std::max(0.f, std::floor(minY - 0.5f - margin)), static_cast<float>(height)));
+                screen.maxY = static_cast<int>(std::max(std::min(height - 1.f, std::ceil(maxY - 0.5f + margin)), -1.f));
+            }
+            else {
+                screen.minX = screen.minY = 0;
+                screen.maxX = width - 1;
+                screen.maxY = height - 1;
+            }
+
+            //Triangles at the camera plane and slivers whose winding the rounding could flip only get the bounding box
+            if (wholeFrame || std::abs(area) < margin * margin) {
+                for (int k = 0; k < 3; ++k) {
+                    screen.edges[k][0] = screen.edges[k][1] = screen.edges[k][2] = 0.f;
+                }
+                continue;
+            }
+            const float orientation = area > 0.f ? 1.f : -1.f;
+            for (int k = 0; k < 3; ++k) {
+                const glm::vec2& a = v[k];
+                const glm::vec2& b = v[(k + 1) % 3];
+                const float length = glm::length(b - a);
+                //orientation * cross(b - a, p - a) / length is the signed distance of p inside the edge
+                screen.edges[k][0] = -orientation * (b.y - a.y) / length;
+                screen.edges[k][1] = orientation * (b.x - a.x) / length;
+                screen.edges[k][2] = margin - (screen.edges[k][0] * a.x + screen.edges[k][1] * a.y);
+            }
+        }
+    });
+
+    //Counting sort of the triangles into the tiles their boxes overlap
+    tileStart.assign(tilesX * tilesY + 1, 0);
+    for (const ScreenTriangle& screen : screenTriangles) {
+        if (screen.minX > screen.maxX || screen.minY > screen.maxY) {
+            continue;
+        }
+        for (int ty = screen.minY / tileSize; ty <= screen.maxY / tileSize; ++ty) {
+            for (int tx = screen.minX / tileSize; tx <= screen.maxX / tileSize; ++tx) {
+                ++tileStart[ty * tilesX + tx + 1];
+            }
+        }
+    }
+    for (int k = 0; k < tilesX * tilesY; ++k) {
+        tileStart[k + 1] += tileStart[k];
+    }
+    tileSlots.resize(tileStart.back());
+    std::vector<int> next(tileStart.begin(), tileStart.end() - 1);
+    for (int slot = 0; slot < count; ++slot) {
+        const ScreenTriangle& screen = screenTriangles[slot];
+        if (screen.minX > screen.maxX || screen.minY > screen.maxY) {
+            continue;
+        }
+        for (int ty = screen.minY / tileSize; ty <= screen.maxY / tileSize; ++ty) {
+            for (int tx = screen.minX / tileSize; tx <= screen.maxX / tileSize; ++tx) {
+                tileSlots[next[ty * tilesX + tx]++] = slot;
+            }
+        }
+    }
+}
+
+int Rasterizer::getTileSize() const {
+    return tileSize;
+}
+
+void Rasterizer::rasterize(const cv::Rect& tile, const RayGenerator& rays, cv::Mat& ids, cv::Mat& depths) const {
+    //The rows of the tile are cut into groups of simd::width pixels, a triangle is tested against a whole group at once
+    const int groupsPerRow = (tile.width + simd::width - 1) / simd::width;
+    const int stride = groupsPerRow * simd::width;
+    std::vector<SimdRay> groups(groupsPerRow * tile.height);
+    std::vector<Ray> row(tile.width);
+    for (int y = 0; y < tile.height; ++y) {
+        rays.generateRow(tile.y + y, tile.x, tile.width, row.data());
+        for (int g = 0; g < groupsPerRow; ++g) {
+            RayPacket packet;
+            for (int lane = 0; lane < simd::width && g * simd::width + lane < tile.width; ++lane) {
+                packet.setRay(lane, row[g * simd::width + lane]);
+            }
+            groups[y * groupsPerRow + g] = packet.load();
+        }
+    }
+    std::vector<int> tileIds(stride * tile.height, INT_MAX);
+    std::vector<float> tileDepths(stride * tile.height, MAXFLOAT);
+
+    const int index = (tile.y / tileSize) * tilesX + tile.x / tileSize;
+    for (int k = tileStart[index]; k < tileStart[index + 1]; ++k) {
+        const int slot = tileSlots[k];
+        const int id = triangles.getId(slot);
+        const ScreenTriangle& screen = screenTriangles[slot];
+        const int x0 = std::max(screen.minX, tile.x) - tile.x;
+        const int x1 = std::min(screen.maxX, tile.x + tile.width - 1) - tile.x;
+        const int y0 = std::max(screen.minY, tile.y) - tile.y;
+        const int y1 = std::min(screen.maxY, tile.y + tile.height - 1) - tile.y;
+        for (int y = y0; y <= y1; ++y) {
+            const float py = tile.y + y + 0.5f;
+            for (int g = x0 / simd::width; g <= x1 / simd::width; ++g) {
+                int active = 0;
+                for (int lane = 0; lane < simd::width; ++lane) {
+                    const int x = g * simd::width + lane;
+                    if (x < x0 || x > x1) {
+                        continue;
+                    }
+                    const float px = tile.x + x + 0.5f;
+                    bool covered = true;
+                    for (int e = 0; e < 3 && covered; ++e) {
+                        covered = screen.edges[e][0] * px + screen.edges[e][1] * py + screen.edges[e][2] >= 0.f;
+                    }
+                    active |= covered << lane;
+                }
+                if (!active) {
+                    continue;
+                }
+
+                //The depth test is the ray's own intersection, ties go to the lower id like in the traversal
+                float* depth = tileDepths.data() + y * stride + g * simd::width;
+                int* pixelIds = tileIds.data() + y * stride + g * simd::width;
+                simd::Float t;
+                const simd::Mask hit = triangles.intersect(groups[y * groupsPerRow + g], slot, simd::maskFromBits(active), t);
+                int hitBits = (hit & (t <= simd::Float::load(depth))).bits();
+                if (!hitBits) {
+                    continue;
+                }
+                alignas(32) float tLanes[simd::width];
+                t.store(tLanes);
+                while (hitBits) {
+                    const int lane = simd::firstLane(hitBits);
+                    hitBits &= hitBits - 1;
+                    if (tLanes[lane] < depth[lane] || id < pixelIds[lane]) {
+                        depth[lane] = tLanes[lane];
+                        pixelIds[lane] = id;
+                    }
+                }
+            }
+        }
+    }
+
+    for (int y = 0; y < tile.height; ++y) {
+        for (int x = 0; x < tile.width; ++x) {
+            ids.at<int>(tile.y + y, tile.x + x) = tileIds[y * stride + x];
+            depths.at<float>(tile.y + y, tile.x + x) = tileDepths[y * stride + x];
+        }
+    }
+}
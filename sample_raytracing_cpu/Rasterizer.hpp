@@ -0,0 +1,50 @@
+//
+//  Rasterizer.hpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#ifndef Rasterizer_hpp
+#define Rasterizer_hpp
+
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "PerspectiveCamera.hpp"
+#include "RayGenerator.hpp"
+#include "ThreadPool.hpp"
+#include "TriangleBuffer.hpp"
+
+//Z-buffer rasterizer for the primary visibility of pixel centers, the triangles are projected once and binned into screen tiles
+//Coverage is conservative and the depth test runs the ray-triangle test of the pixel's ray, so the visibility buffer holds exactly
+//the triangle and the distance that casting the ray finds
+class Rasterizer {
+public:
+    Rasterizer(const PerspectiveCamera& cam, const TriangleBuffer& triangles, int tileSize, ThreadPool& pool);
+
+    int getTileSize() const;
+    //Fills the tile of the frame sized ids (CV_32S, INT_MAX where nothing is hit) and depths (CV_32F, distance along the ray)
+    //The tile has to lie on the tile grid, tiles can be rasterized in parallel
+    void rasterize(const cv::Rect& tile, const RayGenerator& rays, cv::Mat& ids, cv::Mat& depths) const;
+
+private:
+    //Screen space edges scaled to unit length and moved out by the margin, a pixel center passes when it is inside all three
+    struct ScreenTriangle {
+        float edges[3][3];
+        int minX;
+        int minY;
+        int maxX;
+        int maxY;
+    };
+
+    const TriangleBuffer& triangles;
+    const int tileSize;
+    int tilesX;
+    int tilesY;
+    std::vector<ScreenTriangle> screenTriangles;
+    //Slots of the triangles touching each tile, tile k owns [tileStart[k], tileStart[k + 1])
+    std::vector<int> tileStart;
+    std::vector<int> tileSlots;
+};
+
+#endif /* Rasterizer_hpp */
@@ -0,0 +1,53 @@
+//
+//  Ray.hpp
+//  Test
+//
+//  Created by Erik Nouroyan on 17.10.26.
+//
+
+#ifndef Ray_hpp
+#define Ray_hpp
+
+#include <glm/vec3.hpp>
+#include "Simd.hpp"
+
+struct Ray {
+    glm::vec3 p0;
+    glm::vec3 dir;
+};
+
+//One ray per SIMD lane, kept in registers by the packet kernels
+struct SimdRay {
+    simd::Float p0[3];
+    simd::Float dir[3];
+};
+
+//Structure-of-arrays bundle of coherent rays, unused lanes are cleared in activeMask
+struct RayPacket {
+    alignas(32) float p0[3][simd::width] = {};
+    alignas(32) float dir[3][simd::width] = {};
+    int activeMask = 0;
+
+    void setRay(int lane, const Ray& r) {
+        for (int axis = 0; axis < 3; ++axis) {
+            p0[axis][lane] = r.p0[axis];
+            dir[axis][lane] = r.dir[axis];
+        }
+        activeMask |= 1 << lane;
+    }
+
+    Ray getRay(int lane) const {
+        return {{p0[0][lane], p0[1][lane], p0[2][lane]}, {dir[0][lane], dir[1][lane], dir[2][lane]}};
+    }
+
+    SimdRay load() const {
+        SimdRay r;
+        for (int axis = 0; axis < 3; ++axis) {
+            r.p0[axis] = simd::Float::load(p0[axis]);
+            r.dir[axis] = simd::Float::load(dir[axis]);
+        }
+        return r;
+    }
+};
+
+#endif /* Ray_hpp */
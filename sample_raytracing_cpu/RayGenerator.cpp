@@ -0,0 +1,90 @@
+//
+//  RayGenerator.cpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#include "RayGenerator.hpp"
+#include <algorithm>
+#include <cmath>
+
+RayGenerator::RayGenerator(const PerspectiveCamera& camera, int samplesPerPixel) : width(camera.getWidth()), height(camera.getHeight()), origin(camera.getPosition()) {
+    //Same basis as the inverse of the lookAt matrix, the image plane sits at distance 1 along front
+    front = glm::normalize(camera.getFront());
+    const glm::vec3 right = glm::normalize(glm::cross(front, camera.getUp()));
+    const glm::vec3 up = glm::cross(right, front);
+    const float halfHeight = std::tan(glm::radians(camera.getFOV() / 2));
+    const float halfWidth = halfHeight * static_cast<float>(width) / height;
+
+    corner = front - right * halfWidth + up * halfHeight;
+    stepX = right * (2 * halfWidth / width);
+    stepY = -up * (2 * halfHeight / height);
+
+    //The most square grid that splits the pixel into exactly samplesPerPixel strata
+    const int samples = std::max(1, samplesPerPixel);
+    stratumColumns = 1;
+    for (int c = 1; c * c <= samples; ++c) {
+        if (samples % c == 0) {
+            stratumColumns = c;
+        }
+    }
+    stratumRows = samples / stratumColumns;
+    for (int s = 0; s < samples; ++s) {
+        stratumX.push_back(static_cast<float>(s % stratumColumns) / stratumColumns);
+        stratumY.push_back(static_cast<float>(s / stratumColumns) / stratumRows);
+    }
+}
+
+int RayGenerator::getWidth() const {
+    return width;
+}
+
+int RayGenerator::getHeight() const {
+    return height;
+}
+
+int RayGenerator::getSampleCount() const {
+    return static_cast<int>(stratumX.size());
+}
+
+float RayGenerator::getPixelAngle() const {
+    //The image plane is at distance 1, so a small step on it is the angle itself
+    return glm::length(stepY);
+}
+
+Ray RayGenerator::getRay(int i, int j, float offsetX, float offsetY) const {
+    const glm::vec3 dir = corner + stepY * (i + offsetY) + stepX * (j + offsetX);
+    return {origin, glm::normalize(dir)};
+}
+
+Ray RayGenerator::getSample(int i, int j, int sample, float jitterX, float jitterY) const {
+    return getRay(i, j, stratumX[sample] + jitterX / stratumColumns, stratumY[sample] + jitterY / stratumRows);
+}
+
+void RayGenerator::generateRow(int i, int x, int count, Ray* rays) const {
+    const glm::vec3 rowStart = corner + stepY * (i + 0.5f);
+    for (int k = 0; k < count; ++k) {
+        rays[k] = {origin, glm::normalize(rowStart + stepX * (x + k + 0.5f))};
+    }
+}
+
+void RayGenerator::generateTile(int x, int y, int width, int height, Ray* rays) const {
+    for (int row = 0; row < height; ++row) {
+        generateRow(y + row, x, width, rays + row * width);
+    }
+}
+
+bool RayGenerator::project(const glm::vec3& point, glm::vec2& pixel, float& distance) const {
+    const glm::vec3 d = point - origin;
+    const float depth = glm::dot(d, front);
+    if (depth <= 0.f) {
+        return false;
+    }
+    //The basis is orthogonal, so the offset from the corner on the image plane splits into the two steps
+    const glm::vec3 onPlane = d / depth - corner;
+    pixel = glm::vec2(glm::dot(onPlane, stepX) / glm::dot(stepX, stepX), glm::dot(onPlane, stepY) / glm::dot(stepY, stepY));
+    distance = glm::length(d);
+
+    return true;
+}
@@ -0,0 +1,55 @@
+//
+//  RayGenerator.hpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#ifndef RayGenerator_hpp
+#define RayGenerator_hpp
+
+#include <vector>
+#include <glm/vec2.hpp>
+#include "PerspectiveCamera.hpp"
+#include "Ray.hpp"
+
+//Primary rays of one frame, the camera basis and the per-pixel steps are computed once when it is built
+class RayGenerator {
+public:
+    //The pixel is split into a grid of samplesPerPixel strata, as square as the count allows
+    explicit RayGenerator(const PerspectiveCamera& camera, int samplesPerPixel = 1);
+
+    int getWidth() const;
+    int getHeight() const;
+    int getSampleCount() const;
+    //Angle between the center rays of neighbouring pixels in the middle of the image
+    float getPixelAngle() const;
+
+    //The offsets place the ray inside the pixel, (0.5, 0.5) is its center
+    Ray getRay(int i, int j, float offsetX = 0.5f, float offsetY = 0.5f) const;
+    //Ray through stratum `sample` of the pixel, the jitter moves it inside the stratum and (0.5, 0.5) is the stratum center
+    Ray getSample(int i, int j, int sample, float jitterX = 0.5f, float jitterY = 0.5f) const;
+    //Pixel center rays of columns [x, x + count) of row i, the same rays getRay returns
+    void generateRow(int i, int x, int count, Ray* rays) const;
+    //Pixel center rays of a tile, row by row
+    void generateTile(int x, int y, int width, int height, Ray* rays) const;
+    //Inverse of getRay, pixel coordinates (x, y) of the ray through the point and its distance from the camera
+    //The center of pixel (i, j) is at (j + 0.5, i + 0.5), false when the point is not in front of the camera
+    bool project(const glm::vec3& point, glm::vec2& pixel, float& distance) const;
+
+private:
+    int width;
+    int height;
+    glm::vec3 origin;
+    glm::vec3 front;
+    //Direction towards the top left corner of the image and the steps to the next column and row
+    glm::vec3 corner;
+    glm::vec3 stepX;
+    glm::vec3 stepY;
+    int stratumColumns;
+    int stratumRows;
+    std::vector<float> stratumX;
+    std::vector<float> stratumY;
+};
+
+#endif /* RayGenerator_hpp */
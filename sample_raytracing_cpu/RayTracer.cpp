@@ -0,0 +1,933 @@
+//
+//  RayTracer.cpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#include "RayTracer.hpp"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include "Rasterizer.hpp"
+#include "WavefrontRenderer.hpp"
+
+Ray constructRayThroughPixel(const PerspectiveCamera& camera, int i, int j, float offsetX, float offsetY) {
+    return RayGenerator(camera).getRay(i, j, offsetX, offsetY);
+}
+
+//Linear scan over all triangles, simd::width of them per step
+int getSceneIntersection (const Ray& r, const TriangleBuffer& triangles) {
+    float t = MAXFLOAT;
+    int minIndex = INT_MAX;
+    triangles.intersect(r, 0, triangles.size(), t, minIndex);
+    
+    return minIndex;
+}
+
+int getSceneIntersection (const Ray& r, const BVH& bvh) {
+    float t = MAXFLOAT;
+    return bvh.intersect(r, t);
+}
+
+int getSceneIntersection (const Ray& r, const UniformGrid& grid) {
+    float t = MAXFLOAT;
+    return grid.intersect(r, t);
+}
+
+bool isOccluded(const Ray& r, float tMax, const TriangleBuffer& triangles, const BVH* bvh) {
+    return bvh ? bvh->occluded(r, tMax) : triangles.occluded(r, 0, triangles.size(), tMax);
+}
+
+Ray constructShadowRay(const glm::vec3& point, const glm::vec3& normal, const glm::vec3& lightPosition, float& lightDistance) {
+    //Offset along the normal, scaled with the coordinates so the surface doesn't shadow itself
+    const glm::vec3 magnitude = glm::abs(point);
+    const float offset = 1e-4f * (std::max(magnitude.x, std::max(magnitude.y, magnitude.z)) + 1.f);
+    const glm::vec3 origin = point + normal * offset;
+    const glm::vec3 toLight = lightPosition - origin;
+    lightDistance = glm::length(toLight);
+    
+    return {origin, toLight / lightDistance};
+}
+
+Ray constructReflectionRay(const glm::vec3& point, const glm::vec3& normal, const glm::vec3& dir) {
+    //Same offset as the shadow rays
+    const glm::vec3 magnitude = glm::abs(point);
+    const float offset = 1e-4f * (std::max(magnitude.x, std::max(magnitude.y, magnitude.z)) + 1.f);
+    
+    return {point + normal * offset, dir - 2.f * glm::dot(dir, normal) * normal};
+}
+
+namespace {
+
+//Triangles are two sided, the normal is turned towards the viewer
+glm::vec3 getFacingNormal(const Ray& r, const TriangleBuffer& triangles, int index) {
+    const glm::vec3 normal = triangles.getNormal(index);
+    return glm::dot(normal, r.dir) > 0.f ? -normal : normal;
+}
+
+//Triangle color, times the texture at the hit when there is one
+Color getSurfaceColor(const Ray& r, float t, int index, const TriangleBuffer& triangles, const RenderSettings& settings, float pathLength) {
+    const Color color = triangles.getColor(index);
+    if (!settings.texture) {
+        return color;
+    }
+    
+    //Barycentric coordinates of the hit, from the dot products of the edges
+    const glm::vec3 v0 = triangles.getVertex(index, 0);
+    const glm::vec3 e1 = triangles.getVertex(index, 1) - v0;
+    const glm::vec3 e2 = triangles.getVertex(index, 2) - v0;
+    const glm::vec3 p = r.p0 + r.dir * t - v0;
+    const float d11 = glm::dot(e1, e1);
+    const float d12 = glm::dot(e1, e2);
+    const float d22 = glm::dot(e2, e2);
+    const float denominator = d11 * d22 - d12 * d12;
+    if (!(denominator > 0.f)) {
+        return color;
+    }
+    const float b1 = (d22 * glm::dot(p, e1) - d12 * glm::dot(p, e2)) / denominator;
+    const float b2 = (d11 * glm::dot(p, e2) - d12 * glm::dot(p, e1)) / denominator;
+    const TexCoord uv0 = triangles.getTexCoord(index, 0);
+    const TexCoord du1 = triangles.getTexCoord(index, 1) - uv0;
+    const TexCoord du2 = triangles.getTexCoord(index, 2) - uv0;
+    
+    //Ray cone level of detail: the cone is pixelAngle * distance wide at the hit and the slant of the surface stretches it,
+    //the ratio of the triangle's texel area to its world area (the denominator is its squared area) turns the width into texels
+    const Texture& texture = *settings.texture;
+    const float texelArea = std::abs(du1.x * du2.y - du1.y * du2.x) * texture.getWidth() * texture.getHeight();
+    const float cosine = std::abs(glm::dot(r.dir, triangles.getNormal(index)));
+    const float level = 0.5f * std::log2(texelArea / std::sqrt(denominator)) + std::log2(settings.pixelAngle * (pathLength + t) / cosine);
+    const glm::vec3 texel = texture.sample(uv0 + du1 * b1 + du2 * b2, level);
+    
+    Color result;
+    for (int c = 0; c < 3; ++c) {
+        result[c] = static_cast<unsigned char>(color[c] * texel[c] / 255.f + 0.5f);
+    }
+    
+    return result;
+}
+
+//Phong shading of a hit, isBlocked(shadowRay, lightDistance) answers the shadow query against whatever scene was hit
+template <typename Occlusion>
+Color shadePoint(const Ray& r, float t, glm::vec3 normal, const Color& objectColor, const RenderSettings& settings, const Occlusion& isBlocked) {
+    //Triangles are two sided, the normal is turned towards the viewer
+    const PointLight& light = settings.light;
+    const glm::vec3 point = r.p0 + r.dir * t;
+    if (glm::dot(normal, r.dir) > 0.f) {
+        normal = -normal;
+    }
+    
+    float intensity = light.ambient;
+    float specular = 0.f;
+    float lightDistance;
+    const Ray shadowRay = constructShadowRay(point, normal, light.position, lightDistance);
+    const float lambertian = glm::dot(shadowRay.dir, normal);
+    if (lambertian > 0.f && !isBlocked(shadowRay, lightDistance)) {
+        intensity += light.diffuse * lambertian;
+        const glm::vec3 reflection = 2.f * lambertian * normal - shadowRay.dir;
+        specular = light.specular * std::pow(std::max(glm::dot(reflection, -r.dir), 0.f), light.shininess);
+    }
+    
+    //Like the shader the specular term is tinted by the object color, the sum is clamped instead of normalized
+    Color color;
+    for (int c = 0; c < 3; ++c) {
+        color[c] = static_cast<unsigned char>(std::min((intensity + specular) * objectColor[c], 255.f));
+    }
+    
+    return color;
+}
+
+//Surface color of a triangle hit, Phong shaded with isBlocked answering the shadow query when shading is on
+template <typename Occlusion>
+Color shadeTriangle(const Ray& r, float t, int index, const TriangleBuffer& triangles, const RenderSettings& settings, float pathLength, const Occlusion& isBlocked) {
+    const Color color = getSurfaceColor(r, t, index, triangles, settings, pathLength);
+    if (!settings.shading) {
+        return color;
+    }
+    
+    return shadePoint(r, t, triangles.getNormal(index), color, settings, isBlocked);
+}
+
+}
+
+Color shade(const Ray& r, float t, int index, const TriangleBuffer& triangles, const BVH* bvh, const RenderSettings& settings, float pathLength) {
+    return shadeTriangle(r, t, index, triangles, settings, pathLength, [&](const Ray& shadowRay, float lightDistance) {
+        return isOccluded(shadowRay, lightDistance, triangles, bvh);
+    });
+}
+
+bool getShadowQuery(const Ray& r, float t, int index, const TriangleBuffer& triangles, const RenderSettings& settings, Ray& shadowRay, float& lightDistance) {
+    if (!settings.shading) {
+        return false;
+    }
+    const glm::vec3 normal = getFacingNormal(r, triangles, index);
+    shadowRay = constructShadowRay(r.p0 + r.dir * t, normal, settings.light.position, lightDistance);
+    
+    //shadePoint skips the query under the same condition
+    return glm::dot(shadowRay.dir, normal) > 0.f;
+}
+
+Color shadeWithShadow(const Ray& r, float t, int index, const TriangleBuffer& triangles, bool lightBlocked, const RenderSettings& settings, float pathLength) {
+    const Color color = getSurfaceColor(r, t, index, triangles, settings, pathLength);
+    if (!settings.shading) {
+        return color;
+    }
+    
+    return shadePoint(r, t, triangles.getNormal(index), color, settings, [&](const Ray&, float) {
+        return lightBlocked;
+    });
+}
+
+Color shade(const Ray& r, const InstanceHit& hit, const InstancedScene& scene, const RenderSettings& settings) {
+    if (!settings.shading) {
+        return scene.getColor(hit);
+    }
+    
+    return shadePoint(r, hit.t, scene.getNormal(hit), scene.getColor(hit), settings, [&](const Ray& shadowRay, float lightDistance) {
+        return scene.occluded(shadowRay, lightDistance);
+    });
+}
+
+Color shade(const Ray& r, const ShapeHit& hit, const ShapeScene& scene, const RenderSettings& settings) {
+    //The triangles keep their texture, the shapes have no texture coordinates
+    const Color color = hit.triangle != INT_MAX ? getSurfaceColor(r, hit.t, scene.getTriangleSlot(hit), scene.getTriangles().getTriangles(), settings, 0.f) :
+                                                  scene.getColor(hit);
+    if (!settings.shading) {
+        return color;
+    }
+    
+    return shadePoint(r, hit.t, scene.getNormal(r, hit), color, settings, [&](const Ray& shadowRay, float lightDistance) {
+        return scene.occluded(shadowRay, lightDistance);
+    });
+}
+
+namespace {
+
+int intersectScene(const Ray& r, const TriangleBuffer& triangles, const BVH* bvh, float& t) {
+    int index = INT_MAX;
+    if (bvh) {
+        index = bvh->intersect(r, t);
+    }
+    else {
+        triangles.intersect(r, 0, triangles.size(), t, index);
+    }
+    
+    return index;
+}
+
+//Own color of the hit blended with what the reflected ray sees, kept in floats so a sample is rounded only once
+//intersect(r, t) returns the slot of the closest hit and isBlocked(r, tMax) the shadow query, both against the structure the hit came from
+template <typename Intersect, typename Occlusion>
+glm::vec3 shadeReflective(const Ray& r, float t, int index, const TriangleBuffer& triangles, const RenderSettings& settings, int bounce, float pathLength,
+                          const Intersect& intersect, const Occlusion& isBlocked) {
+    const Color local = shadeTriangle(r, t, index, triangles, settings, pathLength, isBlocked);
+    const glm::vec3 color(local[0], local[1], local[2]);
+    if (bounce >= settings.maxBounces) {
+        return color;
+    }
+    
+    const Ray reflected = constructReflectionRay(r.p0 + r.dir * t, getFacingNormal(r, triangles, index), r.dir);
+    float tReflected = MAXFLOAT;
+    const int hit = intersect(reflected, tReflected);
+    const glm::vec3 reflectedColor = hit == INT_MAX ? glm::vec3(0.f) :
+                                                      shadeReflective(reflected, tReflected, hit, triangles, settings, bounce + 1, pathLength + t, intersect, isBlocked);
+    
+    return color * (1.f - settings.reflectivity) + reflectedColor * settings.reflectivity;
+}
+
+//Full color of a hit, the reflections are only traced when they are enabled
+template <typename Intersect, typename Occlusion>
+Color shadeHit(const Ray& r, float t, int index, const TriangleBuffer& triangles, const RenderSettings& settings, const Intersect& intersect, const Occlusion& isBlocked) {
+    if (settings.maxBounces <= 0 || settings.reflectivity <= 0.f) {
+        return shadeTriangle(r, t, index, triangles, settings, 0.f, isBlocked);
+    }
+    
+    return toColor(shadeReflective(r, t, index, triangles, settings, 0, 0.f, intersect, isBlocked));
+}
+
+Color shadeHit(const Ray& r, float t, int index, const TriangleBuffer& triangles, const BVH* bvh, const RenderSettings& settings) {
+    return shadeHit(r, t, index, triangles, settings, [&](const Ray& ray, float& tHit) {
+        return intersectScene(ray, triangles, bvh, tHit);
+    }, [&](const Ray& shadowRay, float lightDistance) {
+        return isOccluded(shadowRay, lightDistance, triangles, bvh);
+    });
+}
+
+}
+
+Color toColor(const glm::vec3& color) {
+    Color result;
+    for (int c = 0; c < 3; ++c) {
+        result[c] = static_cast<unsigned char>(std::min(color[c] + 0.5f, 255.f));
+    }
+    
+    return result;
+}
+
+RenderSettings withPixelAngle(const RenderSettings& settings, const RayGenerator& rays) {
+    RenderSettings result = settings;
+    if (result.pixelAngle == 0.f) {
+        result.pixelAngle = rays.getPixelAngle();
+    }
+    
+    return result;
+}
+
+Color traceRay(const Ray& r, const TriangleBuffer& triangles, const BVH* bvh, const RenderSettings& settings) {
+    int index;
+    float t;
+    
+    return traceRay(r, triangles, bvh, settings, index, t);
+}
+
+Color traceRay(const Ray& r, const TriangleBuffer& triangles, const BVH* bvh, const RenderSettings& settings, int& index, float& t) {
+    t = MAXFLOAT;
+    index = intersectScene(r, triangles, bvh, t);
+    if (index == INT_MAX) {
+        return Color(0, 0, 0);
+    }
+    
+    return shadeHit(r, t, index, triangles, bvh, settings);
+}
+
+Color traceRay(const Ray& r, const InstancedScene& scene, const RenderSettings& settings) {
+    InstanceHit hit;
+    if (!scene.intersect(r, hit)) {
+        return Color(0, 0, 0);
+    }
+    
+    return shade(r, hit, scene, settings);
+}
+
+Color traceRay(const Ray& r, const ShapeScene& scene, const RenderSettings& settings) {
+    ShapeHit hit;
+    if (!scene.intersect(r, hit)) {
+        return Color(0, 0, 0);
+    }
+    
+    return shade(r, hit, scene, settings);
+}
+
+Color traceRay(const Ray& r, const TriangleBuffer& triangles, const WideBVH& bvh, const RenderSettings& settings) {
+    float t = MAXFLOAT;
+    const int index = bvh.intersect(r, t);
+    if (index == INT_MAX) {
+        return Color(0, 0, 0);
+    }
+    
+    return shadeHit(r, t, index, triangles, settings, [&](const Ray& ray, float& tHit) {
+        return bvh.intersect(ray, tHit);
+    }, [&](const Ray& shadowRay, float lightDistance) {
+        return bvh.occluded(shadowRay, lightDistance);
+    });
+}
+
+Color traceRay(const Ray& r, const TriangleBuffer& triangles, const UniformGrid& grid, const RenderSettings& settings) {
+    float t = MAXFLOAT;
+    const int index = grid.intersect(r, t);
+    if (index == INT_MAX) {
+        return Color(0, 0, 0);
+    }
+    
+    return shadeHit(r, t, index, triangles, settings, [&](const Ray& ray, float& tHit) {
+        return grid.intersect(ray, tHit);
+    }, [&](const Ray& shadowRay, float lightDistance) {
+        return grid.occluded(shadowRay, lightDistance);
+    });
+}
+
+namespace {
+
+const int packetWidth = simd::width == 8 ? 4 : 2;
+const int packetHeight = simd::width / packetWidth;
+
+//Rounded mean of the per-sample colors summed into sum
+Color resolve(const int sum[3], int samples) {
+    return Color(static_cast<unsigned char>((sum[0] + samples / 2) / samples), static_cast<unsigned char>((sum[1] + samples / 2) / samples),
+                 static_cast<unsigned char>((sum[2] + samples / 2) / samples));
+}
+
+#ifdef RT_ENABLE_STATS
+//Adds the work the calling thread did since it read before to the pixel
+void addPixelCost(cv::Mat* pixelCosts, int i, int j, long long before) {
+    if (pixelCosts) {
+        pixelCosts->at<int>(i, j) += static_cast<int>(getThreadCounters().getCost() - before);
+    }
+}
+#endif
+
+//One ray at a time through the tile, trace(ray) returns the color seen along it
+template <typename Trace>
+void renderTileRays(cv::Mat& frame, const RayGenerator& rays, const cv::Rect& tile, cv::Mat* pixelCosts, const Trace& trace) {
+    const int samples = rays.getSampleCount();
+    std::vector<Ray> row(tile.width);
+    for (int i = tile.y; i < tile.y + tile.height; ++i) {
+        if (samples == 1) {
+            rays.generateRow(i, tile.x, tile.width, row.data());
+            for (int j = 0; j < tile.width; ++j) {
+                RT_STATS(const long long before = getThreadCounters().getCost());
+                frame.at<cv::Vec3b>(i, tile.x + j) = trace(row[j]);
+                RT_STATS(addPixelCost(pixelCosts, i, tile.x + j, before));
+            }
+            continue;
+        }
+        for (int j = tile.x; j < tile.x + tile.width; ++j) {
+            RT_STATS(const long long before = getThreadCounters().getCost());
+            int sum[3] = {};
+            for (int s = 0; s < samples; ++s) {
+                const Color color = trace(rays.getSample(i, j, s));
+                for (int c = 0; c < 3; ++c) {
+                    sum[c] += color[c];
+                }
+            }
+            frame.at<cv::Vec3b>(i, j) = resolve(sum, samples);
+            RT_STATS(addPixelCost(pixelCosts, i, j, before));
+        }
+    }
+}
+
+//Sums over the samples of one pixel for its features
+struct FeatureSums {
+    int samples = 0;
+    int hits = 0;
+    float depth = 0.f;
+    glm::vec3 normal = glm::vec3(0.f);
+    glm::vec3 albedo = glm::vec3(0.f);
+    
+    //index and t are what traceRay returned for the sample
+    void add(const Ray& r, int index, float t, const TriangleBuffer& triangles, const RenderSettings& settings) {
+        ++samples;
+        if (index == INT_MAX) {
+            return;
+        }
+        ++hits;
+        depth += t;
+        normal += getFacingNormal(r, triangles, index);
+        const Color surface = getSurfaceColor(r, t, index, triangles, settings, 0.f);
+        albedo += glm::vec3(surface[0], surface[1], surface[2]);
+    }
+    
+    void store(FeatureBuffers& features, int i, int j) const {
+        const glm::vec3 meanNormal = normal / static_cast<float>(samples);
+        const glm::vec3 meanAlbedo = albedo / static_cast<float>(samples);
+        features.coverage.at<float>(i, j) = static_cast<float>(hits) / samples;
+        features.depths.at<float>(i, j) = hits > 0 ? depth / hits : 0.f;
+        features.normals.at<cv::Vec3f>(i, j) = cv::Vec3f(meanNormal.x, meanNormal.y, meanNormal.z);
+        features.albedo.at<cv::Vec3f>(i, j) = cv::Vec3f(meanAlbedo.x, meanAlbedo.y, meanAlbedo.z);
+    }
+};
+
+//Feature buffers for a frame, filled in by the tiles
+void resetFeatures(FeatureBuffers* features, int width, int height, int samples) {
+    if (features) {
+        features->samples = samples;
+        features->coverage.create(height, width, CV_32F);
+        features->depths.create(height, width, CV_32F);
+        features->normals.create(height, width, CV_32FC3);
+        features->albedo.create(height, width, CV_32FC3);
+    }
+}
+
+//Same rays as renderTileRays, the primary hits of the samples are kept for the denoiser as well
+void renderTileFeatures(cv::Mat& frame, const RayGenerator& rays, const TriangleBuffer& triangles, const BVH* bvh, const cv::Rect& tile, const RenderSettings& settings,
+                        FeatureBuffers& features, cv::Mat* pixelCosts) {
+    const int samples = rays.getSampleCount();
+    for (int i = tile.y; i < tile.y + tile.height; ++i) {
+        for (int j = tile.x; j < tile.x + tile.width; ++j) {
+            RT_STATS(const long long before = getThreadCounters().getCost());
+            int sum[3] = {};
+            FeatureSums sums;
+            for (int s = 0; s < samples; ++s) {
+                const Ray r = samples == 1 ? rays.getRay(i, j) : rays.getSample(i, j, s);
+                int index;
+                float t;
+                const Color color = traceRay(r, triangles, bvh, settings, index, t);
+                for (int c = 0; c < 3; ++c) {
+                    sum[c] += color[c];
+                }
+                sums.add(r, index, t, triangles, settings);
+            }
+            frame.at<cv::Vec3b>(i, j) = resolve(sum, samples);
+            sums.store(features, i, j);
+            RT_STATS(addPixelCost(pixelCosts, i, j, before));
+        }
+    }
+}
+
+//Radical inverse of index in the given base, successive indices keep filling the gaps of [0, 1)
+float radicalInverse(int index, int base) {
+    float result = 0.f;
+    float scale = 1.f / base;
+    for (; index > 0; index /= base) {
+        result += (index % base) * scale;
+        scale /= base;
+    }
+    
+    return result;
+}
+
+//Running sums of the samples of one pixel
+struct PixelEstimate {
+    int sum[3] = {};
+    long long sumSquares[3] = {};
+    int samples = 0;
+    int passes = 0;
+    
+    float getMean(int c) const {
+        return static_cast<float>(sum[c]) / samples;
+    }
+    
+    //The squared standard error of the mean is the sample variance over the sample count
+    bool isConverged(float errorThreshold) const {
+        if (samples < 2) {
+            return false;
+        }
+        for (int c = 0; c < 3; ++c) {
+            const float variance = (sumSquares[c] - static_cast<float>(sum[c]) * sum[c] / samples) / (samples - 1);
+            if (variance > errorThreshold * errorThreshold * samples) {
+                return false;
+            }
+        }
+        
+        return true;
+    }
+};
+
+//One sample per stratum of the generator, the first pass hits the stratum centers like uniform sampling
+//Later passes are shifted inside the strata along the 2, 3 Halton sequence
+template <typename Trace>
+void addSamplePass(const RayGenerator& rays, int i, int j, int maxSamples, const Trace& trace, PixelEstimate& estimate) {
+    float jitterX = radicalInverse(estimate.passes, 2) + 0.5f;
+    float jitterY = radicalInverse(estimate.passes, 3) + 0.5f;
+    jitterX -= std::floor(jitterX);
+    jitterY -= std::floor(jitterY);
+    for (int s = 0; s < rays.getSampleCount() && estimate.samples < maxSamples; ++s, ++estimate.samples) {
+        const Color sample = trace(rays.getSample(i, j, s, jitterX, jitterY));
+        for (int c = 0; c < 3; ++c) {
+            estimate.sum[c] += sample[c];
+            estimate.sumSquares[c] += sample[c] * sample[c];
+        }
+    }
+    ++estimate.passes;
+}
+
+//Every pixel of the tile gets one pass first, then the noisy ones and the ones on a visible edge are refined
+//Edges thinner than a stratum can slip through all samples of a pixel, its neighbours still see them
+//The first pass also covers a one pixel border around the tile, so an edge along the tile's side is found from both tiles
+template <typename Trace>
+void renderTileAdaptive(cv::Mat& frame, const RayGenerator& rays, const cv::Rect& tile, const AdaptiveSampling& adaptive, cv::Mat* sampleCounts, cv::Mat* pixelCosts,
+                        const Trace& trace) {
+    const int maxSamples = std::max(adaptive.maxSamples, 2);
+    const int x0 = std::max(tile.x - 1, 0);
+    const int y0 = std::max(tile.y - 1, 0);
+    const int width = std::min(tile.x + tile.width + 1, rays.getWidth()) - x0;
+    const int height = std::min(tile.y + tile.height + 1, rays.getHeight()) - y0;
+    auto isInTile = [&](int x, int y) {
+        return x0 + x >= tile.x && x0 + x < tile.x + tile.width && y0 + y >= tile.y && y0 + y < tile.y + tile.height;
+    };
+    std::vector<PixelEstimate> estimates(width * height);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            //The border pixels belong to other tiles, their cost is counted there
+            RT_STATS(const long long before = getThreadCounters().getCost());
+            addSamplePass(rays, y0 + y, x0 + x, maxSamples, trace, estimates[y * width + x]);
+            if (isInTile(x, y)) {
+                RT_STATS(addPixelCost(pixelCosts, y0 + y, x0 + x, before));
+            }
+        }
+    }
+    
+    std::vector<char> onEdge(estimates.size(), 0);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const PixelEstimate& estimate = estimates[y * width + x];
+            const int neighbours[2][2] = {{x + 1, y}, {x, y + 1}};
+            for (const auto& n : neighbours) {
+                if (n[0] >= width || n[1] >= height) {
+                    continue;
+                }
+                const PixelEstimate& neighbour = estimates[n[1] * width + n[0]];
+                for (int c = 0; c < 3; ++c) {
+                    if (std::abs(estimate.getMean(c) - neighbour.getMean(c)) > adaptive.contrastThreshold) {
+                        onEdge[y * width + x] = onEdge[n[1] * width + n[0]] = 1;
+                    }
+                }
+            }
+        }
+    }
+    
+    for (int y = tile.y - y0; y < tile.y - y0 + tile.height; ++y) {
+        for (int x = tile.x - x0; x < tile.x - x0 + tile.width; ++x) {
+            PixelEstimate& estimate = estimates[y * width + x];
+            const int minSamples = onEdge[y * width + x] ? adaptive.edgeSamples : 0;
+            RT_STATS(const long long before = getThreadCounters().getCost());
+            while (estimate.samples < maxSamples && (estimate.samples < minSamples || !estimate.isConverged(adaptive.errorThreshold))) {
+                addSamplePass(rays, y0 + y, x0 + x, maxSamples, trace, estimate);
+            }
+            RT_STATS(addPixelCost(pixelCosts, y0 + y, x0 + x, before));
+            frame.at<cv::Vec3b>(y0 + y, x0 + x) = resolve(estimate.sum, estimate.samples);
+            if (sampleCounts) {
+                sampleCounts->at<int>(y0 + y, x0 + x) = estimate.samples;
+            }
+        }
+    }
+}
+
+//Splits the frame into tiles that are rendered on the pool
+//The counters of each tile are taken on the thread that rendered it and summed into stats when it is given
+template <typename RenderTile>
+void renderTiles(cv::Mat& frame, ThreadPool& pool, int tileSize, FrameStats* stats, const RenderTile& render) {
+    const int tilesX = (frame.cols + tileSize - 1) / tileSize;
+    const int tilesY = (frame.rows + tileSize - 1) / tileSize;
+    if (stats) {
+        stats->tiles.assign(tilesX * tilesY, TileStats());
+    }
+    pool.parallelFor(tilesX * tilesY, [&](int index) {
+        const int x = (index % tilesX) * tileSize;
+        const int y = (index / tilesX) * tileSize;
+        const cv::Rect tile(x, y, std::min(tileSize, frame.cols - x), std::min(tileSize, frame.rows - y));
+        RT_STATS(const TraversalCounters before = getThreadCounters());
+        render(tile);
+        if (stats) {
+            stats->tiles[index].tile = tile;
+            RT_STATS(stats->tiles[index].counters = getThreadCounters() - before);
+        }
+    });
+    if (stats) {
+        for (const TileStats& tile : stats->tiles) {
+            stats->total += tile.counters;
+        }
+    }
+}
+
+//Fresh stats for a frame of the given size, nothing happens without them
+void resetStats(FrameStats* stats, int width, int height) {
+    if (stats) {
+        *stats = FrameStats();
+        stats->pixelCosts = cv::Mat::zeros(height, width, CV_32S);
+    }
+}
+
+void renderTilePackets(cv::Mat& frame, const RayGenerator& rays, const TriangleBuffer& triangles, const BVH& bvh, const cv::Rect& tile, const RenderSettings& settings,
+                       cv::Mat* pixelCosts, FeatureBuffers* features) {
+    const int samples = rays.getSampleCount();
+    for (int i = tile.y; i < tile.y + tile.height; i += packetHeight) {
+        for (int j = tile.x; j < tile.x + tile.width; j += packetWidth) {
+            RT_STATS(const long long before = getThreadCounters().getCost());
+            //Each pass traces the same stratum of every pixel in the packet, keeping the rays coherent
+            int sums[simd::width][3] = {};
+            FeatureSums featureSums[simd::width];
+            RayPacket packet;
+            for (int s = 0; s < samples; ++s) {
+                for (int lane = 0; lane < simd::width; ++lane) {
+                    const int y = i + lane / packetWidth;
+                    const int x = j + lane % packetWidth;
+                    if (y < tile.y + tile.height && x < tile.x + tile.width) {
+                        packet.setRay(lane, samples == 1 ? rays.getRay(y, x) : rays.getSample(y, x, s));
+                    }
+                }
+                
+                int indices[simd::width];
+                float t[simd::width];
+                bvh.intersect(packet, indices, t);
+                for (int lane = 0; lane < simd::width; ++lane) {
+                    if (!(packet.activeMask & (1 << lane))) {
+                        continue;
+                    }
+                    const Color color = indices[lane] == INT_MAX ? Color(0, 0, 0) : shadeHit(packet.getRay(lane), t[lane], indices[lane], triangles, &bvh, settings);
+                    for (int c = 0; c < 3; ++c) {
+                        sums[lane][c] += color[c];
+                    }
+                    if (features) {
+                        featureSums[lane].add(packet.getRay(lane), indices[lane], t[lane], triangles, settings);
+                    }
+                }
+            }
+            for (int lane = 0; lane < simd::width; ++lane) {
+                if (packet.activeMask & (1 << lane)) {
+                    frame.at<cv::Vec3b>(i + lane / packetWidth, j + lane % packetWidth) = resolve(sums[lane], samples);
+                    if (features) {
+                        featureSums[lane].store(*features, i + lane / packetWidth, j + lane % packetWidth);
+                    }
+                }
+            }
+#ifdef RT_ENABLE_STATS
+            if (pixelCosts) {
+                const long long share = (getThreadCounters().getCost() - before) / simd::countLanes(packet.activeMask);
+                for (int lane = 0; lane < simd::width; ++lane) {
+                    if (packet.activeMask & (1 << lane)) {
+                        pixelCosts->at<int>(i + lane / packetWidth, j + lane % packetWidth) += static_cast<int>(share);
+                    }
+                }
+            }
+#endif
+        }
+    }
+}
+
+//Primary hits from the visibility buffer of the tile, shaded like traced ones
+void renderTileHybrid(cv::Mat& frame, const RayGenerator& rays, const Rasterizer& rasterizer, const TriangleBuffer& triangles, const BVH& bvh, const cv::Rect& tile,
+                      const RenderSettings& requested, cv::Mat& ids, cv::Mat& depths, cv::Mat* pixelCosts) {
+    const RenderSettings settings = withPixelAngle(requested, rays);
+    RT_STATS(const long long before = getThreadCounters().getCost());
+    rasterizer.rasterize(tile, rays, ids, depths);
+#ifdef RT_ENABLE_STATS
+    //The rasterization is shared evenly between the pixels of the tile
+    if (pixelCosts) {
+        const int share = static_cast<int>((getThreadCounters().getCost() - before) / (tile.width * tile.height));
+        for (int i = tile.y; i < tile.y + tile.height; ++i) {
+            for (int j = tile.x; j < tile.x + tile.width; ++j) {
+                pixelCosts->at<int>(i, j) += share;
+            }
+        }
+    }
+#endif
+    std::vector<Ray> row(tile.width);
+    for (int i = tile.y; i < tile.y + tile.height; ++i) {
+        rays.generateRow(i, tile.x, tile.width, row.data());
+        for (int j = 0; j < tile.width; ++j) {
+            const int index = ids.at<int>(i, tile.x + j);
+            if (index == INT_MAX) {
+                continue;
+            }
+            RT_STATS(const long long before = getThreadCounters().getCost());
+            frame.at<cv::Vec3b>(i, tile.x + j) = shadeHit(row[j], depths.at<float>(i, tile.x + j), index, triangles, &bvh, settings);
+            RT_STATS(addPixelCost(pixelCosts, i, tile.x + j, before));
+        }
+    }
+}
+
+}
+
+void renderTile(cv::Mat& frame, const RayGenerator& rays, const TriangleBuffer& triangles, const BVH* bvh, const cv::Rect& tile,
+                const RenderSettings& requested, cv::Mat* sampleCounts, cv::Mat* pixelCosts, FeatureBuffers* features) {
+    const RenderSettings settings = withPixelAngle(requested, rays);
+    auto trace = [&](const Ray& r) {
+        return traceRay(r, triangles, bvh, settings);
+    };
+    if (settings.adaptive.enabled) {
+        renderTileAdaptive(frame, rays, tile, settings.adaptive, sampleCounts, pixelCosts, trace);
+        return;
+    }
+    
+    if (sampleCounts) {
+        (*sampleCounts)(tile).setTo(rays.getSampleCount());
+    }
+    if (bvh && settings.usePackets) {
+        renderTilePackets(frame, rays, triangles, *bvh, tile, settings, pixelCosts, features);
+        return;
+    }
+    if (features) {
+        renderTileFeatures(frame, rays, triangles, bvh, tile, settings, *features, pixelCosts);
+        return;
+    }
+    renderTileRays(frame, rays, tile, pixelCosts, trace);
+}
+
+void renderTile(cv::Mat& frame, const RayGenerator& rays, const InstancedScene& scene, const cv::Rect& tile, const RenderSettings& settings) {
+    auto trace = [&](const Ray& r) {
+        return traceRay(r, scene, settings);
+    };
+    if (settings.adaptive.enabled) {
+        renderTileAdaptive(frame, rays, tile, settings.adaptive, nullptr, nullptr, trace);
+        return;
+    }
+    
+    renderTileRays(frame, rays, tile, nullptr, trace);
+}
+
+void renderTile(cv::Mat& frame, const RayGenerator& rays, const ShapeScene& scene, const cv::Rect& tile, const RenderSettings& requested) {
+    const RenderSettings settings = withPixelAngle(requested, rays);
+    auto trace = [&](const Ray& r) {
+        return traceRay(r, scene, settings);
+    };
+    if (settings.adaptive.enabled) {
+        renderTileAdaptive(frame, rays, tile, settings.adaptive, nullptr, nullptr, trace);
+        return;
+    }
+    
+    renderTileRays(frame, rays, tile, nullptr, trace);
+}
+
+void renderTile(cv::Mat& frame, const RayGenerator& rays, const TriangleBuffer& triangles, const WideBVH& bvh, const cv::Rect& tile, const RenderSettings& requested,
+                cv::Mat* pixelCosts) {
+    const RenderSettings settings = withPixelAngle(requested, rays);
+    auto trace = [&](const Ray& r) {
+        return traceRay(r, triangles, bvh, settings);
+    };
+    if (settings.adaptive.enabled) {
+        renderTileAdaptive(frame, rays, tile, settings.adaptive, nullptr, pixelCosts, trace);
+        return;
+    }
+    
+    renderTileRays(frame, rays, tile, pixelCosts, trace);
+}
+
+void renderTile(cv::Mat& frame, const RayGenerator& rays, const TriangleBuffer& triangles, const UniformGrid& grid, const cv::Rect& tile, const RenderSettings& requested,
+                cv::Mat* pixelCosts) {
+    const RenderSettings settings = withPixelAngle(requested, rays);
+    auto trace = [&](const Ray& r) {
+        return traceRay(r, triangles, grid, settings);
+    };
+    if (settings.adaptive.enabled) {
+        renderTileAdaptive(frame, rays, tile, settings.adaptive, nullptr, pixelCosts, trace);
+        return;
+    }
+    
+    renderTileRays(frame, rays, tile, pixelCosts, trace);
+}
+
+cv::Mat rayTracing(const PerspectiveCamera& cam, const TriangleBuffer& triangles, const BVH* bvh) {
+    const int width = cam.getWidth();
+    const int height = cam.getHeight();
+    cv::Mat frame = cv::Mat::zeros(height, width, CV_8UC3);
+    renderTile(frame, RayGenerator(cam), triangles, bvh, cv::Rect(0, 0, width, height));
+    
+    return frame;
+}
+
+cv::Mat rayTracing(const PerspectiveCamera& cam, const TriangleBuffer& triangles, const BVH* bvh, ThreadPool& pool, const RenderSettings& settings,
+                   cv::Mat* sampleCounts, FrameStats* stats, FeatureBuffers* features) {
+    const int width = cam.getWidth();
+    const int height = cam.getHeight();
+    cv::Mat frame = cv::Mat::zeros(height, width, CV_8UC3);
+    if (sampleCounts) {
+        sampleCounts->create(height, width, CV_32S);
+    }
+    resetStats(stats, width, height);
+    if (settings.wavefront && bvh) {
+        if (sampleCounts) {
+            sampleCounts->setTo(RayGenerator(cam, settings.samplesPerPixel).getSampleCount());
+        }
+        return renderWavefront(cam, triangles, *bvh, pool, settings);
+    }
+    if (settings.rasterizePrimary && bvh && !settings.adaptive.enabled && settings.samplesPerPixel <= 1) {
+        if (sampleCounts) {
+            sampleCounts->setTo(1);
+        }
+        const RayGenerator rays(cam);
+        const Rasterizer rasterizer(cam, triangles, settings.tileSize, pool);
+        cv::Mat ids(height, width, CV_32S);
+        cv::Mat depths(height, width, CV_32F);
+        renderTiles(frame, pool, settings.tileSize, stats, [&](const cv::Rect& tile) {
+            renderTileHybrid(frame, rays, rasterizer, triangles, *bvh, tile, settings, ids, depths, stats ? &stats->pixelCosts : nullptr);
+        });
+        
+        return frame;
+    }
+    const RayGenerator rays(cam, settings.adaptive.enabled ? settings.adaptive.baseSamples : settings.samplesPerPixel);
+    if (!settings.adaptive.enabled) {
+        resetFeatures(features, width, height, rays.getSampleCount());
+    }
+    renderTiles(frame, pool, settings.tileSize, stats, [&](const cv::Rect& tile) {
+        renderTile(frame, rays, triangles, bvh, tile, settings, sampleCounts, stats ? &stats->pixelCosts : nullptr, settings.adaptive.enabled ? nullptr : features);
+    });
+    
+    return frame;
+}
+
+cv::Mat rayTracing(const PerspectiveCamera& cam, const InstancedScene& scene, ThreadPool& pool, const RenderSettings& settings) {
+    cv::Mat frame = cv::Mat::zeros(cam.getHeight(), cam.getWidth(), CV_8UC3);
+    const RayGenerator rays(cam, settings.adaptive.enabled ? settings.adaptive.baseSamples : settings.samplesPerPixel);
+    renderTiles(frame, pool, settings.tileSize, nullptr, [&](const cv::Rect& tile) {
+        renderTile(frame, rays, scene, tile, settings);
+    });
+    
+    return frame;
+}
+
+cv::Mat rayTracing(const PerspectiveCamera& cam, const ShapeScene& scene, ThreadPool& pool, const RenderSettings& settings) {
+    cv::Mat frame = cv::Mat::zeros(cam.getHeight(), cam.getWidth(), CV_8UC3);
+    const RayGenerator rays(cam, settings.adaptive.enabled ? settings.adaptive.baseSamples : settings.samplesPerPixel);
+    renderTiles(frame, pool, settings.tileSize, nullptr, [&](const cv::Rect& tile) {
+        renderTile(frame, rays, scene, tile, settings);
+    });
+    
+    return frame;
+}
+
+cv::Mat rayTracing(const PerspectiveCamera& cam, const TriangleBuffer& triangles, const WideBVH& bvh, ThreadPool& pool, const RenderSettings& settings,
+                   FrameStats* stats) {
+    cv::Mat frame = cv::Mat::zeros(cam.getHeight(), cam.getWidth(), CV_8UC3);
+    resetStats(stats, cam.getWidth(), cam.getHeight());
+    const RayGenerator rays(cam, settings.adaptive.enabled ? settings.adaptive.baseSamples : settings.samplesPerPixel);
+    renderTiles(frame, pool, settings.tileSize, stats, [&](const cv::Rect& tile) {
+        renderTile(frame, rays, triangles, bvh, tile, settings, stats ? &stats->pixelCosts : nullptr);
+    });
+    
+    return frame;
+}
+
+cv::Mat rayTracing(const PerspectiveCamera& cam, const TriangleBuffer& triangles, const UniformGrid& grid, ThreadPool& pool, const RenderSettings& settings,
+                   FrameStats* stats) {
+    cv::Mat frame = cv::Mat::zeros(cam.getHeight(), cam.getWidth(), CV_8UC3);
+    resetStats(stats, cam.getWidth(), cam.getHeight());
+    const RayGenerator rays(cam, settings.adaptive.enabled ? settings.adaptive.baseSamples : settings.samplesPerPixel);
+    renderTiles(frame, pool, settings.tileSize, stats, [&](const cv::Rect& tile) {
+        renderTile(frame, rays, triangles, grid, tile, settings, stats ? &stats->pixelCosts : nullptr);
+    });
+    
+    return frame;
+}
+
+bool rayTracingBatch(const std::vector<PerspectiveCamera>& cameras, const TriangleBuffer& triangles, const BVH& bvh, ThreadPool& pool,
+                     const RenderSettings& settings, const std::function<void(int, const cv::Mat&)>& onView) {
+    //Set up by the first tile of the view that runs, dropped once the view is handed out
+    struct View {
+        std::once_flag started;
+        std::atomic<int> remainingTiles;
+        cv::Mat frame;
+        std::unique_ptr<RayGenerator> rays;
+    };
+    
+    const int tileSize = settings.tileSize;
+    if (tileSize <= 0) {
+        std::cout << "Invalid tile size " << tileSize << std::endl;
+        return false;
+    }
+    
+    //Batches of views bound the queued work items and the frames in flight, a batch only waits for its last tiles once
+    const int batchSize = 16 * pool.getThreadCount();
+    for (int first = 0; first < static_cast<int>(cameras.size()); first += batchSize) {
+        const int count = std::min(batchSize, static_cast<int>(cameras.size()) - first);
+        std::vector<View> views(count);
+        //Work items of view v are [itemStart[v], itemStart[v + 1]), views may differ in size
+        std::vector<int> itemStart(count + 1, 0);
+        for (int v = 0; v < count; ++v) {
+            const PerspectiveCamera& cam = cameras[first + v];
+            const int tiles = ((cam.getWidth() + tileSize - 1) / tileSize) * ((cam.getHeight() + tileSize - 1) / tileSize);
+            views[v].remainingTiles = tiles;
+            itemStart[v + 1] = itemStart[v] + tiles;
+            //No tile would ever finish an empty view
+            if (tiles == 0) {
+                onView(first + v, cv::Mat::zeros(cam.getHeight(), cam.getWidth(), CV_8UC3));
+            }
+        }
+        
+        pool.parallelFor(itemStart[count], [&](int item) {
+            const int v = static_cast<int>(std::upper_bound(itemStart.begin(), itemStart.end(), item) - itemStart.begin()) - 1;
+            View& view = views[v];
+            const PerspectiveCamera& cam = cameras[first + v];
+            std::call_once(view.started, [&]() {
+                view.frame = cv::Mat::zeros(cam.getHeight(), cam.getWidth(), CV_8UC3);
+                view.rays.reset(new RayGenerator(cam, settings.adaptive.enabled ? settings.adaptive.baseSamples : settings.samplesPerPixel));
+            });
+            
+            const int tilesX = (cam.getWidth() + tileSize - 1) / tileSize;
+            const int x = ((item - itemStart[v]) % tilesX) * tileSize;
+            const int y = ((item - itemStart[v]) / tilesX) * tileSize;
+            const cv::Rect tile(x, y, std::min(tileSize, cam.getWidth() - x), std::min(tileSize, cam.getHeight() - y));
+            renderTile(view.frame, *view.rays, triangles, &bvh, tile, settings);
+            if (--view.remainingTiles == 0) {
+                onView(first + v, view.frame);
+                view.frame = cv::Mat();
+                view.rays.reset();
+            }
+        });
+    }
+    
+    return true;
+}
@@ -0,0 +1,164 @@
+//
+//  RayTracer.hpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#ifndef RayTracer_hpp
+#define RayTracer_hpp
+
+#include <functional>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "TriangleBuffer.hpp"
+#include "PerspectiveCamera.hpp"
+#include "BVH.hpp"
+#include "InstancedScene.hpp"
+#include "ShapeScene.hpp"
+#include "WideBVH.hpp"
+#include "UniformGrid.hpp"
+#include "RayGenerator.hpp"
+#include "FrameStats.hpp"
+#include "Texture.hpp"
+#include "ThreadPool.hpp"
+
+//Point light with the Phong terms of the cylinder shader, light colors are white
+struct PointLight {
+    glm::vec3 position = {-3.f, 3.f, 5.f};
+    float ambient = 0.1f;
+    float diffuse = 1.f;
+    float specular = 1.f;
+    float shininess = 120.f;
+};
+
+//Takes baseSamples per pixel, then keeps adding batches of baseSamples while the pixel looks noisy
+//The batches are stratified like samplesPerPixel, renderTile takes one sample per stratum of its generator in every batch
+struct AdaptiveSampling {
+    bool enabled = false;
+    int baseSamples = 4;
+    int maxSamples = 64;
+    //Largest standard error of the pixel mean, in 0-255 color units, that ends sampling of a pixel
+    float errorThreshold = 1.5f;
+    //Neighbouring pixels whose means differ by more than this lie on an edge and take at least edgeSamples
+    float contrastThreshold = 24.f;
+    int edgeSamples = 32;
+};
+
+struct RenderSettings {
+    int tileSize = 32;
+    //Traces 2x2 (SSE) or 4x2 (AVX) bundles of primary rays through the BVH
+    bool usePackets = false;
+    //Phong shading with hard shadows from the light instead of the flat triangle color
+    bool shading = false;
+    PointLight light;
+    //Stratified samples per pixel, averaged into the final color
+    int samplesPerPixel = 1;
+    //Replaces the fixed samplesPerPixel and packet tracing when enabled
+    AdaptiveSampling adaptive;
+    //Mirror reflections on triangle scenes, a hit keeps 1 - reflectivity of its own color and takes the rest from the reflected ray
+    float reflectivity = 0.f;
+    int maxBounces = 0;
+    //Traces BVH scenes in waves, the secondary rays of a wave are binned by direction octant and origin before they are traced
+    //Takes the place of the tiles, packets and adaptive sampling
+    bool wavefront = false;
+    //Finds the primary hits of BVH scenes with a z-buffer rasterizer instead of rays, only shadows and reflections are traced
+    //The image is the same, it is used with one sample per pixel and without adaptive sampling
+    bool rasterizePrimary = false;
+    //Paints the triangles with the texture at their texture coordinates, tinted by the triangle colors
+    //The mip level follows the width of the pixel's ray cone at the hit, instanced and shape scenes keep their flat colors
+    const Texture* texture = nullptr;
+    //Angle between the rays of neighbouring pixels the ray cones start with, the renderers take it from their RayGenerator when it is 0
+    float pixelAngle = 0.f;
+};
+
+//Primary hits of the samples a render takes, averaged per pixel, the edges of the image as the denoiser sees them
+struct FeatureBuffers {
+    //Samples per pixel the means are taken over
+    int samples = 0;
+    //CV_32F, fraction of the samples that hit something
+    cv::Mat coverage;
+    //CV_32F, mean distance of the hits along their rays, 0 where nothing is hit
+    cv::Mat depths;
+    //CV_32FC3, mean of the normals turned towards the camera, shorter than 1 where the samples hit differently oriented surfaces
+    cv::Mat normals;
+    //CV_32FC3, mean color of the hit surfaces before shading, 0-255
+    cv::Mat albedo;
+};
+
+//The offsets place the ray inside the pixel, (0.5, 0.5) is its center
+//Sets up the whole camera for a single ray, loops over pixels should use a RayGenerator
+Ray constructRayThroughPixel(const PerspectiveCamera& camera, int i, int j, float offsetX = 0.5f, float offsetY = 0.5f);
+int getSceneIntersection (const Ray& r, const TriangleBuffer& triangles);
+int getSceneIntersection (const Ray& r, const BVH& bvh);
+int getSceneIntersection (const Ray& r, const UniformGrid& grid);
+//True when anything blocks the ray before tMax
+bool isOccluded(const Ray& r, float tMax, const TriangleBuffer& triangles, const BVH* bvh);
+//Ray from a surface point towards the light, lightDistance is where it has to stop
+Ray constructShadowRay(const glm::vec3& point, const glm::vec3& normal, const glm::vec3& lightPosition, float& lightDistance);
+//Mirrored ray leaving a surface point, the normal has to face the incoming ray
+Ray constructReflectionRay(const glm::vec3& point, const glm::vec3& normal, const glm::vec3& dir);
+//Shadow ray shading would trace for the hit, false when the light is behind the surface and nothing has to be traced
+bool getShadowQuery(const Ray& r, float t, int index, const TriangleBuffer& triangles, const RenderSettings& settings, Ray& shadowRay, float& lightDistance);
+//Color of the hit on the given triangle at distance t along the ray
+//pathLength is how far the ray travelled before r.p0, reflections widen the texture footprint with it
+Color shade(const Ray& r, float t, int index, const TriangleBuffer& triangles, const BVH* bvh, const RenderSettings& settings, float pathLength = 0.f);
+//Same color with the answer of the shadow query already known
+Color shadeWithShadow(const Ray& r, float t, int index, const TriangleBuffer& triangles, bool lightBlocked, const RenderSettings& settings, float pathLength = 0.f);
+Color shade(const Ray& r, const InstanceHit& hit, const InstancedScene& scene, const RenderSettings& settings);
+Color shade(const Ray& r, const ShapeHit& hit, const ShapeScene& scene, const RenderSettings& settings);
+//Rounds an accumulated color, clamped to 255
+Color toColor(const glm::vec3& color);
+//Copy of the settings with pixelAngle taken from the generator unless it was set
+RenderSettings withPixelAngle(const RenderSettings& settings, const RayGenerator& rays);
+//Color seen along the ray, black when nothing is hit
+Color traceRay(const Ray& r, const TriangleBuffer& triangles, const BVH* bvh, const RenderSettings& settings = RenderSettings());
+//Same color, index and t are set to the slot and the distance of the hit, index is INT_MAX when nothing is hit
+Color traceRay(const Ray& r, const TriangleBuffer& triangles, const BVH* bvh, const RenderSettings& settings, int& index, float& t);
+Color traceRay(const Ray& r, const InstancedScene& scene, const RenderSettings& settings = RenderSettings());
+//Shapes are shaded like the triangles, with shadows but without reflections
+Color traceRay(const Ray& r, const ShapeScene& scene, const RenderSettings& settings = RenderSettings());
+//Shaded like the binary BVH path with shadows and reflections, the wide BVH answers the closest hit, shadow and reflection queries
+Color traceRay(const Ray& r, const TriangleBuffer& triangles, const WideBVH& bvh, const RenderSettings& settings = RenderSettings());
+//Same shading again with the grid answering the closest hit, shadow and reflection queries
+Color traceRay(const Ray& r, const TriangleBuffer& triangles, const UniformGrid& grid, const RenderSettings& settings = RenderSettings());
+//Takes as many samples per pixel as the generator has strata, or as many as adaptive sampling asks for
+//sampleCounts (CV_32S, frame sized) receives the number of samples of every pixel when it is given
+//pixelCosts (CV_32S, frame sized) gets the traversal cost of every pixel added in builds with RT_ENABLE_STATS
+//features, allocated for the frame, receives the primary hits of the samples, adaptive sampling leaves it untouched
+void renderTile(cv::Mat& frame, const RayGenerator& rays, const TriangleBuffer& triangles, const BVH* bvh, const cv::Rect& tile,
+                const RenderSettings& settings = RenderSettings(), cv::Mat* sampleCounts = nullptr, cv::Mat* pixelCosts = nullptr,
+                FeatureBuffers* features = nullptr);
+//Instanced scenes are traced one ray at a time, usePackets is ignored
+void renderTile(cv::Mat& frame, const RayGenerator& rays, const InstancedScene& scene, const cv::Rect& tile, const RenderSettings& settings = RenderSettings());
+//Scenes with shapes are traced one ray at a time as well
+void renderTile(cv::Mat& frame, const RayGenerator& rays, const ShapeScene& scene, const cv::Rect& tile, const RenderSettings& settings = RenderSettings());
+//Single rays through the wide BVH, usePackets is ignored
+void renderTile(cv::Mat& frame, const RayGenerator& rays, const TriangleBuffer& triangles, const WideBVH& bvh, const cv::Rect& tile, const RenderSettings& settings = RenderSettings(),
+                cv::Mat* pixelCosts = nullptr);
+//Single rays through the grid, usePackets is ignored
+void renderTile(cv::Mat& frame, const RayGenerator& rays, const TriangleBuffer& triangles, const UniformGrid& grid, const cv::Rect& tile, const RenderSettings& settings = RenderSettings(),
+                cv::Mat* pixelCosts = nullptr);
+//Without a BVH every triangle is tested, which is kept as the reference mode
+cv::Mat rayTracing(const PerspectiveCamera& cam, const TriangleBuffer& triangles, const BVH* bvh = nullptr);
+//Same per pixel work as rayTracing, split into tiles that are scheduled on the pool
+//stats receives the counters of every tile, the frame and every pixel, they stay zero unless RT_ENABLE_STATS is defined
+//The wavefront renderer has no tiles to attribute work to and leaves them empty
+//features receives what the denoiser needs from the same samples, only the tiled renderer without adaptive sampling fills it
+cv::Mat rayTracing(const PerspectiveCamera& cam, const TriangleBuffer& triangles, const BVH* bvh, ThreadPool& pool, const RenderSettings& settings = RenderSettings(),
+                   cv::Mat* sampleCounts = nullptr, FrameStats* stats = nullptr, FeatureBuffers* features = nullptr);
+cv::Mat rayTracing(const PerspectiveCamera& cam, const InstancedScene& scene, ThreadPool& pool, const RenderSettings& settings = RenderSettings());
+cv::Mat rayTracing(const PerspectiveCamera& cam, const ShapeScene& scene, ThreadPool& pool, const RenderSettings& settings = RenderSettings());
+cv::Mat rayTracing(const PerspectiveCamera& cam, const TriangleBuffer& triangles, const WideBVH& bvh, ThreadPool& pool, const RenderSettings& settings = RenderSettings(),
+                   FrameStats* stats = nullptr);
+cv::Mat rayTracing(const PerspectiveCamera& cam, const TriangleBuffer& triangles, const UniformGrid& grid, ThreadPool& pool, const RenderSettings& settings = RenderSettings(),
+                   FrameStats* stats = nullptr);
+//Renders the view of every camera with the same settings, the (view, tile) work items of many views share one run of the pool
+//so that no thread waits for the last tiles of a view, every worker starts the next view of its range instead
+//onView(index, frame) is called on the pool's threads as soon as the last tile of a view is done, concurrently for different views
+//and in no particular order, the frame is not touched again afterwards. Wavefront and hybrid rendering work on whole frames and are not used
+//Views without pixels are handed out before the tiles of their batch, false without rendering anything when the tile size isn't positive
+bool rayTracingBatch(const std::vector<PerspectiveCamera>& cameras, const TriangleBuffer& triangles, const BVH& bvh, ThreadPool& pool,
+                     const RenderSettings& settings, const std::function<void(int, const cv::Mat&)>& onView);
+
+#endif /* RayTracer_hpp */
@@ -0,0 +1,57 @@
+//
+//  RenderStats.hpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#ifndef RenderStats_hpp
+#define RenderStats_hpp
+
+//Counting is compiled in only with -DRT_ENABLE_STATS, otherwise RT_STATS drops its statement
+#ifdef RT_ENABLE_STATS
+#define RT_STATS(statement) statement
+const bool statsEnabled = true;
+#else
+#define RT_STATS(statement)
+const bool statsEnabled = false;
+#endif
+
+//rays counts traversal queries, closest hit and shadow alike, hits the ones that found a triangle
+//A packet visiting a node counts as one visit, its triangle tests count once per active ray
+struct TraversalCounters {
+    long long rays = 0;
+    long long nodeVisits = 0;
+    long long triangleTests = 0;
+    long long hits = 0;
+
+    //Work a ray spent, the unit of the heatmap
+    long long getCost() const {
+        return nodeVisits + triangleTests;
+    }
+
+    TraversalCounters& operator+=(const TraversalCounters& other) {
+        rays += other.rays;
+        nodeVisits += other.nodeVisits;
+        triangleTests += other.triangleTests;
+        hits += other.hits;
+        return *this;
+    }
+
+    TraversalCounters operator-(const TraversalCounters& other) const {
+        TraversalCounters result = *this;
+        result.rays -= other.rays;
+        result.nodeVisits -= other.nodeVisits;
+        result.triangleTests -= other.triangleTests;
+        result.hits -= other.hits;
+        return result;
+    }
+};
+
+//Counters of the calling thread, read them before and after a piece of work to get its share
+inline TraversalCounters& getThreadCounters() {
+    thread_local TraversalCounters counters;
+    return counters;
+}
+
+#endif /* RenderStats_hpp */
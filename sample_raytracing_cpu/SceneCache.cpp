@@ -0,0 +1,243 @@
+//
+//  SceneCache.cpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#include "SceneCache.hpp"
+#include "MappedFile.hpp"
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+const char magic[8] = {'R', 'T', 'C', 'A', 'C', 'H', 'E', 0};
+const size_t sectionAlignment = 64;
+const size_t hashBlockSize = 1 << 20;
+
+//Sections are stored back to back at these offsets, every one starts on a cache line
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t simdWidth;
+    uint64_t sourceHash;
+    int32_t triangleCount;
+    int32_t stride;
+    int32_t nodeCount;
+    int32_t reserved;
+    uint64_t attributeOffset;
+    uint64_t colorOffset;
+    uint64_t idOffset;
+    uint64_t nodeOffset;
+    uint64_t primitiveOffset;
+    uint64_t fileSize;
+};
+
+static_assert(sizeof(BVHNode) == 32, "BVHNode is stored in the cache as is");
+static_assert(sizeof(Color) == 3, "Color is stored in the cache as is");
+
+size_t alignOffset(size_t offset) {
+    return (offset + sectionAlignment - 1) / sectionAlignment * sectionAlignment;
+}
+
+inline uint64_t mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+uint64_t hashBlock(const char* data, size_t size) {
+    uint64_t h = mix(size);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        h = (h ^ mix(word)) * 0x9e3779b97f4a7c15ull;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, data + i, size - i);
+
+    return mix(h ^ tail);
+}
+
+bool isSectionInside(uint64_t offset, uint64_t bytes, uint64_t fileSize) {
+    return offset % sectionAlignment == 0 && offset <= fileSize && bytes <= fileSize - offset;
+}
+
+//The source hash doesn't cover the cache itself, so everything traversal follows is checked before it is used: the nodes
+//reachable from the root form a tree within the nodes that is no deeper than the traversal stacks reach, the leaves lie within
+//the triangles and the ids and primitive indices are slots
+bool isContentValid(const BVHNode* nodes, int nodeCount, const int* ids, const int* primitives, int triangleCount) {
+    struct StackEntry {
+        int node;
+        int depth;
+    };
+    std::vector<char> visited(nodeCount, 0);
+    std::vector<StackEntry> stack;
+    if (nodeCount > 0) {
+        stack.push_back({0, 0});
+    }
+    while (!stack.empty()) {
+        const StackEntry entry = stack.back();
+        stack.pop_back();
+        if (visited[entry.node] || entry.depth >= BVH::maxDepth) {
+            return false;
+        }
+        visited[entry.node] = 1;
+        const BVHNode& node = nodes[entry.node];
+        if (node.count > 0) {
+            if (node.leftFirst < 0 || node.leftFirst > triangleCount - node.count) {
+                return false;
+            }
+            continue;
+        }
+        if (node.count < 0 || node.leftFirst < 0 || node.leftFirst >= nodeCount - 1) {
+            return false;
+        }
+        stack.push_back({node.leftFirst, entry.depth + 1});
+        stack.push_back({node.leftFirst + 1, entry.depth + 1});
+    }
+    for (int i = 0; i < triangleCount; ++i) {
+        if (ids[i] < 0 || ids[i] >= triangleCount || primitives[i] < 0 || primitives[i] >= triangleCount) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+}
+
+SceneCache::SceneCache(ThreadPool& pool) : pool(pool) {}
+
+std::string SceneCache::getCachePath(const std::string& sourcePath) {
+    return sourcePath + ".rtcache";
+}
+
+uint64_t SceneCache::hashFile(const std::string& path) const {
+    MappedFile file(path);
+    if (!file.isOpen()) {
+        return 0;
+    }
+
+    //Blocks are hashed on the pool and combined in file order, so the result doesn't depend on the thread count
+    const size_t size = file.getSize();
+    const int blockCount = static_cast<int>((size + hashBlockSize - 1) / hashBlockSize);
+    std::vector<uint64_t> blockHashes(blockCount);
+    pool.parallelFor(blockCount, [&](int b) {
+        const size_t begin = b * hashBlockSize;
+        blockHashes[b] = hashBlock(file.getData() + begin, std::min(hashBlockSize, size - begin));
+    });
+
+    uint64_t h = mix(size ^ 0x5bd1e995ull);
+    for (uint64_t blockHash : blockHashes) {
+        h = mix(h ^ blockHash) * 0x9e3779b97f4a7c15ull;
+    }
+
+    return h ? h : 1;
+}
+
+std::unique_ptr<BVH> SceneCache::load(const std::string& cachePath, uint64_t sourceHash) const {
+    std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>(cachePath, false);
+    if (!file->isOpen() || file->getSize() < sizeof(CacheHeader)) {
+        return nullptr;
+    }
+
+    CacheHeader header;
+    memcpy(&header, file->getData(), sizeof(header));
+    if (memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != version || header.simdWidth != simd::width ||
+        header.sourceHash != sourceHash || header.fileSize != file->getSize()) {
+        return nullptr;
+    }
+
+    const uint64_t size = file->getSize();
+    const uint64_t stride = header.stride;
+    if (header.triangleCount < 0 || header.nodeCount < 0 || stride < static_cast<uint64_t>(header.triangleCount) + simd::width ||
+        !isSectionInside(header.attributeOffset, stride * TriangleBuffer::AttributeCount * sizeof(float), size) ||
+        !isSectionInside(header.colorOffset, stride * sizeof(Color), size) ||
+        !isSectionInside(header.idOffset, stride * sizeof(int), size) ||
+        !isSectionInside(header.nodeOffset, header.nodeCount * sizeof(BVHNode), size) ||
+        !isSectionInside(header.primitiveOffset, header.triangleCount * sizeof(int), size)) {
+        std::cout << "Corrupt scene cache " << cachePath << std::endl;
+        return nullptr;
+    }
+
+    const char* data = file->getData();
+    if (!isContentValid(reinterpret_cast<const BVHNode*>(data + header.nodeOffset), header.nodeCount, reinterpret_cast<const int*>(data + header.idOffset),
+                        reinterpret_cast<const int*>(data + header.primitiveOffset), header.triangleCount)) {
+        std::cout << "Corrupt scene cache " << cachePath << std::endl;
+        return nullptr;
+    }
+    TriangleBuffer triangles(header.triangleCount, header.stride,
+                             reinterpret_cast<const float*>(data + header.attributeOffset),
+                             reinterpret_cast<const Color*>(data + header.colorOffset),
+                             reinterpret_cast<const int*>(data + header.idOffset), file);
+
+    return std::unique_ptr<BVH>(new BVH(reinterpret_cast<const BVHNode*>(data + header.nodeOffset), header.nodeCount,
+                                        reinterpret_cast<const int*>(data + header.primitiveOffset), triangles, file));
+}
+
+bool SceneCache::save(const std::string& cachePath, uint64_t sourceHash, const BVH& bvh) const {
+    const TriangleBuffer& triangles = bvh.getTriangles();
+    const int count = triangles.size();
+    const int stride = triangles.getStride();
+
+    CacheHeader header = {};
+    memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.simdWidth = simd::width;
+    header.sourceHash = sourceHash;
+    header.triangleCount = count;
+    header.stride = stride;
+    header.nodeCount = bvh.getNodeCount();
+    header.attributeOffset = alignOffset(sizeof(CacheHeader));
+    header.colorOffset = alignOffset(header.attributeOffset + static_cast<uint64_t>(stride) * TriangleBuffer::AttributeCount * sizeof(float));
+    header.idOffset = alignOffset(header.colorOffset + static_cast<uint64_t>(stride) * sizeof(Color));
+    header.nodeOffset = alignOffset(header.idOffset + static_cast<uint64_t>(stride) * sizeof(int));
+    header.primitiveOffset = alignOffset(header.nodeOffset + static_cast<uint64_t>(header.nodeCount) * sizeof(BVHNode));
+    header.fileSize = header.primitiveOffset + static_cast<uint64_t>(count) * sizeof(int);
+
+    //The slots are already in leaf order, so the ids become the slots and the leaf permutation the identity
+    std::vector<int> ids(stride, INT_MAX);
+    std::vector<int> identity(count);
+    for (int i = 0; i < count; ++i) {
+        ids[i] = i;
+        identity[i] = i;
+    }
+
+    //Written next to the final path and renamed, a reader never maps a half written cache
+    const std::string temporaryPath = cachePath + ".tmp";
+    std::ofstream out(temporaryPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cout << "Could not write scene cache " << cachePath << std::endl;
+        return false;
+    }
+    auto writeSection = [&](uint64_t offset, const void* data, size_t bytes) {
+        const std::vector<char> padding(offset - static_cast<uint64_t>(out.tellp()), 0);
+        out.write(padding.data(), padding.size());
+        out.write(static_cast<const char*>(data), bytes);
+    };
+    writeSection(0, &header, sizeof(header));
+    writeSection(header.attributeOffset, triangles.getAttributeData(), static_cast<size_t>(stride) * TriangleBuffer::AttributeCount * sizeof(float));
+    writeSection(header.colorOffset, triangles.getColorData(), static_cast<size_t>(stride) * sizeof(Color));
+    writeSection(header.idOffset, ids.data(), ids.size() * sizeof(int));
+    writeSection(header.nodeOffset, bvh.getNodes(), static_cast<size_t>(header.nodeCount) * sizeof(BVHNode));
+    writeSection(header.primitiveOffset, identity.data(), identity.size() * sizeof(int));
+    out.close();
+
+    if (!out || std::rename(temporaryPath.c_str(), cachePath.c_str()) != 0) {
+        std::cout << "Could not write scene cache " << cachePath << std::endl;
+        std::remove(temporaryPath.c_str());
+        return false;
+    }
+
+    return true;
+}
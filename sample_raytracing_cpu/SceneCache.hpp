@@ -0,0 +1,38 @@
+//
+//  SceneCache.hpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#ifndef SceneCache_hpp
+#define SceneCache_hpp
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "BVH.hpp"
+#include "ThreadPool.hpp"
+
+//Binary file with the flattened triangles and the BVH of a mesh, mapped and used in place when it is loaded
+//The triangles are stored in leaf order and renumbered so that the id of every triangle is its slot
+class SceneCache {
+public:
+    //2 added the texture coordinates to the triangle attributes
+    static const uint32_t version = 2;
+
+    explicit SceneCache(ThreadPool& pool);
+    //Cache file that belongs to a mesh, it sits next to the mesh
+    static std::string getCachePath(const std::string& sourcePath);
+    //Content hash of the whole file, 0 when it can't be read
+    uint64_t hashFile(const std::string& path) const;
+    //Returns nullptr when the file is missing, was written by another version or SIMD width or for another source hash
+    //or when its nodes, ids or primitive indices point outside of it
+    std::unique_ptr<BVH> load(const std::string& cachePath, uint64_t sourceHash) const;
+    bool save(const std::string& cachePath, uint64_t sourceHash, const BVH& bvh) const;
+
+private:
+    ThreadPool& pool;
+};
+
+#endif /* SceneCache_hpp */
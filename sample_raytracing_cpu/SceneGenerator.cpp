@@ -0,0 +1,32 @@
+//
+//  SceneGenerator.cpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#include "SceneGenerator.hpp"
+#include <cmath>
+
+float nextUnit(std::mt19937& rng) {
+    return (rng() >> 8) * (1.f / 16777216.f);
+}
+
+TriangleBuffer generateScene(const SceneSpec& spec) {
+    std::mt19937 rng(spec.seed);
+    //A triangle with corners spread over a cube of side s covers roughly 0.08 s^2 of a 8x6 view
+    const float size = std::sqrt(1200.f / spec.triangleCount);
+    TriangleBuffer triangles;
+    triangles.resize(spec.triangleCount);
+    for (int i = 0; i < spec.triangleCount; ++i) {
+        const glm::vec3 center(nextUnit(rng) * 8.f - 4.f, nextUnit(rng) * 6.f - 3.f, -2.f - nextUnit(rng) * 4.f);
+        Vertex v[3];
+        for (int k = 0; k < 3; ++k) {
+            v[k] = center + glm::vec3(nextUnit(rng) - 0.5f, nextUnit(rng) - 0.5f, nextUnit(rng) - 0.5f) * size;
+        }
+        const Color color(static_cast<unsigned char>(rng() & 255), static_cast<unsigned char>(rng() & 255), static_cast<unsigned char>(rng() & 255));
+        triangles.setTriangle(i, v[0], v[1], v[2], color, i);
+    }
+
+    return triangles;
+}
@@ -0,0 +1,27 @@
+//
+//  SceneGenerator.hpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#ifndef SceneGenerator_hpp
+#define SceneGenerator_hpp
+
+#include <cstdint>
+#include <random>
+#include "TriangleBuffer.hpp"
+
+//Seeded random scene shared by the benchmark and the check program, the seed is part of the scene definition
+struct SceneSpec {
+    int triangleCount;
+    uint32_t seed;
+};
+
+//Built from the raw generator output, std distributions differ between standard libraries
+float nextUnit(std::mt19937& rng);
+//Randomly oriented triangles filling a box in front of the default camera, the id of every triangle is its slot
+//Their size shrinks with the count so that every scene stacks about two layers of triangles over the view
+TriangleBuffer generateScene(const SceneSpec& spec);
+
+#endif /* SceneGenerator_hpp */
@@ -0,0 +1,194 @@
+//
+//  Shape.cpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#include "Shape.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <glm/geometric.hpp>
+
+namespace {
+
+bool intersectDisk(const Ray& r, const glm::vec3& center, const glm::vec3& normal, float radius, float& t) {
+    const float denominator = glm::dot(normal, r.dir);
+    if (std::abs(denominator) < 1e-12f) {
+        return false;
+    }
+    const float tPlane = glm::dot(center - r.p0, normal) / denominator;
+    if (tPlane < 0.f) {
+        return false;
+    }
+    const glm::vec3 offset = r.p0 + r.dir * tPlane - center;
+    if (glm::dot(offset, offset) > radius * radius) {
+        return false;
+    }
+    t = tPlane;
+
+    return true;
+}
+
+//Box of a disk, along each axis it reaches out by the radius times the sine of the angle between the axis and the normal
+AABB getDiskBounds(const glm::vec3& center, const glm::vec3& normal, float radius) {
+    AABB box;
+    for (int axis = 0; axis < 3; ++axis) {
+        const float extent = radius * std::sqrt(std::max(0.f, 1.f - normal[axis] * normal[axis]));
+        box.min[axis] = center[axis] - extent;
+        box.max[axis] = center[axis] + extent;
+    }
+
+    return box;
+}
+
+}
+
+bool Shape::sphere(const glm::vec3& center, float radius, const Color& color, Shape& shape) {
+    if (!(radius > 0.f)) {
+        std::cout << "Sphere radius " << radius << " is not positive" << std::endl;
+        return false;
+    }
+    shape = {Type::Sphere, center, glm::vec3(0.f), radius, color};
+
+    return true;
+}
+
+bool Shape::disk(const glm::vec3& center, const glm::vec3& normal, float radius, const Color& color, Shape& shape) {
+    //A zero normal can't be normalized
+    if (!(glm::dot(normal, normal) > 0.f) || !(radius > 0.f)) {
+        std::cout << "Disk needs a nonzero normal and a positive radius" << std::endl;
+        return false;
+    }
+    shape = {Type::Disk, center, glm::normalize(normal), radius, color};
+
+    return true;
+}
+
+bool Shape::cylinder(const glm::vec3& bottom, const glm::vec3& top, float radius, const Color& color, Shape& shape) {
+    //The axis is divided by its length for every ray
+    const glm::vec3 axis = top - bottom;
+    if (!(glm::dot(axis, axis) > 0.f) || !(radius > 0.f)) {
+        std::cout << "Cylinder needs distinct cap centers and a positive radius" << std::endl;
+        return false;
+    }
+    shape = {Type::Cylinder, bottom, axis, radius, color};
+
+    return true;
+}
+
+AABB Shape::getBounds() const {
+    AABB box;
+    if (type == Type::Sphere) {
+        box.grow(center - glm::vec3(radius));
+        box.grow(center + glm::vec3(radius));
+    }
+    else if (type == Type::Disk) {
+        box = getDiskBounds(center, axis, radius);
+    }
+    else {
+        const glm::vec3 normal = glm::normalize(axis);
+        box = getDiskBounds(center, normal, radius);
+        box.grow(getDiskBounds(center + axis, normal, radius));
+    }
+
+    //Padded like the triangle boxes of the BVH, a disk facing along an axis would be flat otherwise
+    const glm::vec3 magnitude = glm::max(glm::abs(box.min), glm::abs(box.max));
+    const float padding = 1e-5f * (std::max(magnitude.x, std::max(magnitude.y, magnitude.z)) + 1.f);
+    box.min -= glm::vec3(padding);
+    box.max += glm::vec3(padding);
+
+    return box;
+}
+
+bool Shape::intersect(const Ray& r, float& t) const {
+    if (type == Type::Disk) {
+        return intersectDisk(r, center, axis, radius, t);
+    }
+
+    if (type == Type::Sphere) {
+        //Roots of |p0 + t * dir - center|^2 = radius^2, the far one when the ray starts inside
+        const glm::vec3 oc = r.p0 - center;
+        const float a = glm::dot(r.dir, r.dir);
+        const float b = glm::dot(oc, r.dir);
+        const float c = glm::dot(oc, oc) - radius * radius;
+        const float discriminant = b * b - a * c;
+        if (discriminant < 0.f) {
+            return false;
+        }
+        const float root = std::sqrt(discriminant);
+        float tHit = (-b - root) / a;
+        if (tHit < 0.f) {
+            tHit = (-b + root) / a;
+        }
+        if (tHit < 0.f) {
+            return false;
+        }
+        t = tHit;
+
+        return true;
+    }
+
+    //The side is the same quadratic with the components along the axis removed, a root counts when it lies between the caps
+    const float height = glm::length(axis);
+    const glm::vec3 u = axis / height;
+    const glm::vec3 oc = r.p0 - center;
+    const float dirAlong = glm::dot(r.dir, u);
+    const float originAlong = glm::dot(oc, u);
+    const glm::vec3 dirAcross = r.dir - u * dirAlong;
+    const glm::vec3 originAcross = oc - u * originAlong;
+    const float a = glm::dot(dirAcross, dirAcross);
+    const float b = glm::dot(originAcross, dirAcross);
+    const float c = glm::dot(originAcross, originAcross) - radius * radius;
+    float tBest = MAXFLOAT;
+    bool found = false;
+    const float discriminant = b * b - a * c;
+    if (a > 1e-12f && discriminant >= 0.f) {
+        const float root = std::sqrt(discriminant);
+        for (const float tSide : {(-b - root) / a, (-b + root) / a}) {
+            const float along = originAlong + tSide * dirAlong;
+            if (tSide >= 0.f && along >= 0.f && along <= height) {
+                tBest = tSide;
+                found = true;
+                break;
+            }
+        }
+    }
+    float tCap;
+    if (intersectDisk(r, center, u, radius, tCap) && tCap < tBest) {
+        tBest = tCap;
+        found = true;
+    }
+    if (intersectDisk(r, center + axis, u, radius, tCap) && tCap < tBest) {
+        tBest = tCap;
+        found = true;
+    }
+    if (found) {
+        t = tBest;
+    }
+
+    return found;
+}
+
+glm::vec3 Shape::getNormal(const glm::vec3& point) const {
+    if (type == Type::Sphere) {
+        return glm::normalize(point - center);
+    }
+    if (type == Type::Disk) {
+        return axis;
+    }
+
+    //A point belongs to whichever of the caps and the side it is closer to, which only matters right at the rims
+    const float height = glm::length(axis);
+    const glm::vec3 u = axis / height;
+    const float along = glm::dot(point - center, u);
+    const glm::vec3 across = point - center - u * along;
+    const float acrossLength = glm::length(across);
+    const float capDistance = std::min(along, height - along);
+    if (capDistance < std::abs(radius - acrossLength) || acrossLength == 0.f) {
+        return along < 0.5f * height ? -u : u;
+    }
+
+    return across / acrossLength;
+}
@@ -0,0 +1,47 @@
+//
+//  Shape.hpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#ifndef Shape_hpp
+#define Shape_hpp
+
+#include <glm/vec3.hpp>
+#include "AABB.hpp"
+#include "Ray.hpp"
+#include "Triangle.hpp"
+
+//Analytic primitive intersected in closed form, a few dozen bytes where a tessellation would take thousands of triangles
+struct Shape {
+    enum class Type {
+        Sphere,
+        //Flat circle, two sided like the triangles
+        Disk,
+        //Side of a cylinder closed by a disk at either end
+        Cylinder
+    };
+
+    Type type;
+    //Center of a sphere or a disk, center of the bottom cap of a cylinder
+    glm::vec3 center;
+    //Unit normal of a disk, a cylinder's axis from the bottom cap center to the top one, unused for spheres
+    glm::vec3 axis;
+    float radius;
+    Color color;
+
+    //Fill in shape, they return false and leave it untouched for a radius that isn't positive, a zero disk normal
+    //or a cylinder whose caps have the same center
+    static bool sphere(const glm::vec3& center, float radius, const Color& color, Shape& shape);
+    static bool disk(const glm::vec3& center, const glm::vec3& normal, float radius, const Color& color, Shape& shape);
+    static bool cylinder(const glm::vec3& bottom, const glm::vec3& top, float radius, const Color& color, Shape& shape);
+
+    AABB getBounds() const;
+    //Closest hit at t >= 0, like the triangles a ray starting inside a sphere or a cylinder hits it from the inside
+    bool intersect(const Ray& r, float& t) const;
+    //Outward normal at a point on the surface
+    glm::vec3 getNormal(const glm::vec3& point) const;
+};
+
+#endif /* Shape_hpp */
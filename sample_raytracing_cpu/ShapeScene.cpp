@@ -0,0 +1,141 @@
+//
+//  ShapeScene.cpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#include "ShapeScene.hpp"
+
+namespace {
+
+TriangleBuffer numberBySlot(const TriangleBuffer& triangles) {
+    //The ids are replaced by the slots so that a hit can be traced back to the source buffer
+    TriangleBuffer numbered;
+    numbered.resize(triangles.size());
+    for (int i = 0; i < triangles.size(); ++i) {
+        numbered.setTriangle(i, triangles.getVertex(i, 0), triangles.getVertex(i, 1), triangles.getVertex(i, 2), triangles.getColor(i), i);
+        numbered.setTexCoords(i, triangles.getTexCoord(i, 0), triangles.getTexCoord(i, 1), triangles.getTexCoord(i, 2));
+    }
+
+    return numbered;
+}
+
+}
+
+ShapeScene::ShapeScene(const TriangleBuffer& source, const std::vector<Shape>& shapes, ThreadPool& pool) :
+                        triangles(numberBySlot(source), pool), shapes(shapes), topLevel(std::vector<AABB>()) {
+    const int* order = triangles.getPrimitiveIndices();
+    triangleSlots.resize(source.size());
+    for (int slot = 0; slot < source.size(); ++slot) {
+        triangleSlots[order[slot]] = slot;
+    }
+
+    std::vector<AABB> bounds(getPrimitiveCount());
+    for (int primitive = 0; primitive < getPrimitiveCount(); ++primitive) {
+        bounds[primitive] = getPrimitiveBounds(primitive);
+    }
+    topLevel = BVH(bounds, 1);
+}
+
+bool ShapeScene::hasTriangles() const {
+    return triangles.getNodeCount() > 0;
+}
+
+int ShapeScene::getPrimitiveCount() const {
+    return static_cast<int>(shapes.size()) + (hasTriangles() ? 1 : 0);
+}
+
+AABB ShapeScene::getPrimitiveBounds(int primitive) const {
+    if (primitive == static_cast<int>(shapes.size())) {
+        return triangles.getNodes()[0].bounds;
+    }
+
+    return shapes[primitive].getBounds();
+}
+
+void ShapeScene::intersectPrimitive(int primitive, const Ray& r, ShapeHit& hit) const {
+    float t;
+    if (primitive == static_cast<int>(shapes.size())) {
+        //The triangles' BVH only reports hits up to hit.t and resolves their ties itself, the triangles go before every shape
+        const int triangle = triangles.intersect(r, t, hit.t);
+        if (triangle != INT_MAX && (t < hit.t || hit.triangle == INT_MAX)) {
+            hit.t = t;
+            hit.triangle = triangle;
+            hit.shape = INT_MAX;
+        }
+        return;
+    }
+    if (shapes[primitive].intersect(r, t) && (t < hit.t || (t == hit.t && hit.triangle == INT_MAX && primitive < hit.shape))) {
+        hit.t = t;
+        hit.triangle = INT_MAX;
+        hit.shape = primitive;
+    }
+}
+
+bool ShapeScene::occludesPrimitive(int primitive, const Ray& r, float tMax) const {
+    if (primitive == static_cast<int>(shapes.size())) {
+        return triangles.occluded(r, tMax);
+    }
+    float t;
+
+    return shapes[primitive].intersect(r, t) && t < tMax;
+}
+
+bool ShapeScene::intersect(const Ray& r, ShapeHit& hit) const {
+    const int* primitives = topLevel.getPrimitiveIndices();
+    ShapeHit best;
+    //The walk reads the cutoff from best.t, which intersectPrimitive lowers
+    topLevel.traverse(r, best.t, [&](int first, int count, float&) {
+        for (int i = first; i < first + count; ++i) {
+            intersectPrimitive(primitives[i], r, best);
+        }
+    });
+
+    if (best.triangle == INT_MAX && best.shape == INT_MAX) {
+        return false;
+    }
+    hit = best;
+
+    return true;
+}
+
+bool ShapeScene::occluded(const Ray& r, float tMax) const {
+    const int* primitives = topLevel.getPrimitiveIndices();
+    return topLevel.traverseAny(r, tMax, [&](int first, int count) {
+        for (int i = first; i < first + count; ++i) {
+            if (occludesPrimitive(primitives[i], r, tMax)) {
+                return true;
+            }
+        }
+        return false;
+    });
+}
+
+glm::vec3 ShapeScene::getNormal(const Ray& r, const ShapeHit& hit) const {
+    if (hit.shape != INT_MAX) {
+        return shapes[hit.shape].getNormal(r.p0 + r.dir * hit.t);
+    }
+
+    return triangles.getTriangles().getNormal(triangleSlots[hit.triangle]);
+}
+
+Color ShapeScene::getColor(const ShapeHit& hit) const {
+    if (hit.shape != INT_MAX) {
+        return shapes[hit.shape].color;
+    }
+
+    return triangles.getTriangles().getColor(getTriangleSlot(hit));
+}
+
+int ShapeScene::getTriangleSlot(const ShapeHit& hit) const {
+    return triangleSlots[hit.triangle];
+}
+
+const BVH& ShapeScene::getTriangles() const {
+    return triangles;
+}
+
+const std::vector<Shape>& ShapeScene::getShapes() const {
+    return shapes;
+}
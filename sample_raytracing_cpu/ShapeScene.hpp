@@ -0,0 +1,63 @@
+//
+//  ShapeScene.hpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#ifndef ShapeScene_hpp
+#define ShapeScene_hpp
+
+#include <climits>
+#include <vector>
+#include "BVH.hpp"
+#include "Shape.hpp"
+
+struct ShapeHit {
+    float t = MAXFLOAT;
+    //Slot of the hit triangle in the buffer the scene was built from, INT_MAX when a shape was hit
+    int triangle = INT_MAX;
+    //Index of the hit shape, INT_MAX when a triangle was hit
+    int shape = INT_MAX;
+};
+
+//Triangles and analytic shapes behind one closest-hit query
+//The shapes and the triangles' own BVH are the primitives of the scene, an acceleration structure built over their bounds only
+//has to hand its leaves to intersectPrimitive and occludesPrimitive. The scene uses a BVH, so the shapes and the triangles are
+//visited in the order their boxes come along the ray and every test is cut off at the closest hit found so far
+class ShapeScene {
+public:
+    //The triangles' BVH is built on the pool
+    ShapeScene(const TriangleBuffer& triangles, const std::vector<Shape>& shapes, ThreadPool& pool);
+
+    //Closest hit, equal distances go to the triangles first and then to the smallest shape index
+    bool intersect(const Ray& r, ShapeHit& hit) const;
+    bool occluded(const Ray& r, float tMax) const;
+    //Outward normal of the hit shape or the normal of the hit triangle
+    glm::vec3 getNormal(const Ray& r, const ShapeHit& hit) const;
+    Color getColor(const ShapeHit& hit) const;
+    //Slot of the hit triangle in getTriangles().getTriangles()
+    int getTriangleSlot(const ShapeHit& hit) const;
+
+    //Primitives 0 to shapes.size() - 1 are the shapes, the one after them is the triangles' BVH when there are triangles
+    int getPrimitiveCount() const;
+    AABB getPrimitiveBounds(int primitive) const;
+    //Replaces hit when the primitive is hit closer than hit.t or at the same distance by a primitive that goes first
+    void intersectPrimitive(int primitive, const Ray& r, ShapeHit& hit) const;
+    bool occludesPrimitive(int primitive, const Ray& r, float tMax) const;
+
+    const BVH& getTriangles() const;
+    const std::vector<Shape>& getShapes() const;
+
+private:
+    BVH triangles;
+    //Where each triangle of the source buffer ended up in the BVH's reordered copy
+    std::vector<int> triangleSlots;
+    std::vector<Shape> shapes;
+    //Over the primitives, its leaves refer to them through getPrimitiveIndices()
+    BVH topLevel;
+
+    bool hasTriangles() const;
+};
+
+#endif /* ShapeScene_hpp */
@@ -0,0 +1,158 @@
+//
+//  Simd.hpp
+//  Test
+//
+//  Created by Erik Nouroyan on 17.10.26.
+//
+
+#ifndef Simd_hpp
+#define Simd_hpp
+
+#include <cstring>
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+//Thin wrapper over the widest float vector the target supports: 8 lanes with AVX, 4 with SSE, plain arrays otherwise
+namespace simd {
+
+#if defined(__AVX__)
+
+const int width = 8;
+
+struct Mask {
+    __m256 v;
+    Mask operator&(const Mask& o) const { return {_mm256_and_ps(v, o.v)}; }
+    Mask operator|(const Mask& o) const { return {_mm256_or_ps(v, o.v)}; }
+    int bits() const { return _mm256_movemask_ps(v); }
+    //Lanes of this mask that are not set in o
+    Mask andNot(const Mask& o) const { return {_mm256_andnot_ps(o.v, v)}; }
+};
+
+struct Float {
+    __m256 v;
+    Float() = default;
+    Float(__m256 v) : v(v) {}
+    Float(float f) : v(_mm256_set1_ps(f)) {}
+    static Float load(const float* p) { return _mm256_loadu_ps(p); }
+    //Widens width bytes to floats, only SSE2 integer instructions are needed
+    static Float loadBytes(const unsigned char* p) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i words = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p)), zero);
+        const __m128 low = _mm_cvtepi32_ps(_mm_unpacklo_epi16(words, zero));
+        const __m128 high = _mm_cvtepi32_ps(_mm_unpackhi_epi16(words, zero));
+        return _mm256_insertf128_ps(_mm256_castps128_ps256(low), high, 1);
+    }
+    void store(float* p) const { _mm256_storeu_ps(p, v); }
+    Float operator+(const Float& o) const { return _mm256_add_ps(v, o.v); }
+    Float operator-(const Float& o) const { return _mm256_sub_ps(v, o.v); }
+    Float operator*(const Float& o) const { return _mm256_mul_ps(v, o.v); }
+    Float operator/(const Float& o) const { return _mm256_div_ps(v, o.v); }
+    Mask operator<(const Float& o) const { return {_mm256_cmp_ps(v, o.v, _CMP_LT_OQ)}; }
+    Mask operator<=(const Float& o) const { return {_mm256_cmp_ps(v, o.v, _CMP_LE_OQ)}; }
+    Mask operator>(const Float& o) const { return {_mm256_cmp_ps(v, o.v, _CMP_GT_OQ)}; }
+    Mask operator>=(const Float& o) const { return {_mm256_cmp_ps(v, o.v, _CMP_GE_OQ)}; }
+    Mask operator==(const Float& o) const { return {_mm256_cmp_ps(v, o.v, _CMP_EQ_OQ)}; }
+};
+
+inline Float min(const Float& a, const Float& b) { return _mm256_min_ps(a.v, b.v); }
+inline Float max(const Float& a, const Float& b) { return _mm256_max_ps(a.v, b.v); }
+inline Float abs(const Float& a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a.v); }
+inline Float select(const Mask& m, const Float& a, const Float& b) { return _mm256_blendv_ps(b.v, a.v, m.v); }
+inline Mask maskFromBits(int bits) {
+    const __m256 lanes = _mm256_setr_ps(bits & 1, bits & 2, bits & 4, bits & 8, bits & 16, bits & 32, bits & 64, bits & 128);
+    return {_mm256_cmp_ps(lanes, _mm256_setzero_ps(), _CMP_GT_OQ)};
+}
+
+#elif defined(__SSE2__) || defined(_M_X64)
+
+const int width = 4;
+
+struct Mask {
+    __m128 v;
+    Mask operator&(const Mask& o) const { return {_mm_and_ps(v, o.v)}; }
+    Mask operator|(const Mask& o) const { return {_mm_or_ps(v, o.v)}; }
+    int bits() const { return _mm_movemask_ps(v); }
+    Mask andNot(const Mask& o) const { return {_mm_andnot_ps(o.v, v)}; }
+};
+
+struct Float {
+    __m128 v;
+    Float() = default;
+    Float(__m128 v) : v(v) {}
+    Float(float f) : v(_mm_set1_ps(f)) {}
+    static Float load(const float* p) { return _mm_loadu_ps(p); }
+    static Float loadBytes(const unsigned char* p) {
+        int bytes;
+        memcpy(&bytes, p, sizeof(bytes));
+        const __m128i zero = _mm_setzero_si128();
+        return _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero));
+    }
+    void store(float* p) const { _mm_storeu_ps(p, v); }
+    Float operator+(const Float& o) const { return _mm_add_ps(v, o.v); }
+    Float operator-(const Float& o) const { return _mm_sub_ps(v, o.v); }
+    Float operator*(const Float& o) const { return _mm_mul_ps(v, o.v); }
+    Float operator/(const Float& o) const { return _mm_div_ps(v, o.v); }
+    Mask operator<(const Float& o) const { return {_mm_cmplt_ps(v, o.v)}; }
+    Mask operator<=(const Float& o) const { return {_mm_cmple_ps(v, o.v)}; }
+    Mask operator>(const Float& o) const { return {_mm_cmpgt_ps(v, o.v)}; }
+    Mask operator>=(const Float& o) const { return {_mm_cmpge_ps(v, o.v)}; }
+    Mask operator==(const Float& o) const { return {_mm_cmpeq_ps(v, o.v)}; }
+};
+
+inline Float min(const Float& a, const Float& b) { return _mm_min_ps(a.v, b.v); }
+inline Float max(const Float& a, const Float& b) { return _mm_max_ps(a.v, b.v); }
+inline Float abs(const Float& a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a.v); }
+inline Float select(const Mask& m, const Float& a, const Float& b) { return _mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v)); }
+inline Mask maskFromBits(int bits) {
+    const __m128i lanes = _mm_setr_epi32(1, 2, 4, 8);
+    const __m128i selected = _mm_and_si128(_mm_set1_epi32(bits), lanes);
+    return {_mm_castsi128_ps(_mm_cmpeq_epi32(selected, lanes))};
+}
+
+#else
+
+const int width = 4;
+
+struct Mask {
+    bool v[width];
+    Mask operator&(const Mask& o) const { Mask r; for (int i = 0; i < width; ++i) r.v[i] = v[i] && o.v[i]; return r; }
+    Mask operator|(const Mask& o) const { Mask r; for (int i = 0; i < width; ++i) r.v[i] = v[i] || o.v[i]; return r; }
+    int bits() const { int r = 0; for (int i = 0; i < width; ++i) r |= v[i] << i; return r; }
+    Mask andNot(const Mask& o) const { Mask r; for (int i = 0; i < width; ++i) r.v[i] = v[i] && !o.v[i]; return r; }
+};
+
+struct Float {
+    float v[width];
+    Float() = default;
+    Float(float f) { for (int i = 0; i < width; ++i) v[i] = f; }
+    static Float load(const float* p) { Float r; for (int i = 0; i < width; ++i) r.v[i] = p[i]; return r; }
+    static Float loadBytes(const unsigned char* p) { Float r; for (int i = 0; i < width; ++i) r.v[i] = p[i]; return r; }
+    void store(float* p) const { for (int i = 0; i < width; ++i) p[i] = v[i]; }
+#define SIMD_FLOAT_OP(op) Float operator op(const Float& o) const { Float r; for (int i = 0; i < width; ++i) r.v[i] = v[i] op o.v[i]; return r; }
+    SIMD_FLOAT_OP(+) SIMD_FLOAT_OP(-) SIMD_FLOAT_OP(*) SIMD_FLOAT_OP(/)
+#undef SIMD_FLOAT_OP
+#define SIMD_COMPARE_OP(op) Mask operator op(const Float& o) const { Mask r; for (int i = 0; i < width; ++i) r.v[i] = v[i] op o.v[i]; return r; }
+    SIMD_COMPARE_OP(<) SIMD_COMPARE_OP(<=) SIMD_COMPARE_OP(>) SIMD_COMPARE_OP(>=) SIMD_COMPARE_OP(==)
+#undef SIMD_COMPARE_OP
+};
+
+inline Float min(const Float& a, const Float& b) { Float r; for (int i = 0; i < width; ++i) r.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]; return r; }
+inline Float max(const Float& a, const Float& b) { Float r; for (int i = 0; i < width; ++i) r.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]; return r; }
+inline Float abs(const Float& a) { Float r; for (int i = 0; i < width; ++i) r.v[i] = a.v[i] < 0.f ? -a.v[i] : a.v[i]; return r; }
+inline Float select(const Mask& m, const Float& a, const Float& b) { Float r; for (int i = 0; i < width; ++i) r.v[i] = m.v[i] ? a.v[i] : b.v[i]; return r; }
+inline Mask maskFromBits(int bits) { Mask r; for (int i = 0; i < width; ++i) r.v[i] = (bits >> i) & 1; return r; }
+
+#endif
+
+inline int countLanes(int bits) {
+    return __builtin_popcount(bits);
+}
+
+inline int firstLane(int bits) {
+    return __builtin_ctz(bits);
+}
+
+}
+
+#endif /* Simd_hpp */
@@ -0,0 +1,187 @@
+//
+//  TemporalRenderer.cpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#include "TemporalRenderer.hpp"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+const uint64_t emptySplat = UINT64_MAX;
+//The pixel's own splat first, so that a triangle it shares with its neighbours keeps the color from its own spot
+const int neighbourOffsets[9][2] = {{0, 0}, {-1, 0}, {1, 0}, {0, -1}, {0, 1}, {-1, -1}, {-1, 1}, {1, -1}, {1, 1}};
+
+//Distances are positive, so their bits order like the floats and the smallest value is the closest splat
+uint64_t toSplat(float distance, int source) {
+    uint32_t bits;
+    std::memcpy(&bits, &distance, sizeof(bits));
+    return static_cast<uint64_t>(bits) << 32 | static_cast<uint32_t>(source);
+}
+
+}
+
+TemporalRenderer::TemporalRenderer(const TriangleBuffer& triangles, const BVH& bvh, ThreadPool& pool, const RenderSettings& settings, int refreshFrames) :
+    triangles(triangles), bvh(bvh), pool(pool), settings(settings), refreshFrames(std::max(1, refreshFrames)), hasHistory(false), splatCount(0) {}
+
+void TemporalRenderer::reset() {
+    hasHistory = false;
+}
+
+const TemporalFrameStats& TemporalRenderer::getLastStats() const {
+    return stats;
+}
+
+void TemporalRenderer::splat(const RayGenerator& rays, const RayGenerator& previous) {
+    const int width = rays.getWidth();
+    const int height = rays.getHeight();
+    const size_t count = static_cast<size_t>(width) * height;
+    if (splatCount != count) {
+        splats.reset(new std::atomic<uint64_t>[count]);
+        splatCount = count;
+    }
+    pool.parallelFor(height, [&](int i) {
+        for (int j = 0; j < width; ++j) {
+            splats[static_cast<size_t>(i) * width + j].store(emptySplat, std::memory_order_relaxed);
+        }
+    });
+
+    //Every hit of the previous frame lands on the pixel whose area holds it in the new view, the closest one stays
+    pool.parallelFor(height, [&](int i) {
+        for (int j = 0; j < width; ++j) {
+            if (ids.at<int>(i, j) == INT_MAX) {
+                continue;
+            }
+            const Ray r = previous.getRay(i, j);
+            glm::vec2 pixel;
+            float distance;
+            if (!rays.project(r.p0 + r.dir * depths.at<float>(i, j), pixel, distance) || !(pixel.x >= 0.f && pixel.x < width && pixel.y >= 0.f && pixel.y < height)) {
+                continue;
+            }
+            const uint64_t value = toSplat(distance, i * width + j);
+            std::atomic<uint64_t>& target = splats[static_cast<size_t>(pixel.y) * width + static_cast<size_t>(pixel.x)];
+            uint64_t current = target.load(std::memory_order_relaxed);
+            while (value < current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+        }
+    });
+}
+
+cv::Mat TemporalRenderer::render(const PerspectiveCamera& cam) {
+    const RayGenerator rays(cam);
+    const RenderSettings frameSettings = withPixelAngle(settings, rays);
+    const int width = cam.getWidth();
+    const int height = cam.getHeight();
+    const bool reproject = hasHistory && width == camera.getWidth() && height == camera.getHeight();
+    const RayGenerator previous(reproject ? camera : cam);
+    if (reproject) {
+        splat(rays, previous);
+    }
+
+    cv::Mat nextColors(height, width, CV_8UC3);
+    cv::Mat nextIds(height, width, CV_32S);
+    cv::Mat nextDepths(height, width, CV_32F);
+    cv::Mat nextAges(height, width, CV_32S);
+    std::atomic<int> reusedCount(0);
+    std::atomic<int> tracedCount(0);
+    std::atomic<int> refreshedCount(0);
+    pool.parallelFor(height, [&](int i) {
+        int reused = 0;
+        int traced = 0;
+        int refreshed = 0;
+        for (int j = 0; j < width; ++j) {
+            const Ray r = rays.getRay(i, j);
+            int source = -1;
+            int index = INT_MAX;
+            float t = MAXFLOAT;
+            if (reproject) {
+                //A triangle test per distinct splatted triangle instead of a traversal, the neighbours close the gaps splatting
+                //leaves in surfaces that came closer and catch the pixels of a farther surface showing through such a gap
+                int tested[9];
+                int testedCount = 0;
+                int id = INT_MAX;
+                for (const int* offset : neighbourOffsets) {
+                    const int y = i + offset[0];
+                    const int x = j + offset[1];
+                    if (y < 0 || y >= height || x < 0 || x >= width) {
+                        continue;
+                    }
+                    const uint64_t value = splats[static_cast<size_t>(y) * width + x].load(std::memory_order_relaxed);
+                    if (value == emptySplat) {
+                        continue;
+                    }
+                    const int candidate = static_cast<int>(value & 0xffffffffu);
+                    const int slot = ids.ptr<int>()[candidate];
+                    if (std::find(tested, tested + testedCount, slot) != tested + testedCount) {
+                        continue;
+                    }
+                    tested[testedCount++] = slot;
+                    if (triangles.intersect(r, slot, 1, t, id)) {
+                        index = slot;
+                        source = candidate;
+                    }
+                }
+
+                //Misses are at infinity, the previous pixel looking in the same direction tells whether the ray missed before
+                //Only far from any hit, next to one the gap may open onto a triangle that was hidden behind it
+                glm::vec2 pixel;
+                float distance;
+                if (testedCount == 0 && previous.project(camera.getPosition() + r.dir, pixel, distance) &&
+                    pixel.x >= 0.f && pixel.x < width && pixel.y >= 0.f && pixel.y < height) {
+                    const int x = static_cast<int>(pixel.x);
+                    const int y = static_cast<int>(pixel.y);
+                    bool missed = true;
+                    for (const int* offset : neighbourOffsets) {
+                        const int u = std::min(std::max(x + offset[1], 0), width - 1);
+                        const int v = std::min(std::max(y + offset[0], 0), height - 1);
+                        missed = missed && ids.at<int>(v, u) == INT_MAX;
+                    }
+                    if (missed) {
+                        source = y * width + x;
+                    }
+                }
+            }
+
+            if (source >= 0) {
+                const int age = ages.ptr<int>()[source] + 1;
+                if (age < refreshFrames) {
+                    nextColors.at<Color>(i, j) = colors.ptr<Color>()[source];
+                    nextIds.at<int>(i, j) = index;
+                    nextDepths.at<float>(i, j) = t;
+                    nextAges.at<int>(i, j) = age;
+                    ++reused;
+                    continue;
+                }
+                ++refreshed;
+            }
+            else {
+                ++traced;
+            }
+
+            nextColors.at<Color>(i, j) = traceRay(r, triangles, &bvh, frameSettings, index, t);
+            nextIds.at<int>(i, j) = index;
+            nextDepths.at<float>(i, j) = t;
+            //A full frame starts its pixels at staggered ages, so that their refreshes are spread over the next frames
+            nextAges.at<int>(i, j) = reproject ? 0 : static_cast<int>((static_cast<unsigned>(i) * 73856093u ^ static_cast<unsigned>(j) * 19349663u) % refreshFrames);
+        }
+        reusedCount += reused;
+        tracedCount += traced;
+        refreshedCount += refreshed;
+    });
+
+    colors = nextColors;
+    ids = nextIds;
+    depths = nextDepths;
+    ages = nextAges;
+    camera = cam;
+    hasHistory = true;
+    stats.reusedPixels = reusedCount;
+    stats.tracedPixels = tracedCount;
+    stats.refreshedPixels = refreshedCount;
+
+    return colors.clone();
+}
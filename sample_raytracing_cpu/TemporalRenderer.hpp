@@ -0,0 +1,66 @@
+//
+//  TemporalRenderer.hpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#ifndef TemporalRenderer_hpp
+#define TemporalRenderer_hpp
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <opencv2/opencv.hpp>
+#include "RayTracer.hpp"
+
+//Pixels of the last frame by where their color came from
+struct TemporalFrameStats {
+    int reusedPixels = 0;
+    //Neither a reprojected hit that its ray still meets nor a miss in its direction
+    int tracedPixels = 0;
+    //Reprojected but refreshFrames old
+    int refreshedPixels = 0;
+};
+
+//Interactive rendering for a camera that moves a little from frame to frame, one center ray per pixel
+//The hits of the previous frame are splatted into the new view with a depth test, a pixel keeps the color of the closest triangle
+//among the splats of its 3x3 neighbourhood that its own ray still hits, or stays black when none is hit and the ray's direction missed
+//in the previous frame, everything else is traced
+//Reused colors keep the view dependent shading of the frame they were traced in and miss whatever comes in from outside the
+//old view in front of them, so every pixel is traced again after at most refreshFrames frames
+class TemporalRenderer {
+public:
+    TemporalRenderer(const TriangleBuffer& triangles, const BVH& bvh, ThreadPool& pool, const RenderSettings& settings = RenderSettings(), int refreshFrames = 16);
+    TemporalRenderer(const TemporalRenderer&) = delete;
+    TemporalRenderer& operator=(const TemporalRenderer&) = delete;
+
+    //Frame of the camera, traced in full when there is no previous frame of the same size
+    cv::Mat render(const PerspectiveCamera& camera);
+    //Forgets the previous frame, needed when the scene changes
+    void reset();
+    const TemporalFrameStats& getLastStats() const;
+
+private:
+    const TriangleBuffer& triangles;
+    const BVH& bvh;
+    ThreadPool& pool;
+    RenderSettings settings;
+    int refreshFrames;
+
+    //The previous frame, its camera and per pixel the slot (INT_MAX on a miss), the distance and the frames since it was traced
+    bool hasHistory;
+    PerspectiveCamera camera;
+    cv::Mat colors;
+    cv::Mat ids;
+    cv::Mat depths;
+    cv::Mat ages;
+    //Per pixel of the new frame the closest splat, distance bits above the index of the source pixel
+    std::unique_ptr<std::atomic<uint64_t>[]> splats;
+    size_t splatCount;
+    TemporalFrameStats stats;
+
+    void splat(const RayGenerator& rays, const RayGenerator& previous);
+};
+
+#endif /* TemporalRenderer_hpp */
@@ -0,0 +1,205 @@
+//
+//  Texture.cpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#include "Texture.hpp"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace {
+
+//8x8 texel blocks
+const int blockShift = 3;
+const int blockSize = 1 << blockShift;
+const int blockMask = blockSize - 1;
+
+//The three low bits of v moved to bits 0, 2 and 4
+const int spreadBits[blockSize] = {0, 1, 4, 5, 16, 17, 20, 21};
+
+inline int wrap(int x, int size) {
+    x %= size;
+    return x < 0 ? x + size : x;
+}
+
+}
+
+Texture::Texture() : layout(Layout::Tiled) {}
+
+Texture::Texture(const cv::Mat& image, bool mipmaps, Layout layout) : layout(layout) {
+    if (image.empty() || image.type() != CV_8UC3) {
+        std::cout << "Textures need an 8-bit, 3 channel image" << std::endl;
+        return;
+    }
+
+    //The chain is filtered in floats so that rounding doesn't build up from level to level
+    int width = image.cols;
+    int height = image.rows;
+    std::vector<glm::vec3> current(static_cast<size_t>(width) * height);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const Color& c = image.at<Color>(y, x);
+            current[static_cast<size_t>(y) * width + x] = glm::vec3(c[0], c[1], c[2]);
+        }
+    }
+
+    while (true) {
+        Level level;
+        level.width = width;
+        level.height = height;
+        level.blocksX = (width + blockSize - 1) / blockSize;
+        level.offset = texels.size();
+        const int blocksY = (height + blockSize - 1) / blockSize;
+        texels.resize(texels.size() + (layout == Layout::Tiled ? static_cast<size_t>(level.blocksX) * blocksY * blockSize * blockSize : current.size()));
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                const glm::vec3& c = current[static_cast<size_t>(y) * width + x];
+                texels[getIndex(level, x, y)] = Color(static_cast<unsigned char>(c[0] + 0.5f), static_cast<unsigned char>(c[1] + 0.5f), static_cast<unsigned char>(c[2] + 0.5f));
+            }
+        }
+        levels.push_back(level);
+        if (!mipmaps || (width == 1 && height == 1)) {
+            break;
+        }
+
+        //2x2 box filter, the last row or column of an odd sized level is folded into its neighbour's texel
+        const int nextWidth = std::max(1, width / 2);
+        const int nextHeight = std::max(1, height / 2);
+        std::vector<glm::vec3> next(static_cast<size_t>(nextWidth) * nextHeight);
+        for (int y = 0; y < nextHeight; ++y) {
+            const int y0 = std::min(2 * y, height - 1);
+            const int y1 = std::min(2 * y + 1, height - 1);
+            for (int x = 0; x < nextWidth; ++x) {
+                const int x0 = std::min(2 * x, width - 1);
+                const int x1 = std::min(2 * x + 1, width - 1);
+                next[static_cast<size_t>(y) * nextWidth + x] = (current[static_cast<size_t>(y0) * width + x0] + current[static_cast<size_t>(y0) * width + x1] +
+                                                                current[static_cast<size_t>(y1) * width + x0] + current[static_cast<size_t>(y1) * width + x1]) * 0.25f;
+            }
+        }
+        current.swap(next);
+        width = nextWidth;
+        height = nextHeight;
+    }
+}
+
+bool Texture::isEmpty() const {
+    return levels.empty();
+}
+
+int Texture::getWidth() const {
+    return levels.empty() ? 0 : levels[0].width;
+}
+
+int Texture::getHeight() const {
+    return levels.empty() ? 0 : levels[0].height;
+}
+
+int Texture::getLevelCount() const {
+    return static_cast<int>(levels.size());
+}
+
+Texture::Layout Texture::getLayout() const {
+    return layout;
+}
+
+uint64_t Texture::getHash() const {
+    if (levels.empty()) {
+        return 0;
+    }
+
+    //FNV-1a over the texels in row order
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (int y = 0; y < levels[0].height; ++y) {
+        for (int x = 0; x < levels[0].width; ++x) {
+            const Color texel = texels[getIndex(levels[0], x, y)];
+            for (int c = 0; c < 3; ++c) {
+                hash = (hash ^ texel[c]) * 0x100000001b3ull;
+            }
+        }
+    }
+
+    return hash;
+}
+
+size_t Texture::getRowOffset(const Level& level, int y) const {
+    if (layout == Layout::Linear) {
+        return static_cast<size_t>(y) * level.width;
+    }
+
+    return (static_cast<size_t>(y >> blockShift) * level.blocksX << (2 * blockShift)) + (spreadBits[y & blockMask] << 1);
+}
+
+size_t Texture::getColumnOffset(const Level& level, int x) const {
+    if (layout == Layout::Linear) {
+        return x;
+    }
+
+    return (static_cast<size_t>(x >> blockShift) << (2 * blockShift)) + spreadBits[x & blockMask];
+}
+
+size_t Texture::getIndex(const Level& level, int x, int y) const {
+    return level.offset + getRowOffset(level, y) + getColumnOffset(level, x);
+}
+
+Color Texture::getTexel(int level, int x, int y) const {
+    const Level& l = levels[std::min(std::max(level, 0), getLevelCount() - 1)];
+    return texels[getIndex(l, wrap(x, l.width), wrap(y, l.height))];
+}
+
+glm::vec3 Texture::sampleBilinear(const Level& level, const glm::vec2& uv) const {
+    //Texel centers sit at k + 0.5, the coordinates are brought into [0, 1) first so that large ones don't overflow
+    const float x = (uv.x - std::floor(uv.x)) * level.width - 0.5f;
+    const float y = (uv.y - std::floor(uv.y)) * level.height - 0.5f;
+    const float xFloor = std::floor(x);
+    const float yFloor = std::floor(y);
+    const float fx = x - xFloor;
+    const float fy = y - yFloor;
+    const int x0 = wrap(static_cast<int>(xFloor), level.width);
+    const int y0 = wrap(static_cast<int>(yFloor), level.height);
+    const int x1 = x0 + 1 == level.width ? 0 : x0 + 1;
+    const int y1 = y0 + 1 == level.height ? 0 : y0 + 1;
+
+    const Color* row0 = texels.data() + level.offset + getRowOffset(level, y0);
+    const Color* row1 = texels.data() + level.offset + getRowOffset(level, y1);
+    const size_t column0 = getColumnOffset(level, x0);
+    const size_t column1 = getColumnOffset(level, x1);
+    const Color& c00 = row0[column0];
+    const Color& c10 = row0[column1];
+    const Color& c01 = row1[column0];
+    const Color& c11 = row1[column1];
+    glm::vec3 result;
+    for (int c = 0; c < 3; ++c) {
+        const float top = c00[c] + (c10[c] - c00[c]) * fx;
+        const float bottom = c01[c] + (c11[c] - c01[c]) * fx;
+        result[c] = top + (bottom - top) * fy;
+    }
+
+    return result;
+}
+
+glm::vec3 Texture::sample(const glm::vec2& uv, float level) const {
+    //White leaves the tinted colors as they are
+    if (levels.empty()) {
+        return glm::vec3(255.f);
+    }
+    //Written so that NaN levels end up at full resolution
+    if (!(level > 0.f)) {
+        level = 0.f;
+    }
+    const int last = getLevelCount() - 1;
+    if (level >= last) {
+        return sampleBilinear(levels[last], uv);
+    }
+
+    const int lower = static_cast<int>(level);
+    const float blend = level - lower;
+    const glm::vec3 fine = sampleBilinear(levels[lower], uv);
+    if (blend == 0.f) {
+        return fine;
+    }
+
+    return fine + (sampleBilinear(levels[lower + 1], uv) - fine) * blend;
+}
@@ -0,0 +1,65 @@
+//
+//  Texture.hpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#ifndef Texture_hpp
+#define Texture_hpp
+
+#include <cstdint>
+#include <vector>
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+#include <opencv2/opencv.hpp>
+#include "Triangle.hpp"
+
+//Mip mapped color texture, coordinates repeat outside [0, 1] and v = 0 is the top row of the image
+//Tiled levels are stored in 8x8 texel blocks with the texels of a block in Morton order, so the four texels of a
+//bilinear lookup are usually in the same 192 byte block instead of two rows that are a whole image width apart
+class Texture {
+public:
+    enum class Layout {
+        Tiled,
+        //Row after row like the image, kept to measure what the tiling gains
+        Linear
+    };
+
+    Texture();
+    //The image is 8-bit BGR like the frames, without mipmaps only the full resolution level is kept
+    explicit Texture(const cv::Mat& image, bool mipmaps = true, Layout layout = Layout::Tiled);
+
+    bool isEmpty() const;
+    int getWidth() const;
+    int getHeight() const;
+    int getLevelCount() const;
+    Layout getLayout() const;
+    //Content hash of the full resolution level, the same for both layouts, 0 for an empty texture
+    uint64_t getHash() const;
+    //Texel of a level, x and y wrap around
+    Color getTexel(int level, int x, int y) const;
+    //Bilinear lookups in the two levels around the fractional level, blended, in 0-255 color units
+    //Level 0 is the full resolution, anything outside of the chain is clamped to it, an empty texture is white
+    glm::vec3 sample(const glm::vec2& uv, float level) const;
+
+private:
+    struct Level {
+        int width;
+        int height;
+        int blocksX;
+        size_t offset;
+    };
+
+    Layout layout;
+    std::vector<Level> levels;
+    std::vector<Color> texels;
+
+    //Texel (x, y) of a level is at level.offset + getRowOffset(y) + getColumnOffset(x), Morton order keeps the bits of x and y apart
+    size_t getRowOffset(const Level& level, int y) const;
+    size_t getColumnOffset(const Level& level, int x) const;
+    size_t getIndex(const Level& level, int x, int y) const;
+    glm::vec3 sampleBilinear(const Level& level, const glm::vec2& uv) const;
+};
+
+#endif /* Texture_hpp */
@@ -0,0 +1,108 @@
+//
+//  ThreadPool.cpp
+//  Test
+//
+//  Created by Erik Nouroyan on 17.10.26.
+//
+
+#include "ThreadPool.hpp"
+
+ThreadPool::ThreadPool(int threadCount) : remaining(0), generation(0), stopping(false) {
+    if (threadCount <= 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (int i = 0; i < threadCount; ++i) {
+        queues.push_back(std::make_unique<TaskQueue>());
+    }
+    for (int i = 0; i < threadCount; ++i) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeCondition.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int)>& task) {
+    if (count <= 0) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> submitLock(submitMutex);
+    std::unique_lock<std::mutex> lock(mutex);
+    remaining = count;
+
+    //Contiguous ranges keep neighbouring tasks on the same worker until stealing kicks in
+    const int threadCount = static_cast<int>(queues.size());
+    for (int w = 0; w < threadCount; ++w) {
+        const int begin = static_cast<int>(static_cast<long>(count) * w / threadCount);
+        const int end = static_cast<int>(static_cast<long>(count) * (w + 1) / threadCount);
+        std::lock_guard<std::mutex> queueLock(queues[w]->mutex);
+        for (int i = begin; i < end; ++i) {
+            queues[w]->tasks.push_back({&task, i});
+        }
+    }
+    ++generation;
+    wakeCondition.notify_all();
+
+    doneCondition.wait(lock, [this]() { return remaining.load() == 0; });
+}
+
+int ThreadPool::getThreadCount() const {
+    return static_cast<int>(workers.size());
+}
+
+bool ThreadPool::popTask(int id, Task& task) {
+    {
+        TaskQueue& own = *queues[id];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = own.tasks.front();
+            own.tasks.pop_front();
+            return true;
+        }
+    }
+
+    const int threadCount = static_cast<int>(queues.size());
+    for (int offset = 1; offset < threadCount; ++offset) {
+        TaskQueue& victim = *queues[(id + offset) % threadCount];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = victim.tasks.back();
+            victim.tasks.pop_back();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void ThreadPool::workerLoop(int id) {
+    unsigned long seenGeneration = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeCondition.wait(lock, [&]() { return stopping || generation != seenGeneration; });
+            if (stopping) {
+                return;
+            }
+            seenGeneration = generation;
+        }
+
+        Task task;
+        while (popTask(id, task)) {
+            (*task.job)(task.index);
+            if (--remaining == 0) {
+                std::lock_guard<std::mutex> lock(mutex);
+                doneCondition.notify_all();
+            }
+        }
+    }
+}
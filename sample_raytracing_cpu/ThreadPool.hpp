@@ -0,0 +1,58 @@
+//
+//  ThreadPool.hpp
+//  Test
+//
+//  Created by Erik Nouroyan on 17.10.26.
+//
+
+#ifndef ThreadPool_hpp
+#define ThreadPool_hpp
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+//Persistent workers with one task deque each, idle workers steal from the back of the others
+class ThreadPool {
+public:
+    //0 means one worker per hardware thread
+    explicit ThreadPool(int threadCount = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    //Runs task(index) for every index in [0, count) and blocks until all of them are finished
+    void parallelFor(int count, const std::function<void(int)>& task);
+    int getThreadCount() const;
+
+private:
+    struct Task {
+        const std::function<void(int)>* job;
+        int index;
+    };
+
+    struct TaskQueue {
+        std::deque<Task> tasks;
+        std::mutex mutex;
+    };
+
+    std::vector<std::unique_ptr<TaskQueue>> queues;
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::mutex submitMutex;
+    std::condition_variable wakeCondition;
+    std::condition_variable doneCondition;
+    std::atomic<int> remaining;
+    unsigned long generation;
+    bool stopping;
+
+    void workerLoop(int id);
+    bool popTask(int id, Task& task);
+};
+
+#endif /* ThreadPool_hpp */
@@ -0,0 +1,485 @@
+//
+//  TileServer.cpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#include "TileServer.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <type_traits>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+const char magic[8] = {'R', 'T', 'T', 'I', 'L', 'E', 'S', 0};
+const uint32_t protocolVersion = 2;
+//Tiles queued per worker thread, so that a worker never waits for the next tile
+const int tilesPerThread = 2;
+
+enum MessageType : uint32_t {
+    Hello = 1,
+    Frame = 2,
+    Tile = 3,
+    Result = 4
+};
+
+struct MessageHeader {
+    uint32_t type;
+    uint32_t size;
+};
+
+struct HelloMessage {
+    char magic[8];
+    uint32_t version;
+    uint32_t frameMessageSize;
+    int32_t triangleCount;
+    int32_t threadCount;
+    //Size and content hash of the worker's texture, all 0 without one
+    uint64_t textureHash;
+    int32_t hasTexture;
+    int32_t textureWidth;
+    int32_t textureHeight;
+};
+
+struct FrameMessage {
+    int32_t frameId;
+    PerspectiveCamera camera;
+    RenderSettings settings;
+};
+
+//A result is the same rectangle followed by its BGR pixels row by row
+struct TileMessage {
+    int32_t frameId;
+    int32_t tileIndex;
+    int32_t x;
+    int32_t y;
+    int32_t width;
+    int32_t height;
+};
+
+static_assert(std::is_trivially_copyable<FrameMessage>::value, "The camera and the settings are sent as they are");
+
+bool sendAll(int socket, const void* data, size_t size) {
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_NOSIGNAL;
+#else
+    const int flags = 0;
+#endif
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        const ssize_t sent = send(socket, bytes, size, flags);
+        if (sent <= 0) {
+            return false;
+        }
+        bytes += sent;
+        size -= sent;
+    }
+
+    return true;
+}
+
+bool receiveAll(int socket, void* data, size_t size) {
+    char* bytes = static_cast<char*>(data);
+    while (size > 0) {
+        const ssize_t received = recv(socket, bytes, size, 0);
+        if (received <= 0) {
+            return false;
+        }
+        bytes += received;
+        size -= received;
+    }
+
+    return true;
+}
+
+//The payload may come in two parts, so that the pixels of a tile don't have to be copied behind its rectangle
+bool sendMessage(int socket, uint32_t type, const void* payload, size_t size, const void* extra = nullptr, size_t extraSize = 0) {
+    const MessageHeader header = {type, static_cast<uint32_t>(size + extraSize)};
+    return sendAll(socket, &header, sizeof(header)) && sendAll(socket, payload, size) && (extraSize == 0 || sendAll(socket, extra, extraSize));
+}
+
+void configureSocket(int socket) {
+    //Tile requests are small and latency bound
+    const int enabled = 1;
+    setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, &enabled, sizeof(enabled));
+#ifdef SO_NOSIGPIPE
+    setsockopt(socket, SOL_SOCKET, SO_NOSIGPIPE, &enabled, sizeof(enabled));
+#endif
+}
+
+int connectTo(const std::string& host, int port) {
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &addresses) != 0) {
+        return -1;
+    }
+
+    int result = -1;
+    for (addrinfo* address = addresses; address && result < 0; address = address->ai_next) {
+        const int s = socket(address->ai_family, address->ai_socktype, address->ai_protocol);
+        if (s < 0) {
+            continue;
+        }
+        if (connect(s, address->ai_addr, address->ai_addrlen) == 0) {
+            result = s;
+        }
+        else {
+            close(s);
+        }
+    }
+    freeaddrinfo(addresses);
+
+    return result;
+}
+
+bool isValid(const TileMessage& tile, const cv::Rect& rect) {
+    return tile.x == rect.x && tile.y == rect.y && tile.width == rect.width && tile.height == rect.height;
+}
+
+}
+
+TileCoordinator::TileCoordinator(int port, int triangleCount, const Texture* texture, double workerTimeout)
+    : triangleCount(triangleCount), hasTexture(texture && !texture->isEmpty()), textureWidth(hasTexture ? texture->getWidth() : 0),
+      textureHeight(hasTexture ? texture->getHeight() : 0), textureHash(hasTexture ? texture->getHash() : 0), workerTimeout(workerTimeout),
+      listenSocket(-1), frameCount(0), reassignedCount(0) {
+    listenSocket = socket(AF_INET, SOCK_STREAM, 0);
+    if (listenSocket < 0) {
+        std::cout << "Could not create the coordinator socket" << std::endl;
+        return;
+    }
+    const int enabled = 1;
+    setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &enabled, sizeof(enabled));
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    if (bind(listenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listenSocket, 16) != 0) {
+        std::cout << "Could not listen on port " << port << std::endl;
+        close(listenSocket);
+        listenSocket = -1;
+    }
+}
+
+TileCoordinator::~TileCoordinator() {
+    for (const Worker& worker : workers) {
+        close(worker.socket);
+    }
+    if (listenSocket >= 0) {
+        close(listenSocket);
+    }
+}
+
+bool TileCoordinator::isListening() const {
+    return listenSocket >= 0;
+}
+
+int TileCoordinator::getWorkerCount() const {
+    return static_cast<int>(std::count_if(workers.begin(), workers.end(), [](const Worker& worker) {
+        return worker.ready;
+    }));
+}
+
+int TileCoordinator::getReassignedCount() const {
+    return reassignedCount;
+}
+
+void TileCoordinator::acceptWorker() {
+    const int s = accept(listenSocket, nullptr, nullptr);
+    if (s < 0) {
+        return;
+    }
+    configureSocket(s);
+    workers.push_back({s, false, 0, -1, {}, {}, Clock::now()});
+}
+
+void TileCoordinator::dropWorker(size_t index, std::deque<int>& pending) {
+    Worker& worker = workers[index];
+    if (worker.ready) {
+        std::cout << "Lost a worker, handing its " << worker.tiles.size() << " tiles to the others" << std::endl;
+    }
+    reassignedCount += static_cast<int>(worker.tiles.size());
+    for (auto tile = worker.tiles.rbegin(); tile != worker.tiles.rend(); ++tile) {
+        pending.push_front(*tile);
+    }
+    close(worker.socket);
+    workers.erase(workers.begin() + index);
+}
+
+bool TileCoordinator::receive(Worker& worker, int frameId, const std::vector<cv::Rect>& tiles, std::vector<char>& done, int& doneCount, cv::Mat& frame) {
+    char chunk[65536];
+    const ssize_t received = recv(worker.socket, chunk, sizeof(chunk), 0);
+    if (received <= 0) {
+        return false;
+    }
+    worker.buffer.insert(worker.buffer.end(), chunk, chunk + received);
+    //Until its hello is complete a connection keeps the time it was accepted at, trickling bytes doesn't extend the handshake
+    if (worker.ready) {
+        worker.lastHeard = Clock::now();
+    }
+
+    //The first tile is the largest, the others are only cut off at the right and bottom edges of the frame
+    const size_t maxResultSize = sizeof(TileMessage) + (tiles.empty() ? 0 : static_cast<size_t>(tiles[0].width) * tiles[0].height * 3);
+    size_t offset = 0;
+    while (worker.buffer.size() - offset >= sizeof(MessageHeader)) {
+        MessageHeader header;
+        memcpy(&header, worker.buffer.data() + offset, sizeof(header));
+        //A size no message can have would only make the buffer grow while the rest of it is awaited
+        if (header.size > (worker.ready ? maxResultSize : sizeof(HelloMessage))) {
+            return false;
+        }
+        if (worker.buffer.size() - offset - sizeof(header) < header.size) {
+            break;
+        }
+        const char* payload = worker.buffer.data() + offset + sizeof(header);
+        offset += sizeof(header) + header.size;
+
+        if (header.type == Hello && !worker.ready) {
+            HelloMessage hello;
+            if (header.size != sizeof(hello)) {
+                return false;
+            }
+            memcpy(&hello, payload, sizeof(hello));
+            if (memcmp(hello.magic, magic, sizeof(magic)) != 0 || hello.version != protocolVersion || hello.frameMessageSize != sizeof(FrameMessage)) {
+                std::cout << "Rejected a worker built from a different version" << std::endl;
+                return false;
+            }
+            if (hello.triangleCount != triangleCount) {
+                std::cout << "Rejected a worker with " << hello.triangleCount << " triangles instead of " << triangleCount << std::endl;
+                return false;
+            }
+            if ((hello.hasTexture != 0) != hasTexture || hello.textureWidth != textureWidth || hello.textureHeight != textureHeight || hello.textureHash != textureHash) {
+                std::cout << "Rejected a worker with a different texture" << std::endl;
+                return false;
+            }
+            worker.ready = true;
+            worker.threadCount = std::max(1, static_cast<int>(hello.threadCount));
+            std::cout << "Worker connected with " << worker.threadCount << " threads" << std::endl;
+            continue;
+        }
+        if (header.type != Result || !worker.ready || header.size < sizeof(TileMessage)) {
+            return false;
+        }
+
+        TileMessage result;
+        memcpy(&result, payload, sizeof(result));
+        //Results of an earlier frame can still be on the way after it was given up on
+        if (result.frameId != frameId) {
+            continue;
+        }
+        const auto inFlight = std::find(worker.tiles.begin(), worker.tiles.end(), result.tileIndex);
+        if (inFlight == worker.tiles.end()) {
+            return false;
+        }
+        const cv::Rect& rect = tiles[result.tileIndex];
+        if (!isValid(result, rect) || header.size != sizeof(result) + static_cast<size_t>(rect.width) * rect.height * 3) {
+            return false;
+        }
+        worker.tiles.erase(inFlight);
+        if (!done[result.tileIndex]) {
+            const char* pixels = payload + sizeof(result);
+            for (int y = 0; y < rect.height; ++y) {
+                memcpy(frame.ptr(rect.y + y) + rect.x * 3, pixels + static_cast<size_t>(y) * rect.width * 3, rect.width * 3);
+            }
+            done[result.tileIndex] = 1;
+            ++doneCount;
+        }
+    }
+    worker.buffer.erase(worker.buffer.begin(), worker.buffer.begin() + offset);
+
+    return true;
+}
+
+cv::Mat TileCoordinator::render(const PerspectiveCamera& cam, const RenderSettings& settings) {
+    if (listenSocket < 0) {
+        return cv::Mat();
+    }
+    const int width = cam.getWidth();
+    const int height = cam.getHeight();
+    const int tileSize = settings.tileSize;
+    std::vector<cv::Rect> tiles;
+    for (int y = 0; y < height; y += tileSize) {
+        for (int x = 0; x < width; x += tileSize) {
+            tiles.emplace_back(x, y, std::min(tileSize, width - x), std::min(tileSize, height - y));
+        }
+    }
+
+    cv::Mat frame = cv::Mat::zeros(height, width, CV_8UC3);
+    const int frameId = frameCount++;
+    FrameMessage frameMessage = {frameId, cam, settings};
+    //A pointer means nothing in another process, the worker uses the texture it loaded itself
+    frameMessage.settings.texture = nullptr;
+    std::deque<int> pending;
+    for (int i = 0; i < static_cast<int>(tiles.size()); ++i) {
+        pending.push_back(i);
+    }
+    std::vector<char> done(tiles.size(), 0);
+    int doneCount = 0;
+    Clock::time_point lastWorker = Clock::now();
+
+    while (doneCount < static_cast<int>(tiles.size())) {
+        //Topping up every worker's queue, the camera and the settings go first when the worker hasn't seen this frame yet
+        for (size_t w = 0; w < workers.size(); ++w) {
+            Worker& worker = workers[w];
+            if (!worker.ready) {
+                continue;
+            }
+            bool sent = true;
+            if (worker.frameId != frameId && !pending.empty()) {
+                sent = sendMessage(worker.socket, Frame, &frameMessage, sizeof(frameMessage));
+                worker.frameId = frameId;
+            }
+            while (sent && !pending.empty() && static_cast<int>(worker.tiles.size()) < worker.threadCount * tilesPerThread) {
+                const int index = pending.front();
+                pending.pop_front();
+                worker.tiles.push_back(index);
+                if (worker.tiles.size() == 1) {
+                    worker.lastHeard = Clock::now();
+                }
+                const cv::Rect& rect = tiles[index];
+                const TileMessage tile = {frameId, index, rect.x, rect.y, rect.width, rect.height};
+                sent = sendMessage(worker.socket, Tile, &tile, sizeof(tile));
+            }
+            if (!sent) {
+                dropWorker(w--, pending);
+            }
+        }
+
+        const Clock::time_point now = Clock::now();
+        if (getWorkerCount() > 0) {
+            lastWorker = now;
+        }
+        else if (std::chrono::duration<double>(now - lastWorker).count() > workerTimeout) {
+            std::cout << "No workers left, " << tiles.size() - doneCount << " tiles of the frame were not rendered" << std::endl;
+            return cv::Mat();
+        }
+
+        std::vector<pollfd> sockets(1, {listenSocket, POLLIN, 0});
+        for (const Worker& worker : workers) {
+            sockets.push_back({worker.socket, POLLIN, 0});
+        }
+        if (poll(sockets.data(), sockets.size(), 100) < 0) {
+            continue;
+        }
+        //Walking backwards so that dropping a worker doesn't shift the ones still to be looked at
+        for (size_t w = workers.size(); w-- > 0;) {
+            Worker& worker = workers[w];
+            const bool readable = sockets[w + 1].revents & (POLLIN | POLLHUP | POLLERR);
+            if (readable && !receive(worker, frameId, tiles, done, doneCount, frame)) {
+                dropWorker(w, pending);
+            }
+            else if ((!worker.ready || !worker.tiles.empty()) && std::chrono::duration<double>(Clock::now() - worker.lastHeard).count() > workerTimeout) {
+                std::cout << (worker.ready ? "A worker stopped answering" : "Closed a connection that sent no hello") << std::endl;
+                dropWorker(w, pending);
+            }
+        }
+        if (sockets[0].revents & POLLIN) {
+            acceptWorker();
+        }
+    }
+
+    return frame;
+}
+
+bool runTileWorker(const std::string& host, int port, const TriangleBuffer& triangles, const BVH& bvh, ThreadPool& pool, const Texture* texture) {
+    const int s = connectTo(host, port);
+    if (s < 0) {
+        std::cout << "Could not connect to " << host << ":" << port << std::endl;
+        return false;
+    }
+    configureSocket(s);
+    HelloMessage hello = {};
+    memcpy(hello.magic, magic, sizeof(magic));
+    hello.version = protocolVersion;
+    hello.frameMessageSize = sizeof(FrameMessage);
+    hello.triangleCount = triangles.size();
+    hello.threadCount = pool.getThreadCount();
+    if (texture && !texture->isEmpty()) {
+        hello.hasTexture = 1;
+        hello.textureWidth = texture->getWidth();
+        hello.textureHeight = texture->getHeight();
+        hello.textureHash = texture->getHash();
+    }
+    if (!sendMessage(s, Hello, &hello, sizeof(hello))) {
+        close(s);
+        return false;
+    }
+
+    //The tiles are rendered into a frame sized image, so that they land where the generator puts them
+    FrameMessage frameMessage = {};
+    cv::Mat frame;
+    std::unique_ptr<RayGenerator> rays;
+    std::vector<TileMessage> batch;
+    std::vector<char> pixels;
+    int renderedCount = 0;
+    //Renders the tiles received so far side by side on the pool and sends them back
+    auto flush = [&]() {
+        pool.parallelFor(static_cast<int>(batch.size()), [&](int i) {
+            const TileMessage& tile = batch[i];
+            renderTile(frame, *rays, triangles, &bvh, cv::Rect(tile.x, tile.y, tile.width, tile.height), frameMessage.settings);
+        });
+        for (const TileMessage& tile : batch) {
+            pixels.resize(static_cast<size_t>(tile.width) * tile.height * 3);
+            for (int y = 0; y < tile.height; ++y) {
+                memcpy(pixels.data() + static_cast<size_t>(y) * tile.width * 3, frame.ptr(tile.y + y) + tile.x * 3, tile.width * 3);
+            }
+            if (!sendMessage(s, Result, &tile, sizeof(tile), pixels.data(), pixels.size())) {
+                return false;
+            }
+            ++renderedCount;
+        }
+        batch.clear();
+        return true;
+    };
+
+    while (true) {
+        MessageHeader header;
+        if (!receiveAll(s, &header, sizeof(header))) {
+            break;
+        }
+        if (header.type == Frame && header.size == sizeof(FrameMessage)) {
+            if (!flush() || !receiveAll(s, &frameMessage, sizeof(frameMessage))) {
+                break;
+            }
+            //The coordinator checked at the handshake that this texture matches its own
+            frameMessage.settings.texture = texture;
+            const RenderSettings& settings = frameMessage.settings;
+            rays.reset(new RayGenerator(frameMessage.camera, settings.adaptive.enabled ? settings.adaptive.baseSamples : settings.samplesPerPixel));
+            frame = cv::Mat::zeros(frameMessage.camera.getHeight(), frameMessage.camera.getWidth(), CV_8UC3);
+        }
+        else if (header.type == Tile && header.size == sizeof(TileMessage) && rays) {
+            TileMessage tile;
+            if (!receiveAll(s, &tile, sizeof(tile))) {
+                break;
+            }
+            if (tile.frameId == frameMessage.frameId && tile.x >= 0 && tile.y >= 0 && tile.width > 0 && tile.height > 0 &&
+                tile.x + tile.width <= frame.cols && tile.y + tile.height <= frame.rows) {
+                batch.push_back(tile);
+            }
+        }
+        else {
+            std::cout << "Unexpected message from the coordinator" << std::endl;
+            break;
+        }
+
+        //Every tile that is already waiting joins the batch before it is rendered
+        pollfd waiting = {s, POLLIN, 0};
+        if (poll(&waiting, 1, 0) <= 0 && !flush()) {
+            break;
+        }
+    }
+    close(s);
+    std::cout << "Coordinator closed the connection after " << renderedCount << " tiles" << std::endl;
+
+    return true;
+}
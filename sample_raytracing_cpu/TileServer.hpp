@@ -0,0 +1,76 @@
+//
+//  TileServer.hpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#ifndef TileServer_hpp
+#define TileServer_hpp
+
+#include <chrono>
+#include <deque>
+#include <string>
+#include <vector>
+#include <opencv2/opencv.hpp>
+#include "RayTracer.hpp"
+
+//Hands the tiles of a frame out to worker processes over TCP and stitches the tiles they send back
+//Every worker loads the scene itself once and keeps it for all frames, only the camera, the settings and the tile rectangles go over the wire
+//Messages are sent in host byte order with the settings as they are in memory, so all processes have to run the same build
+//The texture is loaded by every worker too, the settings go out with a null texture pointer and each worker puts its own in
+class TileCoordinator {
+public:
+    //triangleCount and the texture's size and content hash are checked against the scene of every worker that connects
+    TileCoordinator(int port, int triangleCount, const Texture* texture = nullptr, double workerTimeout = 10.);
+    ~TileCoordinator();
+    TileCoordinator(const TileCoordinator&) = delete;
+    TileCoordinator& operator=(const TileCoordinator&) = delete;
+
+    bool isListening() const;
+    //Waits for workers to connect when there are none, returns an empty Mat when none turned up within the worker timeout
+    //A worker that disconnects or stays silent for the timeout is dropped and its tiles are handed to the others
+    //A connection that doesn't complete its hello within the timeout is closed
+    cv::Mat render(const PerspectiveCamera& cam, const RenderSettings& settings);
+    int getWorkerCount() const;
+    //Tiles that had to be handed out again because their worker was lost
+    int getReassignedCount() const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Worker {
+        int socket;
+        bool ready;
+        int threadCount;
+        //Last frame the worker got the camera and the settings of
+        int frameId;
+        std::vector<int> tiles;
+        std::vector<char> buffer;
+        //When the last message arrived, for a connection still in its handshake when it was accepted
+        Clock::time_point lastHeard;
+    };
+
+    const int triangleCount;
+    const bool hasTexture;
+    const int textureWidth;
+    const int textureHeight;
+    const uint64_t textureHash;
+    const double workerTimeout;
+    int listenSocket;
+    int frameCount;
+    int reassignedCount;
+    std::vector<Worker> workers;
+
+    void acceptWorker();
+    //Drops the worker and puts its unfinished tiles back in front of the queue
+    void dropWorker(size_t index, std::deque<int>& pending);
+    //Reads what arrived from the worker and handles every complete message, false when the connection is broken
+    bool receive(Worker& worker, int frameId, const std::vector<cv::Rect>& tiles, std::vector<char>& done, int& doneCount, cv::Mat& frame);
+};
+
+//Connects to the coordinator and renders the tiles it sends until it disconnects, false when it can't be reached
+//The texture has to be the one the coordinator was given, the coordinator refuses the worker otherwise
+bool runTileWorker(const std::string& host, int port, const TriangleBuffer& triangles, const BVH& bvh, ThreadPool& pool, const Texture* texture = nullptr);
+
+#endif /* TileServer_hpp */
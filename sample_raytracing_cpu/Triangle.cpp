@@ -8,14 +8,13 @@
 #include "Triangle.hpp"
 #include <iostream>
 
-Triangle::Triangle(): vertices{{1.f, 0.f, -1.f}, {-1.f, 0.f, -1.f}, {0.f, 1.f, -1.f}}, color{128, 128, 128} {}
+Triangle::Triangle(): vertices{{{1.f, 0.f, -1.f}, {-1.f, 0.f, -1.f}, {0.f, 1.f, -1.f}}}, texCoords{}, color{128, 128, 128} {}
 
-Triangle::Triangle(const std::initializer_list<Vertex>& il, const Color& c) {
+Triangle::Triangle(const std::initializer_list<Vertex>& il, const Color& c) : vertices{}, texCoords{} {
     if (il.size() != 3) {
         std::cout << "Invalid size for initializer list!" << std::endl;
     }
-    vertices = std::vector<Vertex>(3);
-    std::copy(il.begin(), il.end(), vertices.begin());
+    std::copy(il.begin(), il.begin() + std::min<size_t>(il.size(), 3), vertices.begin());
     setColor(c);
 }
 
@@ -31,58 +30,28 @@ void Triangle::setVertices(const std::vector<Vertex>& vertices) {
     if (vertices.size() != 3) {
         std::cout << "Invalid size for vertices!" << std::endl;
     }
-    this->vertices = vertices;
+    std::copy(vertices.begin(), vertices.begin() + std::min<size_t>(vertices.size(), 3), this->vertices.begin());
 }
 
-std::vector<Vertex> Triangle::getVertices() const {
+const std::array<Vertex, 3>& Triangle::getVertices() const {
     return vertices;
 }
 
-glm::vec3 Triangle::getPlaneNormal() const {
-    return glm::normalize(glm::cross(vertices[1] - vertices[0], vertices[2] - vertices[0]));
+void Triangle::setTexCoords(const std::vector<TexCoord>& texCoords) {
+    if (texCoords.size() != 3) {
+        std::cout << "Invalid size for texture coordinates!" << std::endl;
+    }
+    std::copy(texCoords.begin(), texCoords.begin() + std::min<size_t>(texCoords.size(), 3), this->texCoords.begin());
 }
 
-float Triangle::getPlaneDistance() const {
-    return abs(glm::dot(vertices[0], getPlaneNormal()));
+const std::array<TexCoord, 3>& Triangle::getTexCoords() const {
+    return texCoords;
 }
 
-bool Triangle::isInsideTriangle(const glm::vec3& point) const {
-    glm::vec3 normal = getPlaneNormal();
-    for (int i = 0; i < 3; ++i) {
-        glm::vec3 edge = vertices[(i + 1) % 3] - vertices[i];
-        glm::vec3 vertexToPoint = point - vertices[i];
-        glm::vec3 cross = glm::cross(edge, vertexToPoint);
-        if (glm::dot(cross, normal) < 0.f) {
-            return false;
-        }
-    }
-    
-    return true;
+glm::vec3 Triangle::getNormal() const {
+    return glm::normalize(glm::cross(vertices[1] - vertices[0], vertices[2] - vertices[0]));
 }
 
 bool Triangle::intersects(const Ray& ray, float& t) const {
-    float dist = getPlaneDistance();
-    glm::vec3 normal = getPlaneNormal();
-    float dirDotNormal = glm::dot(ray.dir, normal);
-    
-    //Parallel case
-    if (abs(dirDotNormal - 0.f) < 0.0001) {
-        return false;
-    }
-    
-    float tTmp = (dist - dot(ray.p0, normal)) / dirDotNormal;
-    
-    //Ray is behind
-    if (tTmp < 0.f) {
-        return false;
-    }
-    
-    glm::vec3 intersectionPoint = ray.p0 + tTmp * ray.dir;
-    if (!isInsideTriangle(intersectionPoint)) {
-        return false;
-    }
-    
-    t = tTmp;
-    
-    return true;
+    return intersectTriangle(ray, vertices[0], vertices[1] - vertices[0], vertices[2] - vertices[0], t);
 }
@@ -8,20 +8,19 @@
 #ifndef Triangle_hpp
 #define Triangle_hpp
 
+#include <array>
 #include <initializer_list>
 #include <vector>
+#include <glm/vec2.hpp>
 #include <glm/mat4x4.hpp>
 #include <glm/ext/matrix_transform.hpp>
 #include <glm/ext/matrix_clip_space.hpp>
 #include <opencv2/opencv.hpp>
+#include "Ray.hpp"
 
 using Color = cv::Vec3b;
 using Vertex = glm::vec3;
-
-struct Ray {
-    glm::vec3 p0;
-    glm::vec3 dir;
-};
+using TexCoord = glm::vec2;
 
 class Triangle {
 public:
@@ -30,16 +29,57 @@ public:
     void setColor(const Color& col);
     Color getColor() const;
     void setVertices(const std::vector<Vertex>& vertices);
-    std::vector<Vertex> getVertices() const;
+    const std::array<Vertex, 3>& getVertices() const;
+    //Texture coordinates of the three vertices, all (0, 0) until they are set
+    void setTexCoords(const std::vector<TexCoord>& texCoords);
+    const std::array<TexCoord, 3>& getTexCoords() const;
+    glm::vec3 getNormal() const;
     bool intersects(const Ray& r, float& t) const;
     
 private:
-    std::vector<Vertex> vertices;
+    std::array<Vertex, 3> vertices;
+    std::array<TexCoord, 3> texCoords;
     Color color;
-    
-    glm::vec3 getPlaneNormal() const;
-    float getPlaneDistance() const;
-    bool isInsideTriangle(const glm::vec3& point) const;
 };
 
+//Möller-Trumbore test shared by Triangle and the vectorized TriangleBuffer kernels, which repeat the same operations lane by lane
+inline bool intersectTriangle(const Ray& r, const glm::vec3& v0, const glm::vec3& e1, const glm::vec3& e2, float& t) {
+    const float px = r.dir.y * e2.z - r.dir.z * e2.y;
+    const float py = r.dir.z * e2.x - r.dir.x * e2.z;
+    const float pz = r.dir.x * e2.y - r.dir.y * e2.x;
+    const float det = e1.x * px + e1.y * py + e1.z * pz;
+    
+    //Parallel case
+    if (det > -1e-12f && det < 1e-12f) {
+        return false;
+    }
+    
+    const float invDet = 1.f / det;
+    const float sx = r.p0.x - v0.x;
+    const float sy = r.p0.y - v0.y;
+    const float sz = r.p0.z - v0.z;
+    const float u = (sx * px + sy * py + sz * pz) * invDet;
+    if (u < 0.f || u > 1.f) {
+        return false;
+    }
+    
+    const float qx = sy * e1.z - sz * e1.y;
+    const float qy = sz * e1.x - sx * e1.z;
+    const float qz = sx * e1.y - sy * e1.x;
+    const float v = (r.dir.x * qx + r.dir.y * qy + r.dir.z * qz) * invDet;
+    if (v < 0.f || u + v > 1.f) {
+        return false;
+    }
+    
+    //Ray is behind
+    const float tTmp = (e2.x * qx + e2.y * qy + e2.z * qz) * invDet;
+    if (tTmp < 0.f) {
+        return false;
+    }
+    
+    t = tTmp;
+    
+    return true;
+}
+
 #endif /* Triangle_hpp */
@@ -0,0 +1,352 @@
+//
+//  TriangleBuffer.cpp
+//  Test
+//
+//  Created by Erik Nouroyan on 17.10.26.
+//
+
+#include "TriangleBuffer.hpp"
+#include "RenderStats.hpp"
+#include <algorithm>
+#include <climits>
+
+namespace {
+
+//Lane-wise copy of intersectTriangle, the operations are kept in the same order so both give identical results
+inline simd::Mask intersectLanes(const simd::Float p0[3], const simd::Float dir[3], const simd::Float v0[3], const simd::Float e1[3], const simd::Float e2[3], simd::Float& t) {
+    const simd::Float px = dir[1] * e2[2] - dir[2] * e2[1];
+    const simd::Float py = dir[2] * e2[0] - dir[0] * e2[2];
+    const simd::Float pz = dir[0] * e2[1] - dir[1] * e2[0];
+    const simd::Float det = e1[0] * px + e1[1] * py + e1[2] * pz;
+    const simd::Mask parallel = (det > simd::Float(-1e-12f)) & (det < simd::Float(1e-12f));
+
+    const simd::Float invDet = simd::Float(1.f) / det;
+    const simd::Float sx = p0[0] - v0[0];
+    const simd::Float sy = p0[1] - v0[1];
+    const simd::Float sz = p0[2] - v0[2];
+    const simd::Float u = (sx * px + sy * py + sz * pz) * invDet;
+
+    const simd::Float qx = sy * e1[2] - sz * e1[1];
+    const simd::Float qy = sz * e1[0] - sx * e1[2];
+    const simd::Float qz = sx * e1[1] - sy * e1[0];
+    const simd::Float v = (dir[0] * qx + dir[1] * qy + dir[2] * qz) * invDet;
+    t = (e2[0] * qx + e2[1] * qy + e2[2] * qz) * invDet;
+
+    const simd::Mask miss = parallel | (u < simd::Float(0.f)) | (u > simd::Float(1.f)) | (v < simd::Float(0.f)) | (u + v > simd::Float(1.f)) | (t < simd::Float(0.f));
+
+    return simd::maskFromBits((1 << simd::width) - 1).andNot(miss);
+}
+
+//Values of the listed slots, lanes past the end of the list repeat its last slot
+inline simd::Float gather(const float* data, const int* slots, int lanes) {
+    alignas(32) float values[simd::width];
+    for (int lane = 0; lane < simd::width; ++lane) {
+        values[lane] = data[slots[std::min(lane, lanes - 1)]];
+    }
+    return simd::Float::load(values);
+}
+
+}
+
+TriangleBuffer::TriangleBuffer() {
+    resize(0);
+}
+
+TriangleBuffer::TriangleBuffer(const std::vector<Triangle>& scene) {
+    resize(static_cast<int>(scene.size()));
+    for (int i = 0; i < count; ++i) {
+        const std::array<Vertex, 3>& v = scene[i].getVertices();
+        setTriangle(i, v[0], v[1], v[2], scene[i].getColor(), i);
+        const std::array<TexCoord, 3>& uv = scene[i].getTexCoords();
+        setTexCoords(i, uv[0], uv[1], uv[2]);
+    }
+}
+
+TriangleBuffer::TriangleBuffer(int count, int stride, const float* attributes, const Color* colors, const int* ids, std::shared_ptr<const void> owner) :
+                                count(count), stride(stride), attributeData(attributes), colorData(colors), idData(ids), owner(std::move(owner)) {}
+
+TriangleBuffer::TriangleBuffer(const TriangleBuffer& other) :
+                                count(other.count), stride(other.stride), attributes(other.attributes), colors(other.colors), ids(other.ids),
+                                attributeData(other.attributeData), colorData(other.colorData), idData(other.idData), owner(other.owner) {
+    if (!owner) {
+        bindStorage();
+    }
+}
+
+TriangleBuffer& TriangleBuffer::operator=(const TriangleBuffer& other) {
+    if (this != &other) {
+        *this = TriangleBuffer(other);
+    }
+
+    return *this;
+}
+
+void TriangleBuffer::bindStorage() {
+    attributeData = attributes.data();
+    colorData = colors.data();
+    idData = ids.data();
+}
+
+//Copy on write for a buffer over external memory, the owner's copy is shared with other buffers and may be read-only
+void TriangleBuffer::makeWritable() {
+    if (!owner) {
+        return;
+    }
+    attributes.assign(attributeData, attributeData + static_cast<size_t>(AttributeCount) * stride);
+    colors.assign(colorData, colorData + stride);
+    ids.assign(idData, idData + stride);
+    owner.reset();
+    bindStorage();
+}
+
+void TriangleBuffer::resize(int count) {
+    this->count = count;
+    //The padding lets a full vector be loaded starting at the last slot, padded slots are degenerate and never hit
+    stride = (count + simd::width - 1) / simd::width * simd::width + simd::width;
+    attributes.assign(static_cast<size_t>(AttributeCount) * stride, 0.f);
+    colors.assign(stride, Color());
+    ids.assign(stride, INT_MAX);
+    owner.reset();
+    bindStorage();
+}
+
+void TriangleBuffer::setTriangle(int slot, const Vertex& v0, const Vertex& v1, const Vertex& v2, const Color& color, int id) {
+    makeWritable();
+    const glm::vec3 e1 = v1 - v0;
+    const glm::vec3 e2 = v2 - v0;
+    const glm::vec3 normal = glm::normalize(glm::cross(e1, e2));
+    const float values[TU0] = {v0.x, v0.y, v0.z, e1.x, e1.y, e1.z, e2.x, e2.y, e2.z, normal.x, normal.y, normal.z};
+    for (int a = 0; a < TU0; ++a) {
+        attributes[a * stride + slot] = values[a];
+    }
+    colors[slot] = color;
+    ids[slot] = id;
+}
+
+void TriangleBuffer::setTexCoords(int slot, const TexCoord& uv0, const TexCoord& uv1, const TexCoord& uv2) {
+    makeWritable();
+    const float values[] = {uv0.x, uv0.y, uv1.x, uv1.y, uv2.x, uv2.y};
+    for (int a = TU0; a < AttributeCount; ++a) {
+        attributes[a * stride + slot] = values[a - TU0];
+    }
+}
+
+void TriangleBuffer::setId(int slot, int id) {
+    makeWritable();
+    ids[slot] = id;
+}
+
+void TriangleBuffer::copySlot(int slot, const TriangleBuffer& source, int sourceSlot) {
+    makeWritable();
+    for (int a = 0; a < AttributeCount; ++a) {
+        attributes[a * stride + slot] = source.attributeData[a * source.stride + sourceSlot];
+    }
+    colors[slot] = source.colorData[sourceSlot];
+    ids[slot] = source.idData[sourceSlot];
+}
+
+TriangleBuffer TriangleBuffer::reordered(const std::vector<int>& order) const {
+    TriangleBuffer result;
+    result.resize(static_cast<int>(order.size()));
+    for (int i = 0; i < result.count; ++i) {
+        for (int a = 0; a < AttributeCount; ++a) {
+            result.attributes[a * result.stride + i] = attributeData[a * stride + order[i]];
+        }
+        result.colors[i] = colorData[order[i]];
+        result.ids[i] = idData[order[i]];
+    }
+
+    return result;
+}
+
+int TriangleBuffer::size() const {
+    return count;
+}
+
+Vertex TriangleBuffer::getVertex(int slot, int index) const {
+    Vertex v0(getAttribute(V0X)[slot], getAttribute(V0Y)[slot], getAttribute(V0Z)[slot]);
+    if (index == 1) {
+        return v0 + glm::vec3(getAttribute(E1X)[slot], getAttribute(E1Y)[slot], getAttribute(E1Z)[slot]);
+    }
+    if (index == 2) {
+        return v0 + glm::vec3(getAttribute(E2X)[slot], getAttribute(E2Y)[slot], getAttribute(E2Z)[slot]);
+    }
+
+    return v0;
+}
+
+glm::vec3 TriangleBuffer::getNormal(int slot) const {
+    return {getAttribute(NX)[slot], getAttribute(NY)[slot], getAttribute(NZ)[slot]};
+}
+
+TexCoord TriangleBuffer::getTexCoord(int slot, int index) const {
+    const Attribute u = static_cast<Attribute>(TU0 + 2 * index);
+    return {getAttribute(u)[slot], getAttribute(static_cast<Attribute>(u + 1))[slot]};
+}
+
+Color TriangleBuffer::getColor(int slot) const {
+    return colorData[slot];
+}
+
+int TriangleBuffer::getId(int slot) const {
+    return idData[slot];
+}
+
+int TriangleBuffer::getStride() const {
+    return stride;
+}
+
+const float* TriangleBuffer::getAttributeData() const {
+    return attributeData;
+}
+
+const Color* TriangleBuffer::getColorData() const {
+    return colorData;
+}
+
+const int* TriangleBuffer::getIdData() const {
+    return idData;
+}
+
+bool TriangleBuffer::intersect(const Ray& r, int first, int count, float& t, int& id) const {
+    const simd::Float p0[3] = {r.p0.x, r.p0.y, r.p0.z};
+    const simd::Float dir[3] = {r.dir.x, r.dir.y, r.dir.z};
+    const float* data[AttributeCount];
+    for (int a = 0; a < AttributeCount; ++a) {
+        data[a] = getAttribute(static_cast<Attribute>(a));
+    }
+
+    RT_STATS(getThreadCounters().triangleTests += count);
+    bool found = false;
+    for (int slot = first; slot < first + count; slot += simd::width) {
+        const simd::Float v0[3] = {simd::Float::load(data[V0X] + slot), simd::Float::load(data[V0Y] + slot), simd::Float::load(data[V0Z] + slot)};
+        const simd::Float e1[3] = {simd::Float::load(data[E1X] + slot), simd::Float::load(data[E1Y] + slot), simd::Float::load(data[E1Z] + slot)};
+        const simd::Float e2[3] = {simd::Float::load(data[E2X] + slot), simd::Float::load(data[E2Y] + slot), simd::Float::load(data[E2Z] + slot)};
+        simd::Float tTmp;
+        const simd::Mask hit = intersectLanes(p0, dir, v0, e1, e2, tTmp);
+        int hitBits = (hit & (tTmp <= simd::Float(t))).bits();
+        const int lanes = first + count - slot;
+        if (lanes < simd::width) {
+            hitBits &= (1 << lanes) - 1;
+        }
+        if (!hitBits) {
+            continue;
+        }
+
+        alignas(32) float tLanes[simd::width];
+        tTmp.store(tLanes);
+        while (hitBits) {
+            const int lane = simd::firstLane(hitBits);
+            hitBits &= hitBits - 1;
+            if (tLanes[lane] < t || (tLanes[lane] == t && idData[slot + lane] < id)) {
+                t = tLanes[lane];
+                id = idData[slot + lane];
+                found = true;
+            }
+        }
+    }
+
+    return found;
+}
+
+bool TriangleBuffer::occluded(const Ray& r, int first, int count, float tMax) const {
+    const simd::Float p0[3] = {r.p0.x, r.p0.y, r.p0.z};
+    const simd::Float dir[3] = {r.dir.x, r.dir.y, r.dir.z};
+    const float* data[AttributeCount];
+    for (int a = 0; a < AttributeCount; ++a) {
+        data[a] = getAttribute(static_cast<Attribute>(a));
+    }
+
+    for (int slot = first; slot < first + count; slot += simd::width) {
+        const simd::Float v0[3] = {simd::Float::load(data[V0X] + slot), simd::Float::load(data[V0Y] + slot), simd::Float::load(data[V0Z] + slot)};
+        const simd::Float e1[3] = {simd::Float::load(data[E1X] + slot), simd::Float::load(data[E1Y] + slot), simd::Float::load(data[E1Z] + slot)};
+        const simd::Float e2[3] = {simd::Float::load(data[E2X] + slot), simd::Float::load(data[E2Y] + slot), simd::Float::load(data[E2Z] + slot)};
+        simd::Float tTmp;
+        const simd::Mask hit = intersectLanes(p0, dir, v0, e1, e2, tTmp);
+        int hitBits = (hit & (tTmp < simd::Float(tMax))).bits();
+        const int lanes = first + count - slot;
+        if (lanes < simd::width) {
+            hitBits &= (1 << lanes) - 1;
+        }
+        RT_STATS(getThreadCounters().triangleTests += std::min(lanes, simd::width));
+        if (hitBits) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool TriangleBuffer::intersect(const Ray& r, const int* slots, int count, float& t, int& id) const {
+    const simd::Float p0[3] = {r.p0.x, r.p0.y, r.p0.z};
+    const simd::Float dir[3] = {r.dir.x, r.dir.y, r.dir.z};
+    const float* data[AttributeCount];
+    for (int a = 0; a < AttributeCount; ++a) {
+        data[a] = getAttribute(static_cast<Attribute>(a));
+    }
+
+    RT_STATS(getThreadCounters().triangleTests += count);
+    bool found = false;
+    for (int i = 0; i < count; i += simd::width) {
+        const int* slot = slots + i;
+        const int lanes = std::min(count - i, simd::width);
+        const simd::Float v0[3] = {gather(data[V0X], slot, lanes), gather(data[V0Y], slot, lanes), gather(data[V0Z], slot, lanes)};
+        const simd::Float e1[3] = {gather(data[E1X], slot, lanes), gather(data[E1Y], slot, lanes), gather(data[E1Z], slot, lanes)};
+        const simd::Float e2[3] = {gather(data[E2X], slot, lanes), gather(data[E2Y], slot, lanes), gather(data[E2Z], slot, lanes)};
+        simd::Float tTmp;
+        const simd::Mask hit = intersectLanes(p0, dir, v0, e1, e2, tTmp);
+        int hitBits = (hit & (tTmp <= simd::Float(t))).bits() & ((1 << lanes) - 1);
+        if (!hitBits) {
+            continue;
+        }
+
+        alignas(32) float tLanes[simd::width];
+        tTmp.store(tLanes);
+        while (hitBits) {
+            const int lane = simd::firstLane(hitBits);
+            hitBits &= hitBits - 1;
+            if (tLanes[lane] < t || (tLanes[lane] == t && idData[slot[lane]] < id)) {
+                t = tLanes[lane];
+                id = idData[slot[lane]];
+                found = true;
+            }
+        }
+    }
+
+    return found;
+}
+
+bool TriangleBuffer::occluded(const Ray& r, const int* slots, int count, float tMax) const {
+    const simd::Float p0[3] = {r.p0.x, r.p0.y, r.p0.z};
+    const simd::Float dir[3] = {r.dir.x, r.dir.y, r.dir.z};
+    const float* data[AttributeCount];
+    for (int a = 0; a < AttributeCount; ++a) {
+        data[a] = getAttribute(static_cast<Attribute>(a));
+    }
+
+    for (int i = 0; i < count; i += simd::width) {
+        const int* slot = slots + i;
+        const int lanes = std::min(count - i, simd::width);
+        const simd::Float v0[3] = {gather(data[V0X], slot, lanes), gather(data[V0Y], slot, lanes), gather(data[V0Z], slot, lanes)};
+        const simd::Float e1[3] = {gather(data[E1X], slot, lanes), gather(data[E1Y], slot, lanes), gather(data[E1Z], slot, lanes)};
+        const simd::Float e2[3] = {gather(data[E2X], slot, lanes), gather(data[E2Y], slot, lanes), gather(data[E2Z], slot, lanes)};
+        simd::Float tTmp;
+        const simd::Mask hit = intersectLanes(p0, dir, v0, e1, e2, tTmp);
+        RT_STATS(getThreadCounters().triangleTests += lanes);
+        if ((hit & (tTmp < simd::Float(tMax))).bits() & ((1 << lanes) - 1)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+simd::Mask TriangleBuffer::intersect(const SimdRay& r, int slot, const simd::Mask& active, simd::Float& t) const {
+    const simd::Float v0[3] = {getAttribute(V0X)[slot], getAttribute(V0Y)[slot], getAttribute(V0Z)[slot]};
+    const simd::Float e1[3] = {getAttribute(E1X)[slot], getAttribute(E1Y)[slot], getAttribute(E1Z)[slot]};
+    const simd::Float e2[3] = {getAttribute(E2X)[slot], getAttribute(E2Y)[slot], getAttribute(E2Z)[slot]};
+    //One test for every ray of the packet that is still looking
+    RT_STATS(getThreadCounters().triangleTests += simd::countLanes(active.bits()));
+
+    return intersectLanes(r.p0, r.dir, v0, e1, e2, t) & active;
+}
@@ -0,0 +1,93 @@
+//
+//  TriangleBuffer.hpp
+//  Test
+//
+//  Created by Erik Nouroyan on 17.10.26.
+//
+
+#ifndef TriangleBuffer_hpp
+#define TriangleBuffer_hpp
+
+#include <memory>
+#include <vector>
+#include "Ray.hpp"
+#include "Triangle.hpp"
+
+//Flattened triangles in structure-of-arrays form, the edges and normals are computed once when the buffer is built
+class TriangleBuffer {
+public:
+    enum Attribute {
+        V0X, V0Y, V0Z,
+        E1X, E1Y, E1Z,
+        E2X, E2Y, E2Z,
+        NX, NY, NZ,
+        //Texture coordinates of the three vertices, only shading reads them
+        TU0, TV0, TU1, TV1, TU2, TV2,
+        AttributeCount
+    };
+
+    TriangleBuffer();
+    explicit TriangleBuffer(const std::vector<Triangle>& scene);
+    //Buffer over memory laid out like getAttributeData(), getColorData() and getIdData(), the owner keeps it alive
+    //The memory is never written, the first setter call copies it into owned storage
+    TriangleBuffer(int count, int stride, const float* attributes, const Color* colors, const int* ids, std::shared_ptr<const void> owner);
+    TriangleBuffer(const TriangleBuffer& other);
+    TriangleBuffer(TriangleBuffer&& other) = default;
+    TriangleBuffer& operator=(const TriangleBuffer& other);
+    TriangleBuffer& operator=(TriangleBuffer&& other) = default;
+    //Allocates owned storage, a buffer over external memory becomes writable again
+    void resize(int count);
+    //Stores the triangle in the given slot with the id it is reported under
+    void setTriangle(int slot, const Vertex& v0, const Vertex& v1, const Vertex& v2, const Color& color, int id);
+    //Texture coordinates of the slot's vertices, they are (0, 0) until they are set
+    void setTexCoords(int slot, const TexCoord& uv0, const TexCoord& uv1, const TexCoord& uv2);
+    //Changes the id the slot's triangle is reported under
+    void setId(int slot, int id);
+    //Copies slot sourceSlot of source into the given slot
+    void copySlot(int slot, const TriangleBuffer& source, int sourceSlot);
+    //Copy with the slots permuted, slot i of the result is slot order[i] of this buffer
+    TriangleBuffer reordered(const std::vector<int>& order) const;
+
+    int size() const;
+    Vertex getVertex(int slot, int index) const;
+    glm::vec3 getNormal(int slot) const;
+    TexCoord getTexCoord(int slot, int index) const;
+    Color getColor(int slot) const;
+    int getId(int slot) const;
+    //Raw storage, AttributeCount arrays of getStride() floats followed by getStride() colors and ids
+    int getStride() const;
+    const float* getAttributeData() const;
+    const Color* getColorData() const;
+    const int* getIdData() const;
+
+    //Closest hit among slots [first, first + count) closer than t, ties are resolved to the smallest id
+    //Returns true when t and id were updated
+    bool intersect(const Ray& r, int first, int count, float& t, int& id) const;
+    //True as soon as any slot in [first, first + count) is hit before tMax
+    bool occluded(const Ray& r, int first, int count, float tMax) const;
+    //Same tests for a list of slots that need not be contiguous, simd::width of them are gathered per step
+    bool intersect(const Ray& r, const int* slots, int count, float& t, int& id) const;
+    bool occluded(const Ray& r, const int* slots, int count, float tMax) const;
+    //Tests one triangle against every active lane of a packet
+    simd::Mask intersect(const SimdRay& r, int slot, const simd::Mask& active, simd::Float& t) const;
+
+private:
+    int count;
+    int stride;
+    std::vector<float> attributes;
+    std::vector<Color> colors;
+    std::vector<int> ids;
+    //Point either at the vectors above or into the owner's memory
+    const float* attributeData;
+    const Color* colorData;
+    const int* idData;
+    std::shared_ptr<const void> owner;
+
+    void bindStorage();
+    void makeWritable();
+    const float* getAttribute(Attribute a) const {
+        return attributeData + a * stride;
+    }
+};
+
+#endif /* TriangleBuffer_hpp */
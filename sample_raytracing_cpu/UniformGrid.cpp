@@ -0,0 +1,311 @@
+//
+//  UniformGrid.cpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#include "UniformGrid.hpp"
+#include "RenderStats.hpp"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cmath>
+#include <memory>
+
+namespace {
+
+//Triangles per task of the build passes and cells per task of the prefix sum
+const int buildChunk = 4096;
+const int scanChunk = 65536;
+//Cells per axis, keeps a long thin scene from getting a huge grid along its long side
+const int maxResolution = 1024;
+const int mailboxSize = 32;
+const int pendingSize = 16 * simd::width;
+
+//Slots a ray has already tested, so that a triangle spanning several cells on its path is tested once
+//Direct mapped by the low bits of the slot, a slot pushed out by another one is just tested again
+struct Mailbox {
+    int slots[mailboxSize];
+
+    Mailbox() {
+        std::fill(slots, slots + mailboxSize, -1);
+    }
+
+    //Runs test(slots, count) on the cell's slots that were not tested yet, in batches, and stops at the first batch it returns true for
+    template <typename Test>
+    bool testNew(const int* cellSlots, int count, const Test& test) {
+        int pending[pendingSize];
+        int pendingCount = 0;
+        for (int i = 0; i < count; ++i) {
+            int& entry = slots[cellSlots[i] & (mailboxSize - 1)];
+            if (entry == cellSlots[i]) {
+                continue;
+            }
+            entry = cellSlots[i];
+            pending[pendingCount++] = cellSlots[i];
+            if (pendingCount == pendingSize) {
+                if (test(pending, pendingCount)) {
+                    return true;
+                }
+                pendingCount = 0;
+            }
+        }
+
+        return pendingCount > 0 && test(pending, pendingCount);
+    }
+};
+
+}
+
+UniformGrid::UniformGrid(const TriangleBuffer& triangles, ThreadPool& pool, float density) :
+                          triangles(triangles), resolution(0, 0, 0), cellSize(0.f), invCellSize(0.f) {
+    const int count = triangles.size();
+    const int chunks = (count + buildChunk - 1) / buildChunk;
+    std::vector<AABB> chunkBounds(chunks);
+    pool.parallelFor(chunks, [&](int chunk) {
+        for (int slot = chunk * buildChunk; slot < std::min(count, (chunk + 1) * buildChunk); ++slot) {
+            for (int k = 0; k < 3; ++k) {
+                chunkBounds[chunk].grow(triangles.getVertex(slot, k));
+            }
+        }
+    });
+    for (const AABB& box : chunkBounds) {
+        bounds.grow(box);
+    }
+    if (bounds.isEmpty()) {
+        return;
+    }
+
+    //A flat scene keeps a thin slab of cells, its short side is widened so that no cell is 0 wide
+    const glm::vec3 extent = bounds.max - bounds.min;
+    const float largest = std::max(extent.x, std::max(extent.y, extent.z));
+    glm::vec3 sides;
+    for (int axis = 0; axis < 3; ++axis) {
+        sides[axis] = std::max(extent[axis], std::max(largest, 1e-6f) * 1e-3f);
+        bounds.min[axis] -= 0.5f * (sides[axis] - extent[axis]);
+        bounds.max[axis] = bounds.min[axis] + sides[axis];
+    }
+    //Cubic cells, an axis too short for more than one of them drops out and the cells are spread over the others
+    const float targetCells = std::max(1.f, density * count);
+    bool single[3] = {false, false, false};
+    float cellsPerUnit = 0.f;
+    for (int pass = 0; pass < 3; ++pass) {
+        float volume = 1.f;
+        int dimensions = 0;
+        for (int axis = 0; axis < 3; ++axis) {
+            if (!single[axis]) {
+                volume *= sides[axis];
+                ++dimensions;
+            }
+        }
+        cellsPerUnit = std::pow(targetCells / volume, 1.f / dimensions);
+        bool changed = false;
+        for (int axis = 0; axis < 3; ++axis) {
+            if (!single[axis] && sides[axis] * cellsPerUnit < 1.f) {
+                single[axis] = true;
+                changed = true;
+            }
+        }
+        if (!changed) {
+            break;
+        }
+    }
+    for (int axis = 0; axis < 3; ++axis) {
+        resolution[axis] = std::max(1, std::min(maxResolution, static_cast<int>(sides[axis] * cellsPerUnit + 0.5f)));
+        cellSize[axis] = sides[axis] / resolution[axis];
+        invCellSize[axis] = resolution[axis] / sides[axis];
+    }
+    const int cellCount = resolution.x * resolution.y * resolution.z;
+
+    //Counting pass, every triangle adds itself to the cells its box overlaps
+    std::unique_ptr<std::atomic<int>[]> cursors(new std::atomic<int>[cellCount]());
+    pool.parallelFor(chunks, [&](int chunk) {
+        for (int slot = chunk * buildChunk; slot < std::min(count, (chunk + 1) * buildChunk); ++slot) {
+            int first[3];
+            int last[3];
+            getCellRange(slot, first, last);
+            for (int z = first[2]; z <= last[2]; ++z) {
+                for (int y = first[1]; y <= last[1]; ++y) {
+                    const int row = (z * resolution.y + y) * resolution.x;
+                    for (int x = first[0]; x <= last[0]; ++x) {
+                        cursors[row + x].fetch_add(1, std::memory_order_relaxed);
+                    }
+                }
+            }
+        }
+    });
+
+    //Exclusive prefix sum of the counts, each chunk of cells is summed on its own and then shifted by the chunks before it
+    cellStart.resize(cellCount + 1);
+    const int scanChunks = (cellCount + scanChunk - 1) / scanChunk;
+    std::vector<int> chunkOffsets(scanChunks);
+    pool.parallelFor(scanChunks, [&](int chunk) {
+        int sum = 0;
+        for (int cell = chunk * scanChunk; cell < std::min(cellCount, (chunk + 1) * scanChunk); ++cell) {
+            cellStart[cell] = sum;
+            sum += cursors[cell].load(std::memory_order_relaxed);
+        }
+        chunkOffsets[chunk] = sum;
+    });
+    int total = 0;
+    for (int& offset : chunkOffsets) {
+        const int sum = offset;
+        offset = total;
+        total += sum;
+    }
+    cellStart[cellCount] = total;
+    pool.parallelFor(scanChunks, [&](int chunk) {
+        for (int cell = chunk * scanChunk; cell < std::min(cellCount, (chunk + 1) * scanChunk); ++cell) {
+            cellStart[cell] += chunkOffsets[chunk];
+            cursors[cell].store(cellStart[cell], std::memory_order_relaxed);
+        }
+    });
+
+    //Filling pass over the same cells, the order inside a cell depends on the threads but ties are resolved by id
+    cellSlots.resize(total);
+    pool.parallelFor(chunks, [&](int chunk) {
+        for (int slot = chunk * buildChunk; slot < std::min(count, (chunk + 1) * buildChunk); ++slot) {
+            int first[3];
+            int last[3];
+            getCellRange(slot, first, last);
+            for (int z = first[2]; z <= last[2]; ++z) {
+                for (int y = first[1]; y <= last[1]; ++y) {
+                    const int row = (z * resolution.y + y) * resolution.x;
+                    for (int x = first[0]; x <= last[0]; ++x) {
+                        cellSlots[cursors[row + x].fetch_add(1, std::memory_order_relaxed)] = slot;
+                    }
+                }
+            }
+        }
+    });
+}
+
+void UniformGrid::getCellRange(int slot, int first[3], int last[3]) const {
+    AABB box;
+    for (int k = 0; k < 3; ++k) {
+        box.grow(triangles.getVertex(slot, k));
+    }
+    for (int axis = 0; axis < 3; ++axis) {
+        const float margin = 1e-4f * cellSize[axis];
+        first[axis] = std::max(0, std::min(resolution[axis] - 1, static_cast<int>((box.min[axis] - margin - bounds.min[axis]) * invCellSize[axis])));
+        last[axis] = std::max(0, std::min(resolution[axis] - 1, static_cast<int>((box.max[axis] + margin - bounds.min[axis]) * invCellSize[axis])));
+    }
+}
+
+int UniformGrid::getCellIndex(const int cell[3]) const {
+    return (cell[2] * resolution.y + cell[1]) * resolution.x + cell[0];
+}
+
+bool UniformGrid::startWalk(const Ray& r, float tMax, Walk& walk) const {
+    const glm::vec3 invDir = 1.f / r.dir;
+    float tEntry;
+    if (cellSlots.empty() || !bounds.intersects(r.p0, invDir, tMax, tEntry)) {
+        return false;
+    }
+
+    //Rounding may put the entry point just outside of the grid, its cell is clamped
+    const glm::vec3 entry = r.p0 + r.dir * tEntry;
+    for (int axis = 0; axis < 3; ++axis) {
+        walk.cell[axis] = std::max(0, std::min(resolution[axis] - 1, static_cast<int>((entry[axis] - bounds.min[axis]) * invCellSize[axis])));
+        if (r.dir[axis] > 0.f) {
+            walk.step[axis] = 1;
+            walk.tNext[axis] = (bounds.min[axis] + (walk.cell[axis] + 1) * cellSize[axis] - r.p0[axis]) * invDir[axis];
+            walk.tDelta[axis] = cellSize[axis] * invDir[axis];
+        }
+        else if (r.dir[axis] < 0.f) {
+            walk.step[axis] = -1;
+            walk.tNext[axis] = (bounds.min[axis] + walk.cell[axis] * cellSize[axis] - r.p0[axis]) * invDir[axis];
+            walk.tDelta[axis] = -cellSize[axis] * invDir[axis];
+        }
+        else {
+            walk.step[axis] = 0;
+            walk.tNext[axis] = MAXFLOAT;
+            walk.tDelta[axis] = 0.f;
+        }
+    }
+
+    return true;
+}
+
+bool UniformGrid::stepWalk(Walk& walk, float tMax) const {
+    //The next cell is behind the closest of the three boundaries
+    const int axis = walk.tNext[0] < walk.tNext[1] ? (walk.tNext[0] < walk.tNext[2] ? 0 : 2) : (walk.tNext[1] < walk.tNext[2] ? 1 : 2);
+    if (walk.tNext[axis] > tMax || walk.step[axis] == 0) {
+        return false;
+    }
+    walk.cell[axis] += walk.step[axis];
+    walk.tNext[axis] += walk.tDelta[axis];
+
+    return walk.cell[axis] >= 0 && walk.cell[axis] < resolution[axis];
+}
+
+int UniformGrid::intersect(const Ray& r, float& t, float tMax) const {
+    int minId = INT_MAX;
+    RT_STATS(++getThreadCounters().rays);
+    Walk walk;
+    if (!startWalk(r, tMax, walk)) {
+        return minId;
+    }
+
+    //A hit before the end of the current cell ends the walk, the cells after it only hold farther points
+    //Equal distances still step on so that ties resolve like the linear scan
+    float tBest = tMax;
+    Mailbox mailbox;
+    do {
+        RT_STATS(++getThreadCounters().nodeVisits);
+        const int cell = getCellIndex(walk.cell);
+        const int first = cellStart[cell];
+        mailbox.testNew(cellSlots.data() + first, cellStart[cell + 1] - first, [&](const int* slots, int count) {
+            triangles.intersect(r, slots, count, tBest, minId);
+            return false;
+        });
+    } while (stepWalk(walk, tBest));
+
+    if (minId != INT_MAX) {
+        t = tBest;
+        RT_STATS(++getThreadCounters().hits);
+    }
+
+    return minId;
+}
+
+bool UniformGrid::occluded(const Ray& r, float tMax) const {
+    RT_STATS(++getThreadCounters().rays);
+    Walk walk;
+    if (!startWalk(r, tMax, walk)) {
+        return false;
+    }
+
+    //Any blocker ends the search, it doesn't have to lie inside the current cell
+    Mailbox mailbox;
+    do {
+        RT_STATS(++getThreadCounters().nodeVisits);
+        const int cell = getCellIndex(walk.cell);
+        const int first = cellStart[cell];
+        if (mailbox.testNew(cellSlots.data() + first, cellStart[cell + 1] - first, [&](const int* slots, int count) {
+                return triangles.occluded(r, slots, count, tMax);
+            })) {
+            RT_STATS(++getThreadCounters().hits);
+            return true;
+        }
+    } while (stepWalk(walk, tMax));
+
+    return false;
+}
+
+const glm::ivec3& UniformGrid::getResolution() const {
+    return resolution;
+}
+
+size_t UniformGrid::getReferenceCount() const {
+    return cellSlots.size();
+}
+
+size_t UniformGrid::getMemorySize() const {
+    return (cellStart.size() + cellSlots.size()) * sizeof(int);
+}
+
+const TriangleBuffer& UniformGrid::getTriangles() const {
+    return triangles;
+}
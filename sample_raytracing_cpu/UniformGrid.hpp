@@ -0,0 +1,65 @@
+//
+//  UniformGrid.hpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#ifndef UniformGrid_hpp
+#define UniformGrid_hpp
+
+#include <vector>
+#include <glm/vec3.hpp>
+#include "AABB.hpp"
+#include "ThreadPool.hpp"
+#include "TriangleBuffer.hpp"
+
+//Scene bounds cut into equal cells, every cell lists the slots of the triangles whose boxes overlap it
+//Built with two passes over the triangles, one counting the references of every cell and one filling them in behind a prefix sum
+//of the counts, both split over the pool and linear in the number of triangles and cells
+//Rays walk the cells they pierce front to back (3D-DDA), a hit inside the current cell is closer than anything in the cells after it
+class UniformGrid {
+public:
+    //About density cells per triangle, spread over the axes in proportion to the sides of the scene bounds
+    //The grid refers to the triangles, the buffer has to outlive it
+    UniformGrid(const TriangleBuffer& triangles, ThreadPool& pool, float density = 4.f);
+
+    //Same results as BVH::intersect, the id of the closest triangle with ties resolved to the smallest id
+    int intersect(const Ray& r, float& t, float tMax = MAXFLOAT) const;
+    bool occluded(const Ray& r, float tMax) const;
+
+    const glm::ivec3& getResolution() const;
+    //Triangle references of all cells, a triangle is listed once per cell its box overlaps
+    size_t getReferenceCount() const;
+    //Bytes of the cell ranges and the reference lists
+    size_t getMemorySize() const;
+    const TriangleBuffer& getTriangles() const;
+
+private:
+    const TriangleBuffer& triangles;
+    AABB bounds;
+    glm::ivec3 resolution;
+    glm::vec3 cellSize;
+    glm::vec3 invCellSize;
+    //The slots of cell c are cellSlots[cellStart[c]] up to cellSlots[cellStart[c + 1]], cells are stored x first, then y, then z
+    std::vector<int> cellStart;
+    std::vector<int> cellSlots;
+
+    //Cells on the path of a ray, the walk ends once the ray leaves the grid or passes tMax
+    struct Walk {
+        int cell[3];
+        int step[3];
+        float tNext[3];
+        float tDelta[3];
+    };
+
+    //Range of cells the triangle's box overlaps, widened a little so that hits on a cell border are found from both sides
+    void getCellRange(int slot, int first[3], int last[3]) const;
+    int getCellIndex(const int cell[3]) const;
+    //False when the ray misses the grid before tMax
+    bool startWalk(const Ray& r, float tMax, Walk& walk) const;
+    //Moves to the next cell, false once the ray has left the grid or the next cell begins after tMax
+    bool stepWalk(Walk& walk, float tMax) const;
+};
+
+#endif /* UniformGrid_hpp */
@@ -0,0 +1,239 @@
+//
+//  WavefrontRenderer.cpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#include "WavefrontRenderer.hpp"
+#include <algorithm>
+#include <climits>
+
+namespace {
+
+const int chunkSize = 4096;
+//Cells per axis of the origin grid, a power of two
+const int gridResolution = 8;
+const int gridBits = 3;
+const int binCount = 8 * gridResolution * gridResolution * gridResolution;
+
+//Color a hit contributes before it is blended with what its reflection sees
+struct SampleColor {
+    int sample;
+    bool hit;
+    glm::vec3 color;
+};
+
+int getChunkCount(size_t count) {
+    return static_cast<int>((count + chunkSize - 1) / chunkSize);
+}
+
+//Spreads the low bits of x to every third bit
+int spreadBits(int x) {
+    int result = 0;
+    for (int bit = 0; bit < gridBits; ++bit) {
+        result |= ((x >> bit) & 1) << (3 * bit);
+    }
+
+    return result;
+}
+
+int getBin(const Ray& r, const glm::vec3& origin, const glm::vec3& cellScale) {
+    const int octant = (r.dir.x < 0.f) | (r.dir.y < 0.f) << 1 | (r.dir.z < 0.f) << 2;
+    int cell = 0;
+    for (int axis = 0; axis < 3; ++axis) {
+        const int c = std::max(0, std::min(gridResolution - 1, static_cast<int>((r.p0[axis] - origin[axis]) * cellScale[axis])));
+        cell |= spreadBits(c) << axis;
+    }
+
+    return octant * gridResolution * gridResolution * gridResolution + cell;
+}
+
+//Runs emit(index, rays) for every index in [0, count) on the pool and concatenates what the chunks emitted in index order
+template <typename Emit>
+std::vector<StreamRay> gatherRays(int count, ThreadPool& pool, const Emit& emit) {
+    std::vector<std::vector<StreamRay>> chunks(getChunkCount(count));
+    pool.parallelFor(static_cast<int>(chunks.size()), [&](int chunk) {
+        const int end = std::min(count, (chunk + 1) * chunkSize);
+        for (int i = chunk * chunkSize; i < end; ++i) {
+            emit(i, chunks[chunk]);
+        }
+    });
+
+    size_t total = 0;
+    for (const std::vector<StreamRay>& chunk : chunks) {
+        total += chunk.size();
+    }
+    std::vector<StreamRay> rays;
+    rays.reserve(total);
+    for (const std::vector<StreamRay>& chunk : chunks) {
+        rays.insert(rays.end(), chunk.begin(), chunk.end());
+    }
+
+    return rays;
+}
+
+}
+
+void binRays(std::vector<StreamRay>& rays, const AABB& bounds, ThreadPool& pool) {
+    const glm::vec3 extent = glm::max(bounds.max - bounds.min, glm::vec3(1e-6f));
+    const glm::vec3 cellScale = static_cast<float>(gridResolution) / extent;
+    const int count = static_cast<int>(rays.size());
+    const int chunkCount = getChunkCount(rays.size());
+
+    //Counting sort, every chunk counts its own rays and scatters them to its share of each bin
+    std::vector<int> bins(rays.size());
+    std::vector<int> offsets(static_cast<size_t>(chunkCount) * binCount, 0);
+    pool.parallelFor(chunkCount, [&](int chunk) {
+        int* counts = offsets.data() + static_cast<size_t>(chunk) * binCount;
+        const int end = std::min(count, (chunk + 1) * chunkSize);
+        for (int i = chunk * chunkSize; i < end; ++i) {
+            bins[i] = getBin(rays[i].ray, bounds.min, cellScale);
+            ++counts[bins[i]];
+        }
+    });
+    int offset = 0;
+    for (int bin = 0; bin < binCount; ++bin) {
+        for (int chunk = 0; chunk < chunkCount; ++chunk) {
+            int& slot = offsets[static_cast<size_t>(chunk) * binCount + bin];
+            const int binSize = slot;
+            slot = offset;
+            offset += binSize;
+        }
+    }
+
+    std::vector<StreamRay> sorted(rays.size());
+    pool.parallelFor(chunkCount, [&](int chunk) {
+        int* next = offsets.data() + static_cast<size_t>(chunk) * binCount;
+        const int end = std::min(count, (chunk + 1) * chunkSize);
+        for (int i = chunk * chunkSize; i < end; ++i) {
+            sorted[next[bins[i]]++] = rays[i];
+        }
+    });
+    rays.swap(sorted);
+}
+
+cv::Mat renderWavefront(const PerspectiveCamera& cam, const TriangleBuffer& triangles, const BVH& bvh, ThreadPool& pool,
+                        const RenderSettings& requested, bool binning) {
+    const int width = cam.getWidth();
+    const int height = cam.getHeight();
+    cv::Mat frame = cv::Mat::zeros(height, width, CV_8UC3);
+    if (bvh.getNodeCount() == 0) {
+        return frame;
+    }
+    const AABB& bounds = bvh.getNodes()[0].bounds;
+    const RayGenerator generator(cam, requested.samplesPerPixel);
+    const RenderSettings settings = withPixelAngle(requested, generator);
+    const int samples = generator.getSampleCount();
+    const int sampleCount = width * height * samples;
+    const bool reflective = settings.maxBounces > 0 && settings.reflectivity > 0.f;
+
+    //Primary rays are generated in pixel order, sample k of pixel (i, j) is entry (i * width + j) * samples + k
+    std::vector<StreamRay> wave = gatherRays(sampleCount, pool, [&](int sample, std::vector<StreamRay>& out) {
+        const int pixel = sample / samples;
+        const Ray ray = samples == 1 ? generator.getRay(pixel / width, pixel % width) : generator.getSample(pixel / width, pixel % width, sample % samples);
+        out.push_back({ray, MAXFLOAT, sample, 0.f});
+    });
+    //Own color of every hit of every wave, together with the sample it belongs to
+    std::vector<std::vector<SampleColor>> waveColors;
+
+    for (int bounce = 0; !wave.empty(); ++bounce) {
+        if (bounce > 0 && binning) {
+            binRays(wave, bounds, pool);
+        }
+        const int waveSize = static_cast<int>(wave.size());
+        std::vector<int> hits(waveSize);
+        std::vector<float> distances(waveSize, MAXFLOAT);
+        pool.parallelFor(getChunkCount(waveSize), [&](int chunk) {
+            const int end = std::min(waveSize, (chunk + 1) * chunkSize);
+            for (int i = chunk * chunkSize; i < end; ++i) {
+                hits[i] = bvh.intersect(wave[i].ray, distances[i], wave[i].tMax);
+            }
+        });
+
+        //The shadow rays of the wave point back at the hit they belong to
+        std::vector<char> blocked(waveSize, 0);
+        std::vector<StreamRay> shadowRays = gatherRays(waveSize, pool, [&](int i, std::vector<StreamRay>& out) {
+            StreamRay shadow = {{}, 0.f, i, 0.f};
+            if (hits[i] != INT_MAX && getShadowQuery(wave[i].ray, distances[i], hits[i], triangles, settings, shadow.ray, shadow.tMax)) {
+                out.push_back(shadow);
+            }
+        });
+        //The first wave and its shadow rays are coherent in pixel order, binning them only costs cache misses
+        if (bounce > 0 && binning) {
+            binRays(shadowRays, bounds, pool);
+        }
+        pool.parallelFor(getChunkCount(shadowRays.size()), [&](int chunk) {
+            const int end = std::min(static_cast<int>(shadowRays.size()), (chunk + 1) * chunkSize);
+            for (int i = chunk * chunkSize; i < end; ++i) {
+                blocked[shadowRays[i].sample] = bvh.occluded(shadowRays[i].ray, shadowRays[i].tMax);
+            }
+        });
+
+        const bool lastBounce = !reflective || bounce >= settings.maxBounces;
+        waveColors.emplace_back(waveSize);
+        std::vector<SampleColor>& locals = waveColors.back();
+        wave = gatherRays(waveSize, pool, [&](int i, std::vector<StreamRay>& out) {
+            const StreamRay& incoming = wave[i];
+            locals[i].sample = incoming.sample;
+            if (hits[i] == INT_MAX) {
+                locals[i].hit = false;
+                return;
+            }
+            const Color local = shadeWithShadow(incoming.ray, distances[i], hits[i], triangles, blocked[i], settings, incoming.pathLength);
+            locals[i] = {incoming.sample, true, glm::vec3(local[0], local[1], local[2])};
+            if (!lastBounce) {
+                glm::vec3 normal = triangles.getNormal(hits[i]);
+                if (glm::dot(normal, incoming.ray.dir) > 0.f) {
+                    normal = -normal;
+                }
+                const Ray reflected = constructReflectionRay(incoming.ray.p0 + incoming.ray.dir * distances[i], normal, incoming.ray.dir);
+                out.push_back({reflected, MAXFLOAT, incoming.sample, incoming.pathLength + distances[i]});
+            }
+        });
+    }
+
+    //The waves are blended from the last one back to the first, in the same nested order and with the same float operations as
+    //shadeReflective, so that both renderers round to the same colors
+    //A sample shows up in a wave only when it did in the one before, so colors holds what its reflected ray saw or 0 for a miss
+    std::vector<glm::vec3> colors(sampleCount, glm::vec3(0.f));
+    for (int bounce = static_cast<int>(waveColors.size()) - 1; bounce >= 0; --bounce) {
+        const std::vector<SampleColor>& locals = waveColors[bounce];
+        const bool lastBounce = !reflective || bounce >= settings.maxBounces;
+        pool.parallelFor(getChunkCount(locals.size()), [&](int chunk) {
+            const int end = std::min(static_cast<int>(locals.size()), (chunk + 1) * chunkSize);
+            for (int i = chunk * chunkSize; i < end; ++i) {
+                const SampleColor& local = locals[i];
+                glm::vec3& color = colors[local.sample];
+                if (!local.hit) {
+                    color = glm::vec3(0.f);
+                }
+                else if (lastBounce) {
+                    color = local.color;
+                }
+                else {
+                    color = local.color * (1.f - settings.reflectivity) + color * settings.reflectivity;
+                }
+            }
+        });
+    }
+
+    //Samples are rounded one by one and averaged like the tiled renderer does
+    pool.parallelFor(height, [&](int i) {
+        for (int j = 0; j < width; ++j) {
+            int sum[3] = {};
+            for (int s = 0; s < samples; ++s) {
+                const Color color = toColor(colors[(i * width + j) * samples + s]);
+                for (int c = 0; c < 3; ++c) {
+                    sum[c] += color[c];
+                }
+            }
+            Color& pixel = frame.at<cv::Vec3b>(i, j);
+            for (int c = 0; c < 3; ++c) {
+                pixel[c] = static_cast<unsigned char>((sum[c] + samples / 2) / samples);
+            }
+        }
+    });
+
+    return frame;
+}
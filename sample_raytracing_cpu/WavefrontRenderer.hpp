@@ -0,0 +1,33 @@
+//
+//  WavefrontRenderer.hpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#ifndef WavefrontRenderer_hpp
+#define WavefrontRenderer_hpp
+
+#include <vector>
+#include "RayTracer.hpp"
+
+//Ray of a wave, sample is where its result is scattered back to
+//pathLength is how far the sample travelled before the ray's origin, it widens the texture footprint of reflections
+struct StreamRay {
+    Ray ray;
+    float tMax;
+    int sample;
+    float pathLength;
+};
+
+//Reorders the rays by direction octant and then along a Morton curve over the cells of the box their origins are in
+//Rays that are traced one after another then start close to each other and walk the same nodes in the same order
+void binRays(std::vector<StreamRay>& rays, const AABB& bounds, ThreadPool& pool);
+
+//Renders the frame one wave at a time instead of one pixel at a time: all closest hits of a wave, then all of its shadow rays,
+//then the reflected rays as the next wave, the colors of the bounces are blended per sample once the last wave is done
+//binning can be turned off to measure what the reordering gains
+cv::Mat renderWavefront(const PerspectiveCamera& cam, const TriangleBuffer& triangles, const BVH& bvh, ThreadPool& pool,
+                        const RenderSettings& settings, bool binning = true);
+
+#endif /* WavefrontRenderer_hpp */
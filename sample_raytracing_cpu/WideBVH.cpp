@@ -0,0 +1,229 @@
+//
+//  WideBVH.cpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#include "WideBVH.hpp"
+#include "RenderStats.hpp"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+//Smallest power of two exponent that spreads the extent over 255 steps
+int getExponent(float extent) {
+    if (!(extent > 0.f)) {
+        return -126;
+    }
+    int exponent;
+    std::frexp(extent / 255.f, &exponent);
+
+    return std::max(-126, std::min(127, exponent));
+}
+
+//2^exponent built directly from the float bits, exponents are kept in the range of normal floats
+inline float getScale(int exponent) {
+    const uint32_t bits = static_cast<uint32_t>(exponent + 127) << 23;
+    float scale;
+    memcpy(&scale, &bits, sizeof(scale));
+
+    return scale;
+}
+
+}
+
+WideBVH::WideBVH(const BVH& bvh) : triangles(bvh.getTriangles()) {
+    if (bvh.getNodeCount() == 0) {
+        return;
+    }
+
+    //Every wide node has at least two children, so there are at most half as many as binary nodes
+    nodes.reserve(bvh.getNodeCount() / 2 + 1);
+    collapse(bvh.getNodes(), 0);
+}
+
+int WideBVH::collapse(const BVHNode* binaryNodes, int binaryIndex) {
+    const BVHNode& binary = binaryNodes[binaryIndex];
+
+    //Opens the largest interior child until the node is full, a leaf root becomes the only child of the root
+    std::vector<int> children;
+    if (binary.count > 0) {
+        children.push_back(binaryIndex);
+    }
+    else {
+        children.push_back(binary.leftFirst);
+        children.push_back(binary.leftFirst + 1);
+    }
+    while (static_cast<int>(children.size()) < simd::width) {
+        int largest = -1;
+        float largestArea = -1.f;
+        for (size_t k = 0; k < children.size(); ++k) {
+            const BVHNode& child = binaryNodes[children[k]];
+            if (child.count == 0 && child.bounds.getSurfaceArea() > largestArea) {
+                largest = static_cast<int>(k);
+                largestArea = child.bounds.getSurfaceArea();
+            }
+        }
+        if (largest == -1) {
+            break;
+        }
+        const int opened = binaryNodes[children[largest]].leftFirst;
+        children[largest] = opened;
+        children.push_back(opened + 1);
+    }
+
+    const int index = static_cast<int>(nodes.size());
+    nodes.emplace_back();
+    WideBVHNode node = {};
+    node.origin = binary.bounds.min;
+    node.childCount = static_cast<uint8_t>(children.size());
+    float scale[3];
+    for (int axis = 0; axis < 3; ++axis) {
+        node.exponent[axis] = static_cast<int8_t>(getExponent(binary.bounds.max[axis] - binary.bounds.min[axis]));
+        scale[axis] = getScale(node.exponent[axis]);
+    }
+    for (int k = 0; k < simd::width; ++k) {
+        if (k >= node.childCount) {
+            for (int axis = 0; axis < 3; ++axis) {
+                node.lower[axis][k] = 255;
+                node.upper[axis][k] = 0;
+            }
+            continue;
+        }
+        const BVHNode& child = binaryNodes[children[k]];
+        for (int axis = 0; axis < 3; ++axis) {
+            const float lower = std::floor((child.bounds.min[axis] - node.origin[axis]) / scale[axis]);
+            const float upper = std::ceil((child.bounds.max[axis] - node.origin[axis]) / scale[axis]);
+            node.lower[axis][k] = static_cast<uint8_t>(std::max(0.f, std::min(255.f, lower)));
+            node.upper[axis][k] = static_cast<uint8_t>(std::max(0.f, std::min(255.f, upper)));
+        }
+        node.count[k] = static_cast<uint16_t>(child.count);
+        node.child[k] = child.count > 0 ? child.leftFirst : -1;
+    }
+    //Children are collapsed after the node is stored, the vector may grow under them
+    for (int k = 0; k < node.childCount; ++k) {
+        if (node.count[k] == 0) {
+            node.child[k] = collapse(binaryNodes, children[k]);
+        }
+    }
+    nodes[index] = node;
+
+    return index;
+}
+
+int WideBVH::intersectChildren(const WideBVHNode& node, const glm::vec3& origin, const glm::vec3& invDir, float tMax, float* tEntry) const {
+    simd::Float tNear(0.f);
+    simd::Float tFar(tMax);
+    for (int axis = 0; axis < 3; ++axis) {
+        const simd::Float scale(getScale(node.exponent[axis]));
+        const simd::Float base(node.origin[axis] - origin[axis]);
+        const simd::Float inv(invDir[axis]);
+        const simd::Float t0 = (base + simd::Float::loadBytes(node.lower[axis]) * scale) * inv;
+        const simd::Float t1 = (base + simd::Float::loadBytes(node.upper[axis]) * scale) * inv;
+        //Keeping the running bound as the second operand lets NaN lanes fall back to it
+        tNear = simd::max(simd::min(t0, t1), tNear);
+        tFar = simd::min(simd::max(t0, t1), tFar);
+    }
+    tNear.store(tEntry);
+
+    return (tNear <= tFar).bits() & ((1 << node.childCount) - 1);
+}
+
+int WideBVH::intersect(const Ray& r, float& t, float tMax) const {
+    int minId = INT_MAX;
+    RT_STATS(++getThreadCounters().rays);
+    if (nodes.empty()) {
+        return minId;
+    }
+
+    //A wide node is never deeper than the binary node it was collapsed from, and leaves all but one child on the stack
+    struct StackEntry {
+        int child;
+        int count;
+        float tEntry;
+    };
+    StackEntry stack[BVH::maxDepth * simd::width];
+    int stackSize = 0;
+    stack[stackSize++] = {0, 0, 0.f};
+    const glm::vec3 invDir = 1.f / r.dir;
+    float tBest = tMax;
+    alignas(32) float tEntry[simd::width];
+
+    while (stackSize > 0) {
+        const StackEntry entry = stack[--stackSize];
+        //Equal distances are still visited so that ties resolve like the linear scan
+        if (entry.tEntry > tBest) {
+            continue;
+        }
+        if (entry.count > 0) {
+            triangles.intersect(r, entry.child, entry.count, tBest, minId);
+            continue;
+        }
+
+        //Hit children are inserted farthest first, so the nearest one is visited next
+        const WideBVHNode& node = nodes[entry.child];
+        RT_STATS(++getThreadCounters().nodeVisits);
+        int hits = intersectChildren(node, r.p0, invDir, tBest, tEntry);
+        const int first = stackSize;
+        while (hits) {
+            const int k = simd::firstLane(hits);
+            hits &= hits - 1;
+            int position = stackSize++;
+            for (; position > first && stack[position - 1].tEntry < tEntry[k]; --position) {
+                stack[position] = stack[position - 1];
+            }
+            stack[position] = {node.child[k], node.count[k], tEntry[k]};
+        }
+    }
+
+    if (minId != INT_MAX) {
+        t = tBest;
+        RT_STATS(++getThreadCounters().hits);
+    }
+
+    return minId;
+}
+
+bool WideBVH::occluded(const Ray& r, float tMax) const {
+    RT_STATS(++getThreadCounters().rays);
+    if (nodes.empty()) {
+        return false;
+    }
+
+    int stack[BVH::maxDepth * simd::width];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    const glm::vec3 invDir = 1.f / r.dir;
+    alignas(32) float tEntry[simd::width];
+    while (stackSize > 0) {
+        const WideBVHNode& node = nodes[stack[--stackSize]];
+        RT_STATS(++getThreadCounters().nodeVisits);
+        int hits = intersectChildren(node, r.p0, invDir, tMax, tEntry);
+        //Leaves are tested right away, any blocker ends the search
+        while (hits) {
+            const int k = simd::firstLane(hits);
+            hits &= hits - 1;
+            if (node.count[k] == 0) {
+                stack[stackSize++] = node.child[k];
+            }
+            else if (triangles.occluded(r, node.child[k], node.count[k], tMax)) {
+                RT_STATS(++getThreadCounters().hits);
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+const std::vector<WideBVHNode>& WideBVH::getNodes() const {
+    return nodes;
+}
+
+const TriangleBuffer& WideBVH::getTriangles() const {
+    return triangles;
+}
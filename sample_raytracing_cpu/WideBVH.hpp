@@ -0,0 +1,49 @@
+//
+//  WideBVH.hpp
+//  Test
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#ifndef WideBVH_hpp
+#define WideBVH_hpp
+
+#include <cstdint>
+#include <vector>
+#include "BVH.hpp"
+
+//simd::width children per node, their boxes quantized to 8 bits inside the node's own box
+//A child box is min = origin + lower * 2^exponent, max = origin + upper * 2^exponent per axis, always rounded outwards
+struct alignas(16) WideBVHNode {
+    glm::vec3 origin;
+    int8_t exponent[3];
+    uint8_t childCount;
+    uint8_t lower[3][simd::width];
+    uint8_t upper[3][simd::width];
+    int child[simd::width];      //Index of an interior child or the first slot of a leaf child
+    uint16_t count[simd::width]; //Number of triangles of a leaf child, 0 for interior children
+};
+
+//Collapses a binary BVH into wide nodes, all children of a node are tested at once against one ray
+class WideBVH {
+public:
+    //Keeps its own copy of the BVH's triangles, a cached BVH's buffer is shared instead
+    explicit WideBVH(const BVH& bvh);
+
+    //Same results as BVH::intersect, the id of the closest triangle with ties resolved to the smallest id
+    int intersect(const Ray& r, float& t, float tMax = MAXFLOAT) const;
+    bool occluded(const Ray& r, float tMax) const;
+
+    const std::vector<WideBVHNode>& getNodes() const;
+    const TriangleBuffer& getTriangles() const;
+
+private:
+    std::vector<WideBVHNode> nodes;
+    TriangleBuffer triangles;
+
+    int collapse(const BVHNode* binaryNodes, int binaryIndex);
+    //Mask of the children whose boxes the ray enters before tMax, with their entry distances
+    int intersectChildren(const WideBVHNode& node, const glm::vec3& origin, const glm::vec3& invDir, float tMax, float* tEntry) const;
+};
+
+#endif /* WideBVH_hpp */
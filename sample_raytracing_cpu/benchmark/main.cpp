@@ -0,0 +1,870 @@
+//
+//  main.cpp
+//  Benchmark
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../RayTracer.hpp"
+#include "../FrameStats.hpp"
+#include "../Texture.hpp"
+#include "../Denoiser.hpp"
+#include "../TemporalRenderer.hpp"
+#include "../WavefrontRenderer.hpp"
+#include "../CameraPath.hpp"
+#include "../SceneGenerator.hpp"
+
+//Headless primary ray benchmark, prints one JSON document with a result per scene, resolution and traversal mode
+//Options: --threads N, --repeats N, --max-triangles N, --animation-frames N, --reference-samples N, --bounces N, --texture-size N, --denoise-passes N, --temporal-frames N, --batch-views N, --out path
+
+namespace {
+
+struct Resolution {
+    int width;
+    int height;
+};
+
+//Binary BVH traced with single rays or packets, the wide BVH collapsed from it, rasterized primary hits or the uniform grid
+enum class Mode {
+    Single,
+    Packet,
+    Wide,
+    Hybrid,
+    Grid
+};
+
+struct Result {
+    int triangleCount;
+    uint32_t seed;
+    Resolution resolution;
+    Mode mode;
+    double buildSeconds;
+    double nodeBytesPerTriangle;
+    double frameSeconds;
+    TraversalCounters counters;
+};
+
+//Per frame averages of the animated scene, every frame is brought up to date once with BVH::update and once with a full build
+struct AnimationResult {
+    int triangleCount;
+    int frameCount;
+    int refitFrames;
+    int partialRebuildFrames;
+    int fullRebuildFrames;
+    double updateSeconds;
+    double rebuildSeconds;
+    double updatedFrameSeconds;
+    double rebuiltFrameSeconds;
+    double updatedCost;
+    double rebuiltCost;
+};
+
+//The sampling comparison renders one small view, the reference takes many samples per pixel
+const SceneSpec samplingScene = {1000, 1000};
+const Resolution samplingResolution = {320, 240};
+
+//Image error of a sampling mode against a uniformly supersampled reference of the same view
+struct SamplingResult {
+    bool adaptive;
+    int samples;
+    double raysPerPixel;
+    double rmse;
+    double frameSeconds;
+};
+
+//The secondary ray comparison renders reflections off half mirrors in a dense scene
+const SceneSpec secondaryScene = {100000, 100000};
+const Resolution secondaryResolution = {800, 600};
+
+//The tiled renderer follows every pixel's reflections right away, the wavefront one traces them in waves, with and without binning
+enum class SecondaryMode {
+    Tiled,
+    Wavefront,
+    BinnedWavefront
+};
+
+//The wavefront renderers blend the bounces in the tiled renderer's order, differingPixels has to be 0
+struct SecondaryResult {
+    SecondaryMode mode;
+    double frameSeconds;
+    int differingPixels;
+};
+
+//The texture comparison looks across a floor that repeats one large texture, from texels bigger than a pixel up close to many texels per pixel far away
+const Resolution textureResolution = {800, 600};
+
+struct TextureResult {
+    bool mipmaps;
+    Texture::Layout layout;
+    double frameSeconds;
+};
+
+//The denoiser filters low sample frames of the sampling scene, their error is measured against a frame with denoiseReferenceSamples per pixel
+const Resolution denoiseResolution = {800, 600};
+const int denoiseReferenceSamples = 64;
+
+struct DenoiseResult {
+    int samples;
+    bool denoised;
+    double rmse;
+    //The filtered frames are rendered with their features
+    double frameSeconds;
+    //Zero for the frames that are not filtered
+    double denoiseSeconds;
+};
+
+//The temporal comparison moves the camera a little every frame, like an interactive orbit, and renders each frame in full and with reprojection
+const SceneSpec temporalScene = {100000, 100000};
+const Resolution temporalResolution = {800, 600};
+const int temporalReferenceSamples = 16;
+
+struct TemporalResult {
+    int frameCount;
+    //Means over the frames after the first, the first one is traced in full by both
+    double fullFrameSeconds;
+    double temporalFrameSeconds;
+    double reusedFraction;
+    double tracedFraction;
+    double refreshedFraction;
+    //Against the full frame, and both against a supersampled reference of the last frame, which shows how much of it is 1 sample aliasing
+    double rmse;
+    double fullReferenceRMSE;
+    double temporalReferenceRMSE;
+};
+
+//The batch comparison renders many small views around one scene, like a dataset, one rayTracing call per view against one batch
+const SceneSpec batchScene = {100000, 100000};
+const Resolution batchResolution = {256, 256};
+
+struct BatchResult {
+    int viewCount;
+    double separateSeconds;
+    double batchSeconds;
+};
+
+//Frame time of one render, the traversal counters are filled only when stats is given
+double renderFrame(const PerspectiveCamera& cam, const TriangleBuffer& triangles, const BVH& bvh, ThreadPool& pool, const RenderSettings& settings, FrameStats* stats = nullptr) {
+    const auto start = std::chrono::steady_clock::now();
+    rayTracing(cam, triangles, &bvh, pool, settings, nullptr, stats);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    return elapsed.count();
+}
+
+double renderFrame(const PerspectiveCamera& cam, const TriangleBuffer& triangles, const WideBVH& bvh, ThreadPool& pool, const RenderSettings& settings, FrameStats* stats = nullptr) {
+    const auto start = std::chrono::steady_clock::now();
+    rayTracing(cam, triangles, bvh, pool, settings, stats);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    return elapsed.count();
+}
+
+double renderFrame(const PerspectiveCamera& cam, const TriangleBuffer& triangles, const UniformGrid& grid, ThreadPool& pool, const RenderSettings& settings, FrameStats* stats = nullptr) {
+    const auto start = std::chrono::steady_clock::now();
+    rayTracing(cam, triangles, grid, pool, settings, stats);
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    return elapsed.count();
+}
+
+const char* getModeName(Mode mode) {
+    switch (mode) {
+        case Mode::Single:
+            return "single";
+        case Mode::Packet:
+            return "packet";
+        case Mode::Wide:
+            return "wide";
+        case Mode::Hybrid:
+            return "hybrid";
+        default:
+            return "grid";
+    }
+}
+
+//Every triangle drifts along its own direction and the whole scene sways, so the BVH slowly loses quality
+void animateScene(const TriangleBuffer& base, const std::vector<glm::vec3>& velocities, int frame, ThreadPool& pool, TriangleBuffer& animated) {
+    const float sway = 0.5f * std::sin(0.2f * frame);
+    const int chunkSize = 4096;
+    pool.parallelFor((base.size() + chunkSize - 1) / chunkSize, [&](int chunk) {
+        const int end = std::min(base.size(), (chunk + 1) * chunkSize);
+        for (int i = chunk * chunkSize; i < end; ++i) {
+            const glm::vec3 offset = velocities[i] * static_cast<float>(frame) + glm::vec3(sway, 0.f, 0.f);
+            animated.setTriangle(i, base.getVertex(i, 0) + offset, base.getVertex(i, 1) + offset, base.getVertex(i, 2) + offset, base.getColor(i), base.getId(i));
+        }
+    });
+}
+
+AnimationResult benchmarkAnimation(const SceneSpec& spec, int frameCount, ThreadPool& pool) {
+    const TriangleBuffer base = generateScene(spec);
+    std::mt19937 rng(spec.seed);
+    std::vector<glm::vec3> velocities(base.size());
+    for (glm::vec3& velocity : velocities) {
+        velocity = glm::vec3(nextUnit(rng) - 0.5f, nextUnit(rng) - 0.5f, nextUnit(rng) - 0.5f) * 0.04f;
+    }
+
+    const PerspectiveCamera cam(glm::vec3(0.f, 0.f, 1.f), glm::vec3(0.f, 0.f, -1.f), glm::vec3(0.f, 1.f, 0.f), 90.f, 800, 600);
+    RenderSettings settings;
+    settings.usePackets = true;
+    TriangleBuffer animated = base;
+    BVH updated(base, pool);
+    AnimationResult result = {spec.triangleCount, frameCount, 0, 0, 0, 0., 0., 0., 0., 0., 0.};
+    for (int frame = 1; frame <= frameCount; ++frame) {
+        animateScene(base, velocities, frame, pool, animated);
+
+        auto start = std::chrono::steady_clock::now();
+        const BVHUpdate kind = updated.update(animated, pool);
+        const std::chrono::duration<double> updateTime = std::chrono::steady_clock::now() - start;
+        start = std::chrono::steady_clock::now();
+        const BVH rebuilt(animated, pool);
+        const std::chrono::duration<double> rebuildTime = std::chrono::steady_clock::now() - start;
+
+        result.refitFrames += kind == BVHUpdate::Refit;
+        result.partialRebuildFrames += kind == BVHUpdate::PartialRebuild;
+        result.fullRebuildFrames += kind == BVHUpdate::FullRebuild;
+        result.updateSeconds += updateTime.count() / frameCount;
+        result.rebuildSeconds += rebuildTime.count() / frameCount;
+        result.updatedFrameSeconds += renderFrame(cam, updated.getTriangles(), updated, pool, settings) / frameCount;
+        result.rebuiltFrameSeconds += renderFrame(cam, rebuilt.getTriangles(), rebuilt, pool, settings) / frameCount;
+        result.updatedCost += updated.getCost() / frameCount;
+        result.rebuiltCost += rebuilt.getCost() / frameCount;
+    }
+
+    return result;
+}
+
+//Uniform supersampling at several rates against adaptive sampling, errors are measured in 0-255 color units
+std::vector<SamplingResult> benchmarkSampling(int referenceSamples, ThreadPool& pool) {
+    const TriangleBuffer triangles = generateScene(samplingScene);
+    const BVH bvh(triangles, pool);
+    const PerspectiveCamera cam(glm::vec3(0.f, 0.f, 1.f), glm::vec3(0.f, 0.f, -1.f), glm::vec3(0.f, 1.f, 0.f), 90.f, samplingResolution.width, samplingResolution.height);
+    RenderSettings settings;
+    settings.shading = true;
+    settings.samplesPerPixel = referenceSamples;
+    const cv::Mat reference = rayTracing(cam, triangles, &bvh, pool, settings);
+
+    auto measure = [&](const RenderSettings& settings, int samples) {
+        cv::Mat sampleCounts;
+        const auto start = std::chrono::steady_clock::now();
+        const cv::Mat frame = rayTracing(cam, triangles, &bvh, pool, settings, &sampleCounts);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        double squaredError = 0.;
+        long long rays = 0;
+        for (int i = 0; i < frame.rows; ++i) {
+            for (int j = 0; j < frame.cols; ++j) {
+                for (int c = 0; c < 3; ++c) {
+                    const double difference = frame.at<cv::Vec3b>(i, j)[c] - reference.at<cv::Vec3b>(i, j)[c];
+                    squaredError += difference * difference;
+                }
+                rays += sampleCounts.at<int>(i, j);
+            }
+        }
+        const double pixels = static_cast<double>(frame.rows) * frame.cols;
+
+        return SamplingResult {settings.adaptive.enabled, samples, rays / pixels, std::sqrt(squaredError / (3 * pixels)), elapsed.count()};
+    };
+
+    std::vector<SamplingResult> results;
+    for (int samples : {1, 4, 16, 64}) {
+        settings.samplesPerPixel = samples;
+        results.push_back(measure(settings, samples));
+    }
+    settings.adaptive.enabled = true;
+    results.push_back(measure(settings, settings.adaptive.maxSamples));
+
+    return results;
+}
+
+const char* getSecondaryModeName(SecondaryMode mode) {
+    switch (mode) {
+        case SecondaryMode::Tiled:
+            return "tiled";
+        case SecondaryMode::Wavefront:
+            return "wavefront";
+        case SecondaryMode::BinnedWavefront:
+            return "binnedWavefront";
+    }
+
+    return "";
+}
+
+//Median frame time of every mode with shading, shadows and bounceCount reflections
+std::vector<SecondaryResult> benchmarkSecondary(int bounceCount, int repeats, ThreadPool& pool) {
+    const TriangleBuffer triangles = generateScene(secondaryScene);
+    const BVH bvh(triangles, pool);
+    const PerspectiveCamera cam(glm::vec3(0.f, 0.f, 1.f), glm::vec3(0.f, 0.f, -1.f), glm::vec3(0.f, 1.f, 0.f), 90.f, secondaryResolution.width, secondaryResolution.height);
+    RenderSettings settings;
+    settings.shading = true;
+    settings.maxBounces = bounceCount;
+    settings.reflectivity = 0.5f;
+
+    std::vector<SecondaryResult> results;
+    cv::Mat tiled;
+    for (SecondaryMode mode : {SecondaryMode::Tiled, SecondaryMode::Wavefront, SecondaryMode::BinnedWavefront}) {
+        cv::Mat frame;
+        auto render = [&]() {
+            const auto start = std::chrono::steady_clock::now();
+            if (mode == SecondaryMode::Tiled) {
+                frame = rayTracing(cam, triangles, &bvh, pool, settings);
+            }
+            else {
+                frame = renderWavefront(cam, triangles, bvh, pool, settings, mode == SecondaryMode::BinnedWavefront);
+            }
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            return elapsed.count();
+        };
+        render();
+        if (mode == SecondaryMode::Tiled) {
+            tiled = frame;
+        }
+        int differingPixels = 0;
+        for (int i = 0; i < frame.rows; ++i) {
+            for (int j = 0; j < frame.cols; ++j) {
+                differingPixels += frame.at<cv::Vec3b>(i, j) != tiled.at<cv::Vec3b>(i, j);
+            }
+        }
+        std::vector<double> times;
+        for (int r = 0; r < repeats; ++r) {
+            times.push_back(render());
+        }
+        std::sort(times.begin(), times.end());
+        results.push_back({mode, times[times.size() / 2], differingPixels});
+    }
+
+    return results;
+}
+
+//Checkerboard with noisy blue, every texel differs from its neighbours so that no layout gets away with cached repeats
+cv::Mat generateTexture(int size) {
+    std::mt19937 rng(size);
+    cv::Mat image(size, size, CV_8UC3);
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            const unsigned char value = ((x / 8 + y / 8) & 1) ? 230 : 40;
+            image.at<Color>(y, x) = Color(static_cast<unsigned char>(128 + (rng() >> 25)), value, value);
+        }
+    }
+
+    return image;
+}
+
+//Median frame time of the textured floor with and without mipmaps, tiled and row by row, shading is off so the lookups dominate
+std::vector<TextureResult> benchmarkTexture(int textureSize, int repeats, ThreadPool& pool) {
+    const float extent = 200.f;
+    std::vector<Triangle> floor = {
+        Triangle({{-extent, -1.f, extent}, {extent, -1.f, extent}, {extent, -1.f, -extent}}, Color(255, 255, 255)),
+        Triangle({{-extent, -1.f, extent}, {extent, -1.f, -extent}, {-extent, -1.f, -extent}}, Color(255, 255, 255))
+    };
+    const float repeat = 16.f;
+    floor[0].setTexCoords({{0.f, 0.f}, {repeat, 0.f}, {repeat, repeat}});
+    floor[1].setTexCoords({{0.f, 0.f}, {repeat, repeat}, {0.f, repeat}});
+    const TriangleBuffer triangles(floor);
+    const BVH bvh(triangles, pool);
+    const PerspectiveCamera cam(glm::vec3(0.f, 0.f, 0.f), glm::vec3(0.3f, -0.2f, -1.f), glm::vec3(0.f, 1.f, 0.f), 90.f, textureResolution.width, textureResolution.height);
+    const cv::Mat image = generateTexture(textureSize);
+
+    std::vector<TextureResult> results;
+    for (bool mipmaps : {false, true}) {
+        for (Texture::Layout layout : {Texture::Layout::Linear, Texture::Layout::Tiled}) {
+            const Texture texture(image, mipmaps, layout);
+            RenderSettings settings;
+            settings.texture = &texture;
+            auto render = [&]() {
+                const auto start = std::chrono::steady_clock::now();
+                rayTracing(cam, triangles, &bvh, pool, settings);
+                const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+                return elapsed.count();
+            };
+            render();
+            std::vector<double> times;
+            for (int r = 0; r < repeats; ++r) {
+                times.push_back(render());
+            }
+            std::sort(times.begin(), times.end());
+            results.push_back({mipmaps, layout, times[times.size() / 2]});
+        }
+    }
+
+    return results;
+}
+
+double getRMSE(const cv::Mat& frame, const cv::Mat& reference) {
+    double squaredError = 0.;
+    for (int i = 0; i < frame.rows; ++i) {
+        for (int j = 0; j < frame.cols; ++j) {
+            for (int c = 0; c < 3; ++c) {
+                const double difference = frame.at<cv::Vec3b>(i, j)[c] - reference.at<cv::Vec3b>(i, j)[c];
+                squaredError += difference * difference;
+            }
+        }
+    }
+
+    return std::sqrt(squaredError / (3. * frame.rows * frame.cols));
+}
+
+//1 and 4 samples per pixel with and without the filter, median times, the reference frame's time is what the filter has to beat
+std::vector<DenoiseResult> benchmarkDenoise(int passes, int repeats, ThreadPool& pool, double& referenceSeconds) {
+    const TriangleBuffer triangles = generateScene(samplingScene);
+    const BVH bvh(triangles, pool);
+    const PerspectiveCamera cam(glm::vec3(0.f, 0.f, 1.f), glm::vec3(0.f, 0.f, -1.f), glm::vec3(0.f, 1.f, 0.f), 90.f, denoiseResolution.width, denoiseResolution.height);
+    RenderSettings settings;
+    settings.shading = true;
+    DenoiseSettings denoiseSettings;
+    denoiseSettings.passes = passes;
+
+    auto median = [&](const std::function<void()>& work) {
+        work();
+        std::vector<double> times;
+        for (int r = 0; r < repeats; ++r) {
+            const auto start = std::chrono::steady_clock::now();
+            work();
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            times.push_back(elapsed.count());
+        }
+        std::sort(times.begin(), times.end());
+        return times[times.size() / 2];
+    };
+
+    settings.samplesPerPixel = denoiseReferenceSamples;
+    cv::Mat reference;
+    referenceSeconds = median([&]() { reference = rayTracing(cam, triangles, &bvh, pool, settings); });
+
+    std::vector<DenoiseResult> results;
+    for (int samples : {1, 4}) {
+        settings.samplesPerPixel = samples;
+        cv::Mat frame;
+        const double frameSeconds = median([&]() { frame = rayTracing(cam, triangles, &bvh, pool, settings); });
+        results.push_back({samples, false, getRMSE(frame, reference), frameSeconds, 0.});
+
+        FeatureBuffers features;
+        const double featureFrameSeconds = median([&]() { frame = rayTracing(cam, triangles, &bvh, pool, settings, nullptr, nullptr, &features); });
+        cv::Mat denoised;
+        const double denoiseSeconds = median([&]() { denoised = denoise(frame, features, cam, pool, denoiseSettings); });
+        results.push_back({samples, true, getRMSE(denoised, reference), featureFrameSeconds, denoiseSeconds});
+    }
+
+    return results;
+}
+
+PerspectiveCamera getTemporalCamera(int frame) {
+    return PerspectiveCamera(glm::vec3(0.01f * frame, 0.005f * frame, 1.f - 0.01f * frame), glm::vec3(0.004f * frame, 0.f, -1.f), glm::vec3(0.f, 1.f, 0.f), 90.f,
+                             temporalResolution.width, temporalResolution.height);
+}
+
+TemporalResult benchmarkTemporal(int frameCount, ThreadPool& pool) {
+    const TriangleBuffer triangles = generateScene(temporalScene);
+    const BVH bvh(triangles, pool);
+    RenderSettings settings;
+    settings.shading = true;
+    TemporalRenderer renderer(triangles, bvh, pool, settings);
+    TemporalResult result = {frameCount, 0., 0., 0., 0., 0., 0., 0., 0.};
+    const double pixels = static_cast<double>(temporalResolution.width) * temporalResolution.height;
+    const int timedFrames = std::max(1, frameCount - 1);
+    cv::Mat full;
+    cv::Mat temporal;
+    for (int frame = 0; frame < frameCount; ++frame) {
+        const PerspectiveCamera cam = getTemporalCamera(frame);
+        auto start = std::chrono::steady_clock::now();
+        full = rayTracing(cam, triangles, &bvh, pool, settings);
+        const std::chrono::duration<double> fullTime = std::chrono::steady_clock::now() - start;
+        start = std::chrono::steady_clock::now();
+        temporal = renderer.render(cam);
+        const std::chrono::duration<double> temporalTime = std::chrono::steady_clock::now() - start;
+        if (frame == 0) {
+            continue;
+        }
+        const TemporalFrameStats& stats = renderer.getLastStats();
+        result.fullFrameSeconds += fullTime.count() / timedFrames;
+        result.temporalFrameSeconds += temporalTime.count() / timedFrames;
+        result.reusedFraction += stats.reusedPixels / pixels / timedFrames;
+        result.tracedFraction += stats.tracedPixels / pixels / timedFrames;
+        result.refreshedFraction += stats.refreshedPixels / pixels / timedFrames;
+        result.rmse += getRMSE(temporal, full) / timedFrames;
+    }
+
+    settings.samplesPerPixel = temporalReferenceSamples;
+    const cv::Mat reference = rayTracing(getTemporalCamera(frameCount - 1), triangles, &bvh, pool, settings);
+    result.fullReferenceRMSE = getRMSE(full, reference);
+    result.temporalReferenceRMSE = getRMSE(temporal, reference);
+
+    return result;
+}
+
+//Each way is timed after a warm-up run, the views circle the scene
+BatchResult benchmarkBatch(int viewCount, ThreadPool& pool) {
+    const TriangleBuffer triangles = generateScene(batchScene);
+    const BVH bvh(triangles, pool);
+    const std::vector<PerspectiveCamera> cameras = getOrbitPath(bvh.getNodes()[0].bounds, viewCount, batchResolution.width, batchResolution.height);
+    RenderSettings settings;
+    settings.shading = true;
+
+    auto renderSeparate = [&]() {
+        const auto start = std::chrono::steady_clock::now();
+        for (const PerspectiveCamera& cam : cameras) {
+            rayTracing(cam, triangles, &bvh, pool, settings);
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count();
+    };
+    auto renderBatch = [&]() {
+        const auto start = std::chrono::steady_clock::now();
+        rayTracingBatch(cameras, triangles, bvh, pool, settings, [](int, const cv::Mat&) {});
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count();
+    };
+    renderSeparate();
+    const double separateSeconds = renderSeparate();
+    renderBatch();
+    const double batchSeconds = renderBatch();
+
+    return BatchResult {viewCount, separateSeconds, batchSeconds};
+}
+
+std::string toJSON(const std::vector<Result>& results, const AnimationResult* animation, const std::vector<SamplingResult>& sampling, int referenceSamples,
+                   const std::vector<SecondaryResult>& secondary, int bounceCount, const std::vector<TextureResult>& texture, int textureSize,
+                   const std::vector<DenoiseResult>& denoise, int denoisePasses, double denoiseReferenceSeconds, const TemporalResult* temporal,
+                   const BatchResult* batch, int threadCount, int repeats) {
+    std::ostringstream out;
+    out.precision(9);
+    out << "{\n";
+    out << "  \"simdWidth\": " << simd::width << ",\n";
+    out << "  \"threads\": " << threadCount << ",\n";
+    out << "  \"repeats\": " << repeats << ",\n";
+    out << "  \"statsEnabled\": " << (statsEnabled ? "true" : "false") << ",\n";
+    out << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        const double rays = static_cast<double>(r.resolution.width) * r.resolution.height;
+        out << "    {\"triangles\": " << r.triangleCount << ", \"seed\": " << r.seed
+            << ", \"width\": " << r.resolution.width << ", \"height\": " << r.resolution.height
+            << ", \"mode\": \"" << getModeName(r.mode) << "\""
+            << ", \"bvhBuildSeconds\": " << r.buildSeconds
+            << ", \"nodeBytesPerTriangle\": " << r.nodeBytesPerTriangle
+            << ", \"frameSeconds\": " << r.frameSeconds
+            << ", \"raysPerSecond\": " << rays / r.frameSeconds
+            << ", \"nsPerRay\": " << r.frameSeconds * 1e9 / rays
+            << ", \"triangleTestsPerRay\": ";
+        //Primary rays only, shading is off
+        if (statsEnabled) {
+            out << r.counters.triangleTests / rays << ", \"nodeVisitsPerRay\": " << r.counters.nodeVisits / rays << ", \"hitRate\": " << r.counters.hits / rays;
+        }
+        else {
+            out << "null, \"nodeVisitsPerRay\": null, \"hitRate\": null";
+        }
+        out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ],\n";
+    out << "  \"animation\": ";
+    if (animation) {
+        const AnimationResult& a = *animation;
+        out << "{\"triangles\": " << a.triangleCount << ", \"frames\": " << a.frameCount
+            << ", \"refitFrames\": " << a.refitFrames << ", \"partialRebuildFrames\": " << a.partialRebuildFrames << ", \"fullRebuildFrames\": " << a.fullRebuildFrames
+            << ", \"updateSeconds\": " << a.updateSeconds << ", \"fullBuildSeconds\": " << a.rebuildSeconds
+            << ", \"updatedFrameSeconds\": " << a.updatedFrameSeconds << ", \"rebuiltFrameSeconds\": " << a.rebuiltFrameSeconds
+            << ", \"updatedSAHCost\": " << a.updatedCost << ", \"rebuiltSAHCost\": " << a.rebuiltCost << "},\n";
+    }
+    else {
+        out << "null,\n";
+    }
+    out << "  \"sampling\": ";
+    if (!sampling.empty()) {
+        out << "{\"triangles\": " << samplingScene.triangleCount << ", \"seed\": " << samplingScene.seed << ", \"width\": " << samplingResolution.width
+            << ", \"height\": " << samplingResolution.height << ", \"referenceSamples\": " << referenceSamples << ", \"results\": [\n";
+        for (size_t i = 0; i < sampling.size(); ++i) {
+            const SamplingResult& r = sampling[i];
+            out << "    {\"mode\": \"" << (r.adaptive ? "adaptive" : "uniform") << "\", \"" << (r.adaptive ? "maxSamples" : "samples") << "\": " << r.samples
+                << ", \"raysPerPixel\": " << r.raysPerPixel << ", \"rmse\": " << r.rmse << ", \"frameSeconds\": " << r.frameSeconds << "}"
+                << (i + 1 < sampling.size() ? "," : "") << "\n";
+        }
+        out << "  ]},\n";
+    }
+    else {
+        out << "null,\n";
+    }
+    out << "  \"secondary\": ";
+    if (!secondary.empty()) {
+        out << "{\"triangles\": " << secondaryScene.triangleCount << ", \"seed\": " << secondaryScene.seed << ", \"width\": " << secondaryResolution.width
+            << ", \"height\": " << secondaryResolution.height << ", \"bounces\": " << bounceCount << ", \"results\": [\n";
+        for (size_t i = 0; i < secondary.size(); ++i) {
+            out << "    {\"mode\": \"" << getSecondaryModeName(secondary[i].mode) << "\", \"frameSeconds\": " << secondary[i].frameSeconds
+                << ", \"differingPixels\": " << secondary[i].differingPixels << "}"
+                << (i + 1 < secondary.size() ? "," : "") << "\n";
+        }
+        out << "  ]},\n";
+    }
+    else {
+        out << "null,\n";
+    }
+    out << "  \"texture\": ";
+    if (!texture.empty()) {
+        out << "{\"size\": " << textureSize << ", \"width\": " << textureResolution.width << ", \"height\": " << textureResolution.height << ", \"results\": [\n";
+        for (size_t i = 0; i < texture.size(); ++i) {
+            out << "    {\"mipmaps\": " << (texture[i].mipmaps ? "true" : "false") << ", \"layout\": \"" << (texture[i].layout == Texture::Layout::Tiled ? "tiled" : "linear")
+                << "\", \"frameSeconds\": " << texture[i].frameSeconds << "}" << (i + 1 < texture.size() ? "," : "") << "\n";
+        }
+        out << "  ]},\n";
+    }
+    else {
+        out << "null,\n";
+    }
+    out << "  \"denoise\": ";
+    if (!denoise.empty()) {
+        out << "{\"triangles\": " << samplingScene.triangleCount << ", \"seed\": " << samplingScene.seed << ", \"width\": " << denoiseResolution.width
+            << ", \"height\": " << denoiseResolution.height << ", \"passes\": " << denoisePasses << ", \"referenceSamples\": " << denoiseReferenceSamples
+            << ", \"referenceFrameSeconds\": " << denoiseReferenceSeconds << ", \"results\": [\n";
+        for (size_t i = 0; i < denoise.size(); ++i) {
+            const DenoiseResult& r = denoise[i];
+            out << "    {\"samples\": " << r.samples << ", \"denoised\": " << (r.denoised ? "true" : "false") << ", \"rmse\": " << r.rmse
+                << ", \"frameSeconds\": " << r.frameSeconds << ", \"denoiseSeconds\": " << r.denoiseSeconds << "}"
+                << (i + 1 < denoise.size() ? "," : "") << "\n";
+        }
+        out << "  ]},\n";
+    }
+    else {
+        out << "null,\n";
+    }
+    out << "  \"temporal\": ";
+    if (temporal) {
+        const TemporalResult& t = *temporal;
+        out << "{\"triangles\": " << temporalScene.triangleCount << ", \"seed\": " << temporalScene.seed << ", \"width\": " << temporalResolution.width
+            << ", \"height\": " << temporalResolution.height << ", \"frames\": " << t.frameCount
+            << ", \"fullFrameSeconds\": " << t.fullFrameSeconds << ", \"temporalFrameSeconds\": " << t.temporalFrameSeconds
+            << ", \"reusedFraction\": " << t.reusedFraction << ", \"tracedFraction\": " << t.tracedFraction << ", \"refreshedFraction\": " << t.refreshedFraction
+            << ", \"rmse\": " << t.rmse << ", \"referenceSamples\": " << temporalReferenceSamples
+            << ", \"fullReferenceRMSE\": " << t.fullReferenceRMSE << ", \"temporalReferenceRMSE\": " << t.temporalReferenceRMSE << "},\n";
+    }
+    else {
+        out << "null,\n";
+    }
+    out << "  \"batch\": ";
+    if (batch) {
+        out << "{\"triangles\": " << batchScene.triangleCount << ", \"seed\": " << batchScene.seed << ", \"width\": " << batchResolution.width
+            << ", \"height\": " << batchResolution.height << ", \"views\": " << batch->viewCount
+            << ", \"separateSeconds\": " << batch->separateSeconds << ", \"separateViewsPerSecond\": " << batch->viewCount / batch->separateSeconds
+            << ", \"batchSeconds\": " << batch->batchSeconds << ", \"batchViewsPerSecond\": " << batch->viewCount / batch->batchSeconds << "}\n";
+    }
+    else {
+        out << "null\n";
+    }
+    out << "}\n";
+
+    return out.str();
+}
+
+}
+
+int main(int argc, const char * argv[]) {
+    int threadCount = 0;
+    int repeats = 5;
+    int maxTriangles = 1000000;
+    int animationFrames = 30;
+    int referenceSamples = 256;
+    int bounceCount = 2;
+    int textureSize = 4096;
+    int denoisePasses = DenoiseSettings().passes;
+    int temporalFrames = 30;
+    int batchViews = 256;
+    std::string outputPath;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string option = argv[i];
+        if (option == "--threads") {
+            threadCount = atoi(argv[i + 1]);
+        }
+        else if (option == "--repeats") {
+            repeats = std::max(1, atoi(argv[i + 1]));
+        }
+        else if (option == "--max-triangles") {
+            maxTriangles = atoi(argv[i + 1]);
+        }
+        else if (option == "--animation-frames") {
+            animationFrames = std::max(0, atoi(argv[i + 1]));
+        }
+        else if (option == "--reference-samples") {
+            referenceSamples = std::max(0, atoi(argv[i + 1]));
+        }
+        else if (option == "--bounces") {
+            bounceCount = std::max(0, atoi(argv[i + 1]));
+        }
+        else if (option == "--texture-size") {
+            textureSize = std::max(0, atoi(argv[i + 1]));
+        }
+        else if (option == "--denoise-passes") {
+            denoisePasses = std::max(0, atoi(argv[i + 1]));
+        }
+        else if (option == "--temporal-frames") {
+            temporalFrames = std::max(0, atoi(argv[i + 1]));
+        }
+        else if (option == "--batch-views") {
+            batchViews = std::max(0, atoi(argv[i + 1]));
+        }
+        else if (option == "--out") {
+            outputPath = argv[i + 1];
+        }
+        else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    //The seeds are part of the scene definition, changing them makes results incomparable with older runs
+    const SceneSpec scenes[] = {{10, 10}, {1000, 1000}, {100000, 100000}, {1000000, 1000000}};
+    const Resolution resolutions[] = {{320, 240}, {800, 600}, {1920, 1080}};
+
+    //The counters are null in the JSON of a build without them, with them every query pays for the counting
+    if (statsEnabled) {
+        std::cerr << "Traversal statistics compiled in, frame times are slower than in a build without RT_ENABLE_STATS" << std::endl;
+    }
+    else {
+        std::cerr << "Traversal statistics disabled, build with -DRT_ENABLE_STATS for the per ray counters" << std::endl;
+    }
+
+    ThreadPool pool(threadCount);
+    std::vector<Result> results;
+    for (const SceneSpec& spec : scenes) {
+        if (spec.triangleCount > maxTriangles) {
+            continue;
+        }
+        const TriangleBuffer triangles = generateScene(spec);
+        auto buildStart = std::chrono::steady_clock::now();
+        const BVH bvh(triangles, pool);
+        const std::chrono::duration<double> buildTime = std::chrono::steady_clock::now() - buildStart;
+        buildStart = std::chrono::steady_clock::now();
+        const WideBVH wide(bvh);
+        const std::chrono::duration<double> collapseTime = std::chrono::steady_clock::now() - buildStart;
+        const double binaryBytes = static_cast<double>(bvh.getNodeCount()) * sizeof(BVHNode) / spec.triangleCount;
+        const double wideBytes = static_cast<double>(wide.getNodes().size()) * sizeof(WideBVHNode) / spec.triangleCount;
+        //The grid is built from the triangles alone, on the pool
+        buildStart = std::chrono::steady_clock::now();
+        const UniformGrid grid(triangles, pool);
+        const std::chrono::duration<double> gridBuildTime = std::chrono::steady_clock::now() - buildStart;
+        const double gridBytes = static_cast<double>(grid.getMemorySize()) / spec.triangleCount;
+
+        for (const Resolution& resolution : resolutions) {
+            for (Mode mode : {Mode::Single, Mode::Packet, Mode::Wide, Mode::Hybrid, Mode::Grid}) {
+                const PerspectiveCamera cam(glm::vec3(0.f, 0.f, 1.f), glm::vec3(0.f, 0.f, -1.f), glm::vec3(0.f, 1.f, 0.f), 90.f, resolution.width, resolution.height);
+                RenderSettings settings;
+                settings.usePackets = mode == Mode::Packet;
+                //Projecting and binning the triangles happens every frame and is part of the frame time
+                settings.rasterizePrimary = mode == Mode::Hybrid;
+                auto render = [&](FrameStats* stats) {
+                    if (mode == Mode::Wide) {
+                        return renderFrame(cam, triangles, wide, pool, settings, stats);
+                    }
+                    if (mode == Mode::Grid) {
+                        return renderFrame(cam, triangles, grid, pool, settings, stats);
+                    }
+                    return renderFrame(cam, triangles, bvh, pool, settings, stats);
+                };
+
+                //The warm-up frame collects the counters, then the median of the timed ones that run without the per tile bookkeeping
+                FrameStats stats;
+                render(statsEnabled ? &stats : nullptr);
+                std::vector<double> times;
+                for (int r = 0; r < repeats; ++r) {
+                    times.push_back(render(nullptr));
+                }
+                std::sort(times.begin(), times.end());
+
+                //The wide BVH is collapsed from the binary one, its build time includes both
+                const double buildSeconds = mode == Mode::Grid ? gridBuildTime.count() : buildTime.count() + (mode == Mode::Wide ? collapseTime.count() : 0.);
+                const double nodeBytes = mode == Mode::Grid ? gridBytes : (mode == Mode::Wide ? wideBytes : binaryBytes);
+                results.push_back({spec.triangleCount, spec.seed, resolution, mode, buildSeconds, nodeBytes,
+                                   times[times.size() / 2], stats.total});
+                std::cerr << spec.triangleCount << " triangles " << resolution.width << "x" << resolution.height << " " << getModeName(mode) << " "
+                          << times[times.size() / 2] * 1e3 << " ms" << std::endl;
+            }
+        }
+    }
+
+    //100k triangles moving every frame, the incremental update against building from scratch
+    std::unique_ptr<AnimationResult> animation;
+    const SceneSpec animatedScene = {100000, 100000};
+    if (animationFrames > 0 && animatedScene.triangleCount <= maxTriangles) {
+        animation.reset(new AnimationResult(benchmarkAnimation(animatedScene, animationFrames, pool)));
+        std::cerr << animatedScene.triangleCount << " animated triangles: update " << animation->updateSeconds * 1e3 << " ms, full build "
+                  << animation->rebuildSeconds * 1e3 << " ms per frame" << std::endl;
+    }
+
+    //Rays spent and error left by uniform and adaptive supersampling, 0 reference samples skips it
+    std::vector<SamplingResult> sampling;
+    if (referenceSamples > 0) {
+        sampling = benchmarkSampling(referenceSamples, pool);
+        for (const SamplingResult& r : sampling) {
+            std::cerr << (r.adaptive ? "adaptive " : "uniform ") << r.raysPerPixel << " rays per pixel, RMSE " << r.rmse << std::endl;
+        }
+    }
+
+    //Reflections traced per pixel against traced in waves, 0 bounces skips it
+    std::vector<SecondaryResult> secondary;
+    if (bounceCount > 0 && secondaryScene.triangleCount <= maxTriangles) {
+        secondary = benchmarkSecondary(bounceCount, repeats, pool);
+        for (const SecondaryResult& r : secondary) {
+            std::cerr << getSecondaryModeName(r.mode) << " " << bounceCount << " bounces " << r.frameSeconds * 1e3 << " ms, " << r.differingPixels
+                      << " pixels differ from tiled" << std::endl;
+        }
+    }
+
+    //Texture lookups with and without mipmaps, in the tiled and the row by row layout, 0 skips it
+    std::vector<TextureResult> texture;
+    if (textureSize > 0) {
+        texture = benchmarkTexture(textureSize, repeats, pool);
+        for (const TextureResult& r : texture) {
+            std::cerr << textureSize << "^2 texture, " << (r.mipmaps ? "mipmapped " : "full resolution ") << (r.layout == Texture::Layout::Tiled ? "tiled " : "linear ")
+                      << r.frameSeconds * 1e3 << " ms" << std::endl;
+        }
+    }
+
+    //Low sample frames filtered against the samples they replace, 0 passes skips it
+    std::vector<DenoiseResult> denoise;
+    double denoiseReferenceSeconds = 0.;
+    if (denoisePasses > 0) {
+        denoise = benchmarkDenoise(denoisePasses, repeats, pool, denoiseReferenceSeconds);
+        for (const DenoiseResult& r : denoise) {
+            std::cerr << r.samples << " samples" << (r.denoised ? " denoised" : "") << ", RMSE " << r.rmse << ", frame " << r.frameSeconds * 1e3 << " ms";
+            if (r.denoised) {
+                std::cerr << ", filter " << r.denoiseSeconds * 1e3 << " ms";
+            }
+            std::cerr << std::endl;
+        }
+        std::cerr << denoiseReferenceSamples << " samples " << denoiseReferenceSeconds * 1e3 << " ms" << std::endl;
+    }
+
+    //Reprojected frames of a slowly moving camera against tracing every frame, less than 2 frames skip it
+    std::unique_ptr<TemporalResult> temporal;
+    if (temporalFrames > 1 && temporalScene.triangleCount <= maxTriangles) {
+        temporal.reset(new TemporalResult(benchmarkTemporal(temporalFrames, pool)));
+        std::cerr << temporalScene.triangleCount << " triangles, camera moving: full " << temporal->fullFrameSeconds * 1e3 << " ms, temporal "
+                  << temporal->temporalFrameSeconds * 1e3 << " ms per frame, " << 100. * temporal->reusedFraction << "% reused, RMSE " << temporal->rmse << std::endl;
+    }
+
+    //Many small views of one scene, per view calls against one batch, 0 views skips it
+    std::unique_ptr<BatchResult> batch;
+    if (batchViews > 0 && batchScene.triangleCount <= maxTriangles) {
+        batch.reset(new BatchResult(benchmarkBatch(batchViews, pool)));
+        std::cerr << batchViews << " views of " << batchScene.triangleCount << " triangles: separate " << batchViews / batch->separateSeconds << " views/s, batch "
+                  << batchViews / batch->batchSeconds << " views/s" << std::endl;
+    }
+
+    const std::string json = toJSON(results, animation.get(), sampling, referenceSamples, secondary, bounceCount, texture, textureSize, denoise, denoisePasses,
+                                    denoiseReferenceSeconds, temporal.get(), batch.get(), pool.getThreadCount(), repeats);
+    if (outputPath.empty()) {
+        std::cout << json;
+    }
+    else {
+        std::ofstream(outputPath) << json;
+    }
+
+    return 0;
+}
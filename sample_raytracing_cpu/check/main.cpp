@@ -0,0 +1,330 @@
+//
+//  main.cpp
+//  Check
+//
+//  Created by Erik Nouroyan on 18.10.26.
+//
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../RayTracer.hpp"
+#include "../ProgressiveRenderer.hpp"
+#include "../SceneGenerator.hpp"
+
+//Compares every traversal with the linear scan over all triangles on the benchmark's seeded scenes
+//and checks that the progressive renderer gives the same image after a restart
+//Prints one line per comparison and returns 1 when any of them differs
+//Options: --threads N, --max-triangles N
+
+namespace {
+
+struct Resolution {
+    int width;
+    int height;
+};
+
+//The brute force reference tests every triangle for every ray, the larger scenes get fewer rays and smaller frames
+struct CheckScene {
+    SceneSpec spec;
+    int randomRays;
+    Resolution resolution;
+};
+
+//The benchmark's scenes with its seeds
+const CheckScene scenes[] = {
+    {{10, 10}, 4096, {160, 120}},
+    {{1000, 1000}, 4096, {160, 120}},
+    {{100000, 100000}, 1024, {80, 60}},
+    {{1000000, 1000000}, 128, {32, 24}}
+};
+
+//Primary rays of every pixel of a small view
+const Resolution rayResolution = {64, 48};
+
+PerspectiveCamera getCamera(const Resolution& resolution) {
+    return PerspectiveCamera(glm::vec3(0.f, 0.f, 1.f), glm::vec3(0.f, 0.f, -1.f), glm::vec3(0.f, 1.f, 0.f), 90.f, resolution.width, resolution.height);
+}
+
+//Camera rays followed by rays from random points around the scene in random directions
+//Every ray comes with the distance its occlusion query stops at, random along the ray so that some queries end before the closest hit
+std::vector<Ray> generateRays(int randomRays, uint32_t seed, std::vector<float>& tMax) {
+    std::mt19937 rng(seed);
+    std::vector<Ray> rays;
+    const RayGenerator generator(getCamera(rayResolution));
+    for (int i = 0; i < rayResolution.height; ++i) {
+        for (int j = 0; j < rayResolution.width; ++j) {
+            rays.push_back(generator.getRay(i, j));
+        }
+    }
+    for (int i = 0; i < randomRays; ++i) {
+        const glm::vec3 origin(nextUnit(rng) * 10.f - 5.f, nextUnit(rng) * 8.f - 4.f, nextUnit(rng) * 8.f - 7.f);
+        glm::vec3 dir(nextUnit(rng) - 0.5f, nextUnit(rng) - 0.5f, nextUnit(rng) - 0.5f);
+        if (glm::length(dir) < 1e-3f) {
+            dir = glm::vec3(0.f, 0.f, -1.f);
+        }
+        rays.push_back({origin, glm::normalize(dir)});
+    }
+    tMax.resize(rays.size());
+    for (float& distance : tMax) {
+        distance = nextUnit(rng) * 8.f;
+    }
+
+    return rays;
+}
+
+bool report(const std::string& name, int differing, int total) {
+    if (differing == 0) {
+        std::cout << name << ": ok" << std::endl;
+        return true;
+    }
+    std::cout << name << ": " << differing << " of " << total << " differ" << std::endl;
+
+    return false;
+}
+
+int countDifferingPixels(const cv::Mat& frame, const cv::Mat& reference) {
+    int differing = 0;
+    for (int i = 0; i < frame.rows; ++i) {
+        for (int j = 0; j < frame.cols; ++j) {
+            differing += frame.at<cv::Vec3b>(i, j) != reference.at<cv::Vec3b>(i, j);
+        }
+    }
+
+    return differing;
+}
+
+//Closest hits and occlusion of single rays and packets through the BVH, the wide BVH and the grid
+bool checkRays(const CheckScene& scene, const TriangleBuffer& triangles, const BVH& bvh, const WideBVH& wide, const UniformGrid& grid, ThreadPool& pool) {
+    std::vector<float> tMax;
+    const std::vector<Ray> rays = generateRays(scene.randomRays, scene.spec.seed, tMax);
+    const int count = static_cast<int>(rays.size());
+    std::vector<int> expected(count);
+    std::vector<char> expectedOccluded(count);
+    pool.parallelFor(count, [&](int i) {
+        expected[i] = getSceneIntersection(rays[i], triangles);
+        expectedOccluded[i] = triangles.occluded(rays[i], 0, triangles.size(), tMax[i]);
+    });
+
+    int bvhHits = 0, wideHits = 0, gridHits = 0, packetHits = 0;
+    int bvhOccluded = 0, wideOccluded = 0, gridOccluded = 0;
+    for (int i = 0; i < count; ++i) {
+        float t = MAXFLOAT;
+        bvhHits += bvh.intersect(rays[i], t) != expected[i];
+        t = MAXFLOAT;
+        wideHits += wide.intersect(rays[i], t) != expected[i];
+        t = MAXFLOAT;
+        gridHits += grid.intersect(rays[i], t) != expected[i];
+        bvhOccluded += bvh.occluded(rays[i], tMax[i]) != static_cast<bool>(expectedOccluded[i]);
+        wideOccluded += wide.occluded(rays[i], tMax[i]) != static_cast<bool>(expectedOccluded[i]);
+        gridOccluded += grid.occluded(rays[i], tMax[i]) != static_cast<bool>(expectedOccluded[i]);
+    }
+    //The last packet is only partly filled, like those at the edges of a tile
+    for (int first = 0; first < count; first += simd::width) {
+        RayPacket packet;
+        const int lanes = std::min(simd::width, count - first);
+        for (int lane = 0; lane < lanes; ++lane) {
+            packet.setRay(lane, rays[first + lane]);
+        }
+        int ids[simd::width];
+        float t[simd::width];
+        bvh.intersect(packet, ids, t);
+        for (int lane = 0; lane < lanes; ++lane) {
+            packetHits += ids[lane] != expected[first + lane];
+        }
+    }
+
+    bool passed = report("  bvh closest hits", bvhHits, count);
+    passed &= report("  bvh occlusion", bvhOccluded, count);
+    passed &= report("  packet closest hits", packetHits, count);
+    passed &= report("  wide closest hits", wideHits, count);
+    passed &= report("  wide occlusion", wideOccluded, count);
+    passed &= report("  grid closest hits", gridHits, count);
+    passed &= report("  grid occlusion", gridOccluded, count);
+
+    return passed;
+}
+
+//Shaded frames of every renderer against the one without an acceleration structure
+bool checkFrames(const CheckScene& scene, const TriangleBuffer& triangles, const BVH& bvh, const WideBVH& wide, const UniformGrid& grid, ThreadPool& pool) {
+    const PerspectiveCamera cam = getCamera(scene.resolution);
+    const int pixels = scene.resolution.width * scene.resolution.height;
+    RenderSettings settings;
+    settings.shading = true;
+    const cv::Mat reference = rayTracing(cam, triangles, nullptr, pool, settings);
+
+    bool passed = report("  bvh frame pixels", countDifferingPixels(rayTracing(cam, triangles, &bvh, pool, settings), reference), pixels);
+    passed &= report("  wide frame pixels", countDifferingPixels(rayTracing(cam, triangles, wide, pool, settings), reference), pixels);
+    passed &= report("  grid frame pixels", countDifferingPixels(rayTracing(cam, triangles, grid, pool, settings), reference), pixels);
+    RenderSettings packets = settings;
+    packets.usePackets = true;
+    passed &= report("  packet frame pixels", countDifferingPixels(rayTracing(cam, triangles, &bvh, pool, packets), reference), pixels);
+    RenderSettings hybrid = settings;
+    hybrid.rasterizePrimary = true;
+    passed &= report("  hybrid frame pixels", countDifferingPixels(rayTracing(cam, triangles, &bvh, pool, hybrid), reference), pixels);
+
+    return passed;
+}
+
+//Same comparison with two bounces off half mirrors, every structure traces the reflected rays itself
+bool checkReflections(const CheckScene& scene, const TriangleBuffer& triangles, const BVH& bvh, const WideBVH& wide, const UniformGrid& grid, ThreadPool& pool) {
+    const PerspectiveCamera cam = getCamera(scene.resolution);
+    const int pixels = scene.resolution.width * scene.resolution.height;
+    RenderSettings settings;
+    settings.shading = true;
+    settings.maxBounces = 2;
+    settings.reflectivity = 0.5f;
+    const cv::Mat reference = rayTracing(cam, triangles, nullptr, pool, settings);
+
+    bool passed = report("  bvh reflection pixels", countDifferingPixels(rayTracing(cam, triangles, &bvh, pool, settings), reference), pixels);
+    passed &= report("  wide reflection pixels", countDifferingPixels(rayTracing(cam, triangles, wide, pool, settings), reference), pixels);
+    passed &= report("  grid reflection pixels", countDifferingPixels(rayTracing(cam, triangles, grid, pool, settings), reference), pixels);
+
+    return passed;
+}
+
+//Random spheres, disks and cylinders among the triangles of the scene
+std::vector<Shape> generateShapes(int count, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<Shape> shapes;
+    while (static_cast<int>(shapes.size()) < count) {
+        const glm::vec3 center(nextUnit(rng) * 8.f - 4.f, nextUnit(rng) * 6.f - 3.f, -2.f - nextUnit(rng) * 4.f);
+        const glm::vec3 axis(nextUnit(rng) - 0.5f, nextUnit(rng) - 0.5f, nextUnit(rng) - 0.5f);
+        const float radius = 0.1f + nextUnit(rng) * 0.5f;
+        const Color color(static_cast<unsigned char>(rng() & 255), static_cast<unsigned char>(rng() & 255), static_cast<unsigned char>(rng() & 255));
+        Shape shape;
+        bool valid;
+        switch (rng() % 3) {
+            case 0:
+                valid = Shape::sphere(center, radius, color, shape);
+                break;
+            case 1:
+                valid = Shape::disk(center, axis, radius, color, shape);
+                break;
+            default:
+                valid = Shape::cylinder(center, center + axis * 2.f, radius, color, shape);
+                break;
+        }
+        if (valid) {
+            shapes.push_back(shape);
+        }
+    }
+
+    return shapes;
+}
+
+//Closest hits and occlusion of the shape scene against every triangle and every shape tested in turn
+//Equal distances go to the triangles first and then to the smallest shape index, like in the scene
+bool checkShapeScene(const CheckScene& scene, const TriangleBuffer& triangles, ThreadPool& pool) {
+    const std::vector<Shape> shapes = generateShapes(64, scene.spec.seed);
+    const ShapeScene shapeScene(triangles, shapes, pool);
+    std::vector<float> tMax;
+    const std::vector<Ray> rays = generateRays(scene.randomRays, scene.spec.seed + 1, tMax);
+    const int count = static_cast<int>(rays.size());
+    std::vector<ShapeHit> expected(count);
+    std::vector<char> expectedOccluded(count);
+    pool.parallelFor(count, [&](int i) {
+        ShapeHit& hit = expected[i];
+        triangles.intersect(rays[i], 0, triangles.size(), hit.t, hit.triangle);
+        bool occluded = triangles.occluded(rays[i], 0, triangles.size(), tMax[i]);
+        for (int s = 0; s < static_cast<int>(shapes.size()); ++s) {
+            float t;
+            if (shapes[s].intersect(rays[i], t)) {
+                occluded = occluded || t < tMax[i];
+                if (t < hit.t) {
+                    hit.t = t;
+                    hit.triangle = INT_MAX;
+                    hit.shape = s;
+                }
+            }
+        }
+        expectedOccluded[i] = occluded;
+    });
+
+    int hits = 0, occlusion = 0;
+    for (int i = 0; i < count; ++i) {
+        ShapeHit hit;
+        shapeScene.intersect(rays[i], hit);
+        hits += hit.triangle != expected[i].triangle || hit.shape != expected[i].shape;
+        occlusion += shapeScene.occluded(rays[i], tMax[i]) != static_cast<bool>(expectedOccluded[i]);
+    }
+
+    bool passed = report("  shape scene closest hits", hits, count);
+    passed &= report("  shape scene occlusion", occlusion, count);
+
+    return passed;
+}
+
+//Renders a few passes, stops and starts again with the same camera, the second run has to give the same image as the first
+bool checkProgressiveRestart(ThreadPool& pool) {
+    const int passes = 4;
+    const TriangleBuffer triangles = generateScene({1000, 1000});
+    const BVH bvh(triangles, pool);
+    const PerspectiveCamera cam = getCamera({320, 240});
+    RenderSettings settings;
+    settings.shading = true;
+    ProgressiveRenderer renderer(triangles, &bvh, pool, cam, settings);
+    auto run = [&]() {
+        renderer.start(passes);
+        while (renderer.getPassCount() < passes) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        renderer.stop();
+        return renderer.getSnapshot();
+    };
+    const cv::Mat first = run();
+    const cv::Mat second = run();
+
+    return report("progressive restart pixels", countDifferingPixels(second, first), first.rows * first.cols);
+}
+
+}
+
+int main(int argc, const char * argv[]) {
+    int threadCount = 0;
+    int maxTriangles = 1000000;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string option = argv[i];
+        if (option == "--threads") {
+            threadCount = atoi(argv[i + 1]);
+        }
+        else if (option == "--max-triangles") {
+            maxTriangles = atoi(argv[i + 1]);
+        }
+        else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    ThreadPool pool(threadCount);
+    bool passed = true;
+    for (const CheckScene& scene : scenes) {
+        if (scene.spec.triangleCount > maxTriangles) {
+            continue;
+        }
+        std::cout << scene.spec.triangleCount << " triangles, seed " << scene.spec.seed << std::endl;
+        const TriangleBuffer triangles = generateScene(scene.spec);
+        const BVH bvh(triangles, pool);
+        const WideBVH wide(bvh);
+        const UniformGrid grid(triangles, pool);
+        passed &= checkRays(scene, triangles, bvh, wide, grid, pool);
+        passed &= checkFrames(scene, triangles, bvh, wide, grid, pool);
+        passed &= checkReflections(scene, triangles, bvh, wide, grid, pool);
+        passed &= checkShapeScene(scene, triangles, pool);
+    }
+    passed &= checkProgressiveRestart(pool);
+
+    if (!passed) {
+        std::cout << "Some renders differ from their reference" << std::endl;
+        return 1;
+    }
+    std::cout << "All renders agree with their reference" << std::endl;
+
+    return 0;
+}
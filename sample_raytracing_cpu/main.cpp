@@ -5,86 +5,611 @@
 //  Created by Erik Nouroyan on 19.11.21.
 //
 
+#include <chrono>
+#include <climits>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
 #include <opencv2/opencv.hpp>
 #include <opencv2/imgproc.hpp>
 #include "Triangle.hpp"
+#include "TriangleBuffer.hpp"
 #include "PerspectiveCamera.hpp"
+#include "BVH.hpp"
+#include "ThreadPool.hpp"
+#include "RayTracer.hpp"
+#include "ProgressiveRenderer.hpp"
+#include "MeshLoader.hpp"
+#include "SceneCache.hpp"
+#include "CameraPath.hpp"
+#include "FrameWriter.hpp"
+#include "TileServer.hpp"
+#include "Texture.hpp"
+#include "Denoiser.hpp"
+#include "TemporalRenderer.hpp"
 
-Ray constructRayThroughPixel(const PerspectiveCamera& camera, int i, int j) {
-    const int width = camera.getWidth();
-    const int height = camera.getHeight();
+//Same tessellation as 3d_cylinder, a unit radius cylinder from y = -1 to y = 1 with capped ends
+std::vector<Triangle> buildCylinder(int sectors, int segments, const Color& color) {
+    const float deltaAngle = 2 * M_PI / sectors;
+    auto ring = [&](int segment, int sector) {
+        const float phi = (sector % sectors) * deltaAngle;
+        return Vertex(cos(phi), -1.f + 2.f * segment / segments, sin(phi));
+    };
     
-    const float xNDC = (j + 0.5f) / width;
-    const float yNDC = (i + 0.5f) / height;
+    std::vector<Triangle> cylinder;
+    for (int j = 0; j < sectors; ++j) {
+        cylinder.emplace_back(std::initializer_list<Vertex>{Vertex(0.f, -1.f, 0.f), ring(0, j), ring(0, j + 1)}, color);
+        cylinder.emplace_back(std::initializer_list<Vertex>{Vertex(0.f, 1.f, 0.f), ring(segments, j + 1), ring(segments, j)}, color);
+        for (int i = 0; i < segments; ++i) {
+            cylinder.emplace_back(std::initializer_list<Vertex>{ring(i, j), ring(i + 1, j), ring(i + 1, j + 1)}, color);
+            cylinder.emplace_back(std::initializer_list<Vertex>{ring(i, j), ring(i + 1, j + 1), ring(i, j + 1)}, color);
+        }
+    }
     
-    const float screenX = 2 * xNDC - 1;
-    const float screenY = 1 - 2 * yNDC;
+    return cylinder;
+}
+
+//Traces the shadow rays of one frame twice, with the any-hit query and with a full closest-hit search
+void reportShadowQueries(const PerspectiveCamera& cam, const TriangleBuffer& triangles, const BVH& bvh, const PointLight& light) {
+    std::vector<Ray> shadowRays;
+    std::vector<float> lightDistances;
+    const RayGenerator rays(cam);
+    for (int i = 0; i < cam.getHeight(); ++i) {
+        for (int j = 0; j < cam.getWidth(); ++j) {
+            const Ray ray = rays.getRay(i, j);
+            float t;
+            const int index = bvh.intersect(ray, t);
+            if (index == INT_MAX) {
+                continue;
+            }
+            glm::vec3 normal = triangles.getNormal(index);
+            if (glm::dot(normal, ray.dir) > 0.f) {
+                normal = -normal;
+            }
+            float lightDistance;
+            shadowRays.push_back(constructShadowRay(ray.p0 + ray.dir * t, normal, light.position, lightDistance));
+            lightDistances.push_back(lightDistance);
+        }
+    }
     
-    const float aspectRatio = static_cast<float>(width) / height;
-    const float cameraX = screenX * aspectRatio * tan(glm::radians(camera.getFOV() / 2));
-    const float cameraY = screenY * tan(glm::radians(camera.getFOV() / 2));
+    int occludedCount = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < shadowRays.size(); ++i) {
+        occludedCount += bvh.occluded(shadowRays[i], lightDistances[i]);
+    }
+    std::chrono::duration<double> anyHit = std::chrono::steady_clock::now() - start;
     
-    glm::mat4 inverseCameraMatrix = camera.getInverseCameraMatrix();
-    glm::vec3 camPos = camera.getPosition();
-    glm::vec3 dir = inverseCameraMatrix * glm::vec4(cameraX, cameraY, -1.f, 1.f) - glm::vec4(camPos, 1.0);
+    int blockedCount = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < shadowRays.size(); ++i) {
+        float t;
+        blockedCount += bvh.intersect(shadowRays[i], t) != INT_MAX && t < lightDistances[i];
+    }
+    std::chrono::duration<double> closestHit = std::chrono::steady_clock::now() - start;
     
-    return {camPos, glm::normalize(dir)};
+    std::cout << "Shadow rays: " << shadowRays.size() << ", occluded " << occludedCount << " (closest-hit " << blockedCount << "), any-hit "
+              << anyHit.count() * 1e3 << " ms, closest-hit " << closestHit.count() * 1e3 << " ms, speedup " << closestHit.count() / anyHit.count() << "x" << std::endl;
 }
 
-int getSceneIntersection (const Ray& r, const std::vector<Triangle>& scene) {
-    float t = MAXFLOAT;
-    int minIndex = INT_MAX;
-    for (int i = 0; i < scene.size(); ++i) {
-        float tTmp = t;
-        if (scene[i].intersects(r, tTmp) && tTmp < t) {
-            t = tTmp;
-            minIndex = i;
-        }
+//Per ray averages of the frame and the tile that cost the most
+void reportFrameStats(const FrameStats& stats) {
+    const TraversalCounters& total = stats.total;
+    const double rays = std::max(1ll, total.rays);
+    std::cout << "Traversal: " << total.rays << " rays, " << total.nodeVisits / rays << " node visits, " << total.triangleTests / rays
+              << " triangle tests per ray, " << 100. * total.hits / rays << "% hit" << std::endl;
+    if (const TileStats* slowest = stats.getSlowestTile()) {
+        std::cout << "Slowest tile at (" << slowest->tile.x << ", " << slowest->tile.y << "): " << slowest->counters.getCost() << " node visits and triangle tests, "
+                  << 100. * slowest->counters.getCost() / std::max(1ll, total.getCost()) << "% of the frame" << std::endl;
     }
-    
-    return minIndex;
 }
 
-cv::Mat rayTracing(const PerspectiveCamera& cam, const std::vector<Triangle>& scene) {
-    const int width = cam.getWidth();
-    const int height = cam.getHeight();
-    cv::Mat frame = cv::Mat::zeros(height, width, CV_8UC3);
-    
-    for (int i = 0; i < height; ++i) {
-        for (int j = 0; j < width; ++j) {
-            Ray ray = constructRayThroughPixel(cam, i, j);
-            int minTriangleIndex = getSceneIntersection(ray, scene);
-            if (minTriangleIndex != INT_MAX) {
-                frame.at<cv::Vec3b>(i, j) = scene[minTriangleIndex].getColor();
+//Renders every camera of the path without opening a window, frame i is written to <prefix>_<i>.<format>
+//With writeCosts its heatmap goes next to it as <prefix>_<i>_cost.<format>, with a coordinator the workers render the frames
+//With denoise the locally rendered frames are filtered before they are written
+int renderCameraPath(const std::vector<PerspectiveCamera>& cameras, const TriangleBuffer& triangles, const BVH& bvh, ThreadPool& pool,
+                     const RenderSettings& settings, const std::string& prefix, const std::string& format, bool writeCosts, bool denoise,
+                     TileCoordinator* coordinator) {
+    if (cameras.empty()) {
+        std::cout << "No cameras to render" << std::endl;
+        return 1;
+    }
+    const int digits = std::max(4, static_cast<int>(std::to_string(cameras.size()).size()));
+    auto getPath = [&](size_t i) {
+        std::ostringstream path;
+        path << prefix << "_" << std::setw(digits) << std::setfill('0') << i;
+        return path.str();
+    };
+    FrameWriter writer;
+    auto start = std::chrono::steady_clock::now();
+    //Plain frames are rendered as one batch, each goes to the writer as soon as its last tile is done
+    const bool batch = !coordinator && !writeCosts && !denoise && !settings.wavefront && !settings.rasterizePrimary;
+    if (batch) {
+        const bool rendered = rayTracingBatch(cameras, triangles, bvh, pool, settings, [&](int i, const cv::Mat& frame) {
+            writer.push(getPath(i) + "." + format, frame);
+        });
+        if (!rendered) {
+            writer.finish();
+            return 1;
+        }
+    }
+    else {
+        for (size_t i = 0; i < cameras.size(); ++i) {
+            const std::string path = getPath(i);
+            if (coordinator) {
+                const cv::Mat frame = coordinator->render(cameras[i], settings);
+                if (frame.empty()) {
+                    writer.finish();
+                    return 1;
+                }
+                writer.push(path + "." + format, frame);
+                continue;
+            }
+            FrameStats stats;
+            FeatureBuffers features;
+            cv::Mat frame = rayTracing(cameras[i], triangles, &bvh, pool, settings, nullptr, writeCosts ? &stats : nullptr, denoise ? &features : nullptr);
+            if (denoise) {
+                frame = ::denoise(frame, features, cameras[i], pool);
+            }
+            writer.push(path + "." + format, frame);
+            if (writeCosts) {
+                writer.push(path + "_cost." + format, getCostHeatmap(stats.pixelCosts));
             }
         }
     }
-    
-    return frame;
+    const int failedCount = writer.finish();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "Rendered " << cameras.size() << " frames in " << elapsed.count() << " s (" << cameras.size() / elapsed.count() << " fps), "
+              << "waited " << writer.getBlockedSeconds() << " s for the writer" << std::endl;
+
+    return failedCount == 0 ? 0 : 1;
 }
 
-int main() {
+int main(int argc, const char * argv[]) {
     const int width = 800;
     const int height = 600;
     
-    std::vector<Triangle> scene;
-    Triangle t1;
-    scene.push_back(t1);
+    //A numeric argument sets the number of render threads, all hardware threads are used by default
+    int threadCount = 0;
+    bool progressive = false;
+    bool temporal = false;
+    bool adaptive = false;
+    bool wide = false;
+    bool grid = false;
+    bool shapes = false;
+    bool wavefront = false;
+    bool hybrid = false;
+    bool collectStats = false;
+    bool denoise = false;
+    int sampleCount = 1;
+    int bounceCount = 0;
+    std::string meshPath;
+    std::string texturePath;
+    int instanceGrid = 0;
+    //Headless mode, set by --output
+    std::string outputPrefix;
+    std::string outputFormat = "png";
+    std::string cameraPathFile;
+    int frameCount = 60;
+    //Distributed rendering, the coordinator listens on a port and the workers connect to host:port
+    int listenPort = 0;
+    std::string coordinatorAddress;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--progressive") {
+            progressive = true;
+        }
+        else if (std::string(argv[i]) == "--temporal") {
+            temporal = true;
+        }
+        else if (std::string(argv[i]) == "--wide") {
+            wide = true;
+        }
+        else if (std::string(argv[i]) == "--grid") {
+            grid = true;
+        }
+        else if (std::string(argv[i]) == "--shapes") {
+            shapes = true;
+        }
+        else if (std::string(argv[i]) == "--adaptive") {
+            adaptive = true;
+        }
+        else if (std::string(argv[i]) == "--wavefront") {
+            wavefront = true;
+        }
+        else if (std::string(argv[i]) == "--hybrid") {
+            hybrid = true;
+        }
+        else if (std::string(argv[i]) == "--stats") {
+            collectStats = true;
+        }
+        else if (std::string(argv[i]) == "--denoise") {
+            denoise = true;
+        }
+        else if (std::string(argv[i]) == "--samples" && i + 1 < argc) {
+            sampleCount = atoi(argv[++i]);
+        }
+        else if (std::string(argv[i]) == "--bounces" && i + 1 < argc) {
+            bounceCount = atoi(argv[++i]);
+        }
+        else if (std::string(argv[i]) == "--instances" && i + 1 < argc) {
+            instanceGrid = atoi(argv[++i]);
+        }
+        else if (std::string(argv[i]) == "--mesh" && i + 1 < argc) {
+            meshPath = argv[++i];
+        }
+        else if (std::string(argv[i]) == "--texture" && i + 1 < argc) {
+            texturePath = argv[++i];
+        }
+        else if (std::string(argv[i]) == "--output" && i + 1 < argc) {
+            outputPrefix = argv[++i];
+        }
+        else if (std::string(argv[i]) == "--format" && i + 1 < argc) {
+            outputFormat = argv[++i];
+        }
+        else if (std::string(argv[i]) == "--camera-path" && i + 1 < argc) {
+            cameraPathFile = argv[++i];
+        }
+        else if (std::string(argv[i]) == "--frames" && i + 1 < argc) {
+            frameCount = atoi(argv[++i]);
+        }
+        else if (std::string(argv[i]) == "--listen" && i + 1 < argc) {
+            listenPort = atoi(argv[++i]);
+        }
+        else if (std::string(argv[i]) == "--worker" && i + 1 < argc) {
+            coordinatorAddress = argv[++i];
+        }
+        else if (argv[i][0] != '\0' && std::string(argv[i]).find_first_not_of("0123456789") == std::string::npos) {
+            threadCount = atoi(argv[i]);
+        }
+        else {
+            std::cout << "Unknown option " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if (outputFormat != "png" && outputFormat != "ppm") {
+        std::cout << "Unsupported output format " << outputFormat << ", use png or ppm" << std::endl;
+        return 1;
+    }
+    //The instanced scene has no triangle buffer of its own to hand to the path renderer
+    if (instanceGrid > 0 && !outputPrefix.empty()) {
+        std::cout << "--output can't be combined with --instances" << std::endl;
+        return 1;
+    }
+    //The features come from the primary hits of the tiled renderer, the other renderers and scenes don't keep them
+    if (denoise && (adaptive || wavefront || hybrid)) {
+        std::cout << "--denoise can't be combined with --adaptive, --wavefront or --hybrid" << std::endl;
+        return 1;
+    }
+    if (denoise && (progressive || temporal || wide || grid || shapes || instanceGrid > 0 || listenPort > 0 || !coordinatorAddress.empty())) {
+        std::cout << "--denoise only filters frames of the triangle BVH, it can't be combined with --progressive, --temporal, --wide, --grid, --shapes, "
+                  << "--instances, --listen or --worker" << std::endl;
+        return 1;
+    }
+    if (collectStats && !statsEnabled) {
+        std::cout << "Traversal statistics are compiled out, build with -DRT_ENABLE_STATS to get them" << std::endl;
+        collectStats = false;
+    }
+    else if (statsEnabled) {
+        //Such a build counts in every query, the timed frames only leave out the per tile bookkeeping
+        std::cout << "Traversal statistics are compiled in, ray throughput is lower than in a build without RT_ENABLE_STATS" << std::endl;
+    }
+    ThreadPool pool(threadCount);
+    RenderSettings settings;
+    settings.usePackets = true;
+    settings.shading = true;
+    settings.samplesPerPixel = std::max(1, sampleCount);
+    settings.adaptive.enabled = adaptive;
+    settings.wavefront = wavefront;
+    settings.rasterizePrimary = hybrid;
+    //Half mirrors, so that every bounce still shows
+    settings.maxBounces = bounceCount;
+    settings.reflectivity = bounceCount > 0 ? 0.5f : 0.f;
+    Texture texture;
+    if (!texturePath.empty()) {
+        texture = Texture(cv::imread(texturePath));
+        if (texture.isEmpty()) {
+            std::cout << "Could not read texture " << texturePath << std::endl;
+            return 1;
+        }
+        settings.texture = &texture;
+        std::cout << "Texture " << texture.getWidth() << "x" << texture.getHeight() << ", " << texture.getLevelCount() << " mip levels" << std::endl;
+    }
+    
+    if (instanceGrid > 0) {
+        //A grid of copies of one 127x127 cylinder, only the cylinder's triangles and BVH are stored
+        InstancedScene scene;
+        const int cylinder = scene.addMesh(TriangleBuffer(buildCylinder(127, 127, Color(200, 60, 60))), pool);
+        for (int i = 0; i < instanceGrid; ++i) {
+            for (int j = 0; j < instanceGrid; ++j) {
+                glm::mat4 transform = glm::translate(glm::mat4(1.f), glm::vec3(3.f * (j - instanceGrid / 2), 0.f, -3.f * i));
+                transform = glm::rotate(transform, 0.3f * (i + j), glm::vec3(1.f, 0.f, 1.f));
+                scene.addInstance(cylinder, glm::scale(transform, glm::vec3(1.f, 1.f + 0.1f * (i % 5), 1.f)));
+            }
+        }
+        auto start = std::chrono::steady_clock::now();
+        scene.build();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        const long long instanced = static_cast<long long>(scene.getMesh(cylinder).getTriangles().size()) * scene.getInstanceCount();
+        std::cout << scene.getInstanceCount() << " instances of " << scene.getMesh(cylinder).getTriangles().size() << " triangles (" << instanced
+                  << " instanced), top level built in " << elapsed.count() << " s" << std::endl;
+        
+        PerspectiveCamera pc(glm::vec3(0.f, 6.f, 8.f), glm::vec3(0.f, -0.5f, -1.f), glm::vec3(0.f, 1.f, 0.f));
+        pc.setWidth(width);
+        pc.setHeight(height);
+        start = std::chrono::steady_clock::now();
+        cv::Mat frame = rayTracing(pc, scene, pool, settings);
+        elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "Primary rays: " << pc.getWidth() * pc.getHeight() / elapsed.count() * 1e-6 << " Mrays/s" << std::endl;
+        cv::imshow("MyWind", frame);
+        cv::waitKey(0);
+        
+        return 0;
+    }
     
-    Triangle t2;
-    t2.setVertices({{1.f, -1.f, -5.f}, {-1.f, -1.f, -5.f}, {0.f, 0.3f, -5.f}});
-    t2.setColor({255, 0, 0});
-    scene.push_back(t2);
+    TriangleBuffer triangles;
+    std::unique_ptr<BVH> bvh;
+    if (meshPath.empty()) {
+        //The texture stands upright on every triangle, the apex takes the middle of its top row
+        std::vector<Triangle> scene;
+        Triangle t1;
+        t1.setTexCoords({{1.f, 1.f}, {0.f, 1.f}, {0.5f, 0.f}});
+        scene.push_back(t1);
+        
+        Triangle t2;
+        t2.setVertices({{1.f, -1.f, -5.f}, {-1.f, -1.f, -5.f}, {0.f, 0.3f, -5.f}});
+        t2.setColor({255, 0, 0});
+        t2.setTexCoords({{1.f, 1.f}, {0.f, 1.f}, {0.5f, 0.f}});
+        scene.push_back(t2);
+        
+        Triangle t3;
+        t3.setVertices({{2.f, -0.3f, -8.f}, {-2.f, -0.3f, -8.f}, {0.f, 4.f, -8.f}});
+        t3.setColor({0, 255, 0});
+        t3.setTexCoords({{1.f, 1.f}, {0.f, 1.f}, {0.5f, 0.f}});
+        scene.push_back(t3);
+        
+        triangles = TriangleBuffer(scene);
+        bvh.reset(new BVH(triangles, pool));
+    }
+    else {
+        //The mesh is only parsed when there is no cache built from its current contents
+        auto start = std::chrono::steady_clock::now();
+        SceneCache cache(pool);
+        const uint64_t sourceHash = cache.hashFile(meshPath);
+        const std::string cachePath = SceneCache::getCachePath(meshPath);
+        std::unique_ptr<BVH> cached = cache.load(cachePath, sourceHash);
+        if (!cached) {
+            MeshLoader loader(pool);
+            if (!loader.load(meshPath, triangles)) {
+                return 1;
+            }
+            const MeshLoadStats& stats = loader.getStats();
+            std::cout << "Loaded " << stats.triangleCount << " triangles, " << stats.vertexCount << " vertices in " << stats.seconds << " s, peak RSS "
+                      << stats.peakResidentKilobytes / 1024 << " MB" << std::endl;
+            if (stats.invalidFaceCount > 0) {
+                std::cout << stats.invalidFaceCount << " faces reference missing vertices and were skipped" << std::endl;
+            }
+            bvh.reset(new BVH(triangles, pool));
+            if (cache.save(cachePath, sourceHash, *bvh)) {
+                cached = cache.load(cachePath, sourceHash);
+            }
+        }
+        //Cached triangles are numbered by their slot, so the BVH's own buffer doubles as the scene
+        if (cached) {
+            bvh = std::move(cached);
+            triangles = bvh->getTriangles();
+        }
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "Scene ready in " << elapsed.count() << " s" << std::endl;
+    }
     
-    Triangle t3;
-    t3.setVertices({{2.f, -0.3f, -8.f}, {-2.f, -0.3f, -8.f}, {0.f, 4.f, -8.f}});
-    t3.setColor({0, 255, 0});
-    scene.push_back(t3);
+    if (!coordinatorAddress.empty()) {
+        //The scene stays loaded while the worker serves frames, the coordinator sends the cameras
+        const size_t colon = coordinatorAddress.rfind(':');
+        if (colon == std::string::npos) {
+            std::cout << "Expected --worker host:port" << std::endl;
+            return 1;
+        }
+        return runTileWorker(coordinatorAddress.substr(0, colon), atoi(coordinatorAddress.c_str() + colon + 1), triangles, *bvh, pool, settings.texture) ? 0 : 1;
+    }
+    std::unique_ptr<TileCoordinator> coordinator;
+    if (listenPort > 0) {
+        coordinator.reset(new TileCoordinator(listenPort, triangles.size(), settings.texture));
+        if (!coordinator->isListening()) {
+            return 1;
+        }
+        std::cout << "Waiting for workers on port " << listenPort << std::endl;
+    }
     
     PerspectiveCamera pc;
     pc.setPosition(glm::vec3(1.f, 0.f, 2.f));
-    cv::Mat frame = rayTracing(pc, scene);
+    if (!meshPath.empty() && bvh->getNodeCount() > 0) {
+        //Backing the camera off along +z until the whole mesh fits into the 90 degree field of view
+        const AABB& bounds = bvh->getNodes()[0].bounds;
+        const glm::vec3 extent = bounds.max - bounds.min;
+        pc.setPosition(bounds.getCenter() + glm::vec3(0.f, 0.f, extent.z * 0.5f + std::max(extent.x, extent.y)));
+    }
+    if (!outputPrefix.empty()) {
+        //Without a path file the camera orbits the scene
+        std::vector<PerspectiveCamera> cameras;
+        if (!cameraPathFile.empty()) {
+            if (!loadCameraPath(cameraPathFile, width, height, cameras)) {
+                return 1;
+            }
+        }
+        else if (bvh->getNodeCount() > 0) {
+            cameras = getOrbitPath(bvh->getNodes()[0].bounds, std::max(1, frameCount), width, height);
+        }
+        
+        return renderCameraPath(cameras, triangles, *bvh, pool, settings, outputPrefix, outputFormat, collectStats, denoise, coordinator.get());
+    }
+    if (coordinator) {
+        auto start = std::chrono::steady_clock::now();
+        cv::Mat frame = coordinator->render(pc, settings);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (frame.empty()) {
+            return 1;
+        }
+        std::cout << "Rendered on " << coordinator->getWorkerCount() << " workers in " << elapsed.count() << " s, " << coordinator->getReassignedCount()
+                  << " tiles reassigned" << std::endl;
+        cv::imshow("MyWind", frame);
+        cv::waitKey(0);
+        
+        return 0;
+    }
+    if (progressive) {
+        ProgressiveRenderer renderer(triangles, bvh.get(), pool, pc, settings);
+        renderer.start();
+        //Showing the latest refinement until a key is pressed
+        while (true) {
+            cv::Mat snapshot = renderer.getSnapshot();
+            if (!snapshot.empty()) {
+                cv::imshow("MyWind", snapshot);
+            }
+            if (cv::waitKey(30) >= 0) {
+                break;
+            }
+        }
+        renderer.stop();
+        
+        return 0;
+    }
+    if (temporal) {
+        //Half a degree per frame around the scene, every frame reuses what the one before it traced
+        std::vector<PerspectiveCamera> cameras;
+        if (bvh->getNodeCount() > 0) {
+            cameras = getOrbitPath(bvh->getNodes()[0].bounds, 720, width, height);
+        }
+        else {
+            cameras.push_back(pc);
+        }
+        TemporalRenderer renderer(triangles, *bvh, pool, settings);
+        for (size_t i = 0; ; i = (i + 1) % cameras.size()) {
+            auto start = std::chrono::steady_clock::now();
+            cv::Mat frame = renderer.render(cameras[i]);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            const TemporalFrameStats& stats = renderer.getLastStats();
+            std::cout << "Frame " << elapsed.count() * 1e3 << " ms, reused " << stats.reusedPixels << ", traced " << stats.tracedPixels << ", refreshed "
+                      << stats.refreshedPixels << std::endl;
+            cv::imshow("MyWind", frame);
+            if (cv::waitKey(1) >= 0) {
+                break;
+            }
+        }
+        
+        return 0;
+    }
+    
+    if (shapes) {
+        //The unit cylinder of buildCylinder(127, 127) next to the scene's triangles, once as an analytic shape and once tessellated
+        //The sphere and the floor disk are analytic in both scenes
+        const Color cylinderColor(200, 60, 60);
+        std::vector<Shape> analytic(3);
+        if (!Shape::cylinder(glm::vec3(0.f, -1.f, 0.f), glm::vec3(0.f, 1.f, 0.f), 1.f, cylinderColor, analytic[0]) ||
+            !Shape::sphere(glm::vec3(2.2f, 0.f, -2.f), 0.8f, Color(60, 200, 60), analytic[1]) ||
+            !Shape::disk(glm::vec3(0.f, -1.01f, -3.f), glm::vec3(0.f, 1.f, 0.f), 8.f, Color(180, 180, 180), analytic[2])) {
+            return 1;
+        }
+        const std::vector<Triangle> cylinder = buildCylinder(127, 127, cylinderColor);
+        TriangleBuffer tessellated;
+        tessellated.resize(triangles.size() + static_cast<int>(cylinder.size()));
+        for (int slot = 0; slot < triangles.size(); ++slot) {
+            tessellated.copySlot(slot, triangles, slot);
+        }
+        for (size_t i = 0; i < cylinder.size(); ++i) {
+            const int slot = triangles.size() + static_cast<int>(i);
+            const std::array<Vertex, 3>& v = cylinder[i].getVertices();
+            tessellated.setTriangle(slot, v[0], v[1], v[2], cylinderColor, slot);
+        }
+        
+        const ShapeScene analyticScene(triangles, analytic, pool);
+        const ShapeScene tessellatedScene(tessellated, {analytic[1], analytic[2]}, pool);
+        const size_t triangleBytes = TriangleBuffer::AttributeCount * sizeof(float) + sizeof(Color) + sizeof(int);
+        std::cout << "Cylinder: analytic " << sizeof(Shape) << " bytes, tessellated " << cylinder.size() << " triangles, "
+                  << cylinder.size() * triangleBytes / 1024 << " KB without their BVH" << std::endl;
+        cv::Mat frame;
+        for (const ShapeScene* scene : {&tessellatedScene, &analyticScene}) {
+            auto start = std::chrono::steady_clock::now();
+            frame = rayTracing(pc, *scene, pool, settings);
+            std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            std::cout << "Primary rays: " << pc.getWidth() * pc.getHeight() / elapsed.count() * 1e-6 << " Mrays/s ("
+                      << (scene == &analyticScene ? "analytic" : "tessellated") << " cylinder)" << std::endl;
+        }
+        cv::imshow("MyWind", frame);
+        cv::waitKey(0);
+        
+        return 0;
+    }
+    
+    if (wide) {
+        //Quantized simd::width-ary nodes collapsed from the binary BVH, traced one ray at a time
+        const WideBVH wideBVH(*bvh);
+        std::cout << "Node memory: binary " << bvh->getNodeCount() * sizeof(BVHNode) / 1024 << " KB, wide "
+                  << wideBVH.getNodes().size() * sizeof(WideBVHNode) / 1024 << " KB" << std::endl;
+        auto start = std::chrono::steady_clock::now();
+        cv::Mat frame = rayTracing(pc, triangles, wideBVH, pool, settings);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "Primary rays: " << pc.getWidth() * pc.getHeight() / elapsed.count() * 1e-6 << " Mrays/s (" << simd::width << " wide nodes)" << std::endl;
+        if (collectStats) {
+            FrameStats stats;
+            rayTracing(pc, triangles, wideBVH, pool, settings, &stats);
+            reportFrameStats(stats);
+            cv::imshow("Cost", getCostHeatmap(stats.pixelCosts));
+        }
+        cv::imshow("MyWind", frame);
+        cv::waitKey(0);
+        
+        return 0;
+    }
+    
+    if (grid) {
+        //Built from the triangles alone, the BVH above is not used
+        auto start = std::chrono::steady_clock::now();
+        const UniformGrid uniformGrid(triangles, pool);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        const glm::ivec3& resolution = uniformGrid.getResolution();
+        std::cout << "Grid " << resolution.x << "x" << resolution.y << "x" << resolution.z << " built in " << elapsed.count() * 1e3 << " ms, "
+                  << uniformGrid.getReferenceCount() << " references, " << uniformGrid.getMemorySize() / 1024 << " KB" << std::endl;
+        start = std::chrono::steady_clock::now();
+        cv::Mat frame = rayTracing(pc, triangles, uniformGrid, pool, settings);
+        elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "Primary rays: " << pc.getWidth() * pc.getHeight() / elapsed.count() * 1e-6 << " Mrays/s (uniform grid)" << std::endl;
+        if (collectStats) {
+            FrameStats stats;
+            rayTracing(pc, triangles, uniformGrid, pool, settings, &stats);
+            reportFrameStats(stats);
+            cv::imshow("Cost", getCostHeatmap(stats.pixelCosts));
+        }
+        cv::imshow("MyWind", frame);
+        cv::waitKey(0);
+        
+        return 0;
+    }
+    
+    //The denoiser's features are kept from the frame's own primary hits
+    FeatureBuffers features;
+    auto start = std::chrono::steady_clock::now();
+    cv::Mat frame = rayTracing(pc, triangles, bvh.get(), pool, settings, nullptr, nullptr, denoise ? &features : nullptr);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (hybrid) {
+        std::cout << "Primary hits: " << pc.getWidth() * pc.getHeight() / elapsed.count() * 1e-6 << " Mpixels/s (rasterized)" << std::endl;
+    }
+    else {
+        std::cout << "Primary rays: " << pc.getWidth() * pc.getHeight() / elapsed.count() * 1e-6 << " Mrays/s (" << simd::width << " wide packets)" << std::endl;
+    }
+    if (collectStats) {
+        FrameStats stats;
+        rayTracing(pc, triangles, bvh.get(), pool, settings, nullptr, &stats);
+        reportFrameStats(stats);
+        cv::imshow("Cost", getCostHeatmap(stats.pixelCosts));
+    }
+    reportShadowQueries(pc, triangles, *bvh, settings.light);
+    if (denoise) {
+        //The noisy frame stays on screen next to the filtered one
+        start = std::chrono::steady_clock::now();
+        cv::Mat denoised = ::denoise(frame, features, pc, pool);
+        elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << "Denoised in " << elapsed.count() * 1e3 << " ms" << std::endl;
+        cv::imshow("Denoised", denoised);
+    }
     cv::imshow("MyWind", frame);
     cv::waitKey(0);
     